@@ -25,66 +25,137 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+/**
+ * Maximum number of consecutive frames concealed by the decoder when its queue
+ * runs dry in the middle of a stream, longer gaps are filled with silence.
+ */
+#ifndef CODEC_PLC_MAX_FRAMES
+#define CODEC_PLC_MAX_FRAMES 6
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 /**
- * Initialise audio codec manager, allocating data buffers.
+ * Statistics of the compressed frame queue, reset every time an encoding or
+ * decoding operation starts.
+ */
+typedef struct
+{
+    uint32_t underruns;   ///< Times the decoder found the queue empty in the middle of a stream.
+    uint32_t overruns;    ///< Frames rejected or dropped because the queue was full.
+    uint32_t concealed;   ///< Missing frames concealed by the decoder.
+    uint32_t queued;      ///< Frames currently in the queue.
+}
+codecStats_t;
+
+/**
+ * Opaque type of a codec instance. Each instance has its own codec2 state,
+ * audio buffer, frame queue and thread, thus different instances can encode
+ * or decode independently of each other.
+ */
+typedef struct codec codec_t;
+
+/**
+ * Open a new codec instance. The codec2 state and the audio buffer are
+ * allocated only while an encoding or decoding operation is in progress.
  *
- * This function allows recursive calls. However the number of times this
- * function is called must be balanced by an equal number of calls to the
- * terminate() function.
+ * @return pointer to the new instance or NULL in case of allocation failure.
  */
-void codec_init();
+codec_t *codec_open();
 
 /**
- * Shutdown audio codec manager and deallocate data buffers.
+ * Close a codec instance, stopping any ongoing operation and deallocating the
+ * instance.
+ *
+ * @param codec: codec instance.
  */
-void codec_terminate();
+void codec_close(codec_t *codec);
 
 /**
  * Start encoding of audio data from a given audio source.
- * Only an encoding or decoding operation at a time is possible: in case there
- * is already an operation in progress, this function returns false.
+ * Only an encoding or decoding operation at a time is possible on each codec
+ * instance: in case there is already an operation in progress, this function
+ * returns false.
  *
+ * @param codec: codec instance.
  * @param source: audio source for encoding.
  * @return true on success, false on failure.
  */
-bool codec_startEncode(const enum AudioSource source);
+bool codec_startEncode(codec_t *codec, const enum AudioSource source);
 
 /**
  * Start dencoding of audio data sending the uncompressed samples to a given
  * audio destination.
- * Only an encoding or decoding operation at a time is possible: in case there
- * is already an operation in progress, this function returns false.
+ * Only an encoding or decoding operation at a time is possible on each codec
+ * instance: in case there is already an operation in progress, this function
+ * returns false.
  *
+ * @param codec: codec instance.
  * @param destination: destination for decoded audio.
+ * @param prio: priority of the decoded audio in the output mixer.
  * @return true on success, false on failure.
  */
-bool codec_startDecode(const enum AudioSink destination);
+bool codec_startDecode(codec_t *codec, const enum AudioSink destination,
+                       const enum AudioPriority prio);
+
+/**
+ * Start decoding of audio data with a jitter buffer: playback starts only once
+ * the given number of frames has been queued. When the queue runs empty in the
+ * middle of a stream, the missing frames are concealed by repeating the last
+ * one with a decreasing volume, for up to CODEC_PLC_MAX_FRAMES frames; after
+ * that, playback is suspended until the same amount of frames is available
+ * again. This absorbs irregular frame arrival at the cost of 20ms of latency
+ * per frame.
+ * Only an encoding or decoding operation at a time is possible on each codec
+ * instance: in case there is already an operation in progress, this function
+ * returns false.
+ *
+ * @param codec: codec instance.
+ * @param destination: destination for decoded audio.
+ * @param prio: priority of the decoded audio in the output mixer.
+ * @param frames: number of frames to be buffered before starting playback,
+ * limited to the queue size minus two.
+ * @return true on success, false on failure.
+ */
+bool codec_startDecodeBuffered(codec_t *codec, const enum AudioSink destination,
+                               const enum AudioPriority prio,
+                               const uint8_t frames);
 
 /**
  * Stop an ongoing encoding or decoding operation.
+ *
+ * @param codec: codec instance.
  */
-void codec_stop();
+void codec_stop(codec_t *codec);
+
+/**
+ * Check if an encoding or decoding operation is in progress.
+ *
+ * @param codec: codec instance.
+ * @return true if the codec instance is running.
+ */
+bool codec_isRunning(const codec_t *codec);
 
 /**
  * Get a compressed audio frame from the internal queue. Each frame is composed
  * of 8 bytes.
  *
+ * @param codec: codec instance.
  * @param frame: pointer to a destination buffer where to put the encoded frame.
  * @param blocking: if true the execution flow will be blocked whenever the
  * internal buffer is empty and resumed as soon as an encoded frame is available.
  * @return true on success, false if there is no encoding operation ongoing or
  * the queue is empty and the function is nonblocking.
  */
-bool codec_popFrame(uint8_t *frame, const bool blocking);
+bool codec_popFrame(codec_t *codec, uint8_t *frame, const bool blocking);
 
 /**
  * Push a a compressed audio frame to the internal queue for decoding.
  * Each frame is composed of 8 bytes.
  *
+ * @param codec: codec instance.
  * @param frame: frame to be pushed to the queue.
  * @param blocking: if true the execution flow will be blocked whenever the
  * internal buffer is full and resumed as soon as space for an encoded frame is
@@ -92,7 +163,38 @@ bool codec_popFrame(uint8_t *frame, const bool blocking);
  * @return true on success, false if there is no decoding operation ongoing or
  * the queue is full and the function is nonblocking.
  */
-bool codec_pushFrame(const uint8_t *frame, const bool blocking);
+bool codec_pushFrame(codec_t *codec, const uint8_t *frame, const bool blocking);
+
+/**
+ * Push to the internal queue a placeholder for a compressed audio frame lost in
+ * transmission. When the placeholder is reached the decoder conceals the lost
+ * frame in its place, keeping the timing of the frames that follow; frames
+ * already concealed because the queue ran empty are not concealed again.
+ *
+ * @param codec: codec instance.
+ * @param blocking: if true the execution flow will be blocked whenever the
+ * internal buffer is full and resumed as soon as space is available.
+ * @return true on success, false if there is no decoding operation ongoing or
+ * the queue is full and the function is nonblocking.
+ */
+bool codec_pushLostFrame(codec_t *codec, const bool blocking);
+
+/**
+ * Mark the end of the stream of frames pushed so far: once all of them have
+ * been played, the decoder outputs silence instead of concealing the frames
+ * missing from the queue. The stream restarts with the next frame pushed.
+ *
+ * @param codec: codec instance.
+ */
+void codec_endStream(codec_t *codec);
+
+/**
+ * Get the statistics of the compressed frame queue.
+ *
+ * @param codec: codec instance.
+ * @param stats: pointer to a destination structure for the statistics.
+ */
+void codec_getStats(codec_t *codec, codecStats_t *stats);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,130 @@
+/***************************************************************************
+ *   Copyright (C) 2023 by Federico Amedeo Izzo IU2NUO,                    *
+ *                         Niccolò Izzo IU2KIN                             *
+ *                         Frederik Saraci IU2NRO                          *
+ *                         Silvano Seva IU2KWO                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+#ifndef AUDIO_MIXER_H
+#define AUDIO_MIXER_H
+
+#include <interfaces/audio_stream.h>
+#include <interfaces/audio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Sample rate of the mixer output, in Hz. Sources running at an integer
+ * multiple or submultiple of this rate are converted to it.
+ */
+#ifndef MIXER_SAMPLE_RATE
+#define MIXER_SAMPLE_RATE 8000
+#endif
+
+/**
+ * Number of samples produced by the mixer at each cycle. The hardware output
+ * stream is double buffered, thus it holds twice this amount of samples.
+ */
+#ifndef MIXER_BLOCK_SIZE
+#define MIXER_BLOCK_SIZE 160
+#endif
+
+/**
+ * Maximum number of sources mixed at the same time.
+ */
+#ifndef MIXER_MAX_SOURCES
+#define MIXER_MAX_SOURCES 4
+#endif
+
+/**
+ * Gain applied to the sources having a priority lower than the one of the
+ * highest priority source open, 256 corresponds to unity gain.
+ */
+#ifndef MIXER_DUCK_GAIN
+#define MIXER_DUCK_GAIN 64
+#endif
+
+/**
+ * Unity gain value for the mixer sources.
+ */
+#define MIXER_UNITY_GAIN 256
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Identifier of a mixer source.
+ */
+typedef int8_t mixerSource_t;
+
+/**
+ * Open a new source of the software audio mixer. The mixer owns the hardware
+ * output stream towards the speaker: the stream is started with the first
+ * source opened and stopped when the last one is closed.
+ * All the open sources are summed together, each one scaled by its gain and,
+ * when a source with higher priority is open, attenuated by MIXER_DUCK_GAIN.
+ *
+ * @param destination: audio sink, only SINK_SPK is supported.
+ * @param prio: priority of the source.
+ * @param sampleRate: sample rate of the source, must be an integer multiple or
+ * submultiple of MIXER_SAMPLE_RATE.
+ * @return identifier of the new source or -1 if the source could not be opened.
+ */
+mixerSource_t mixer_openSource(const enum AudioSink destination,
+                               const enum AudioPriority prio,
+                               const uint32_t sampleRate);
+
+/**
+ * Set the gain of a mixer source.
+ *
+ * @param id: source identifier.
+ * @param gain: new gain, MIXER_UNITY_GAIN corresponds to unity gain.
+ */
+void mixer_setGain(const mixerSource_t id, const uint16_t gain);
+
+/**
+ * Write a block of samples to a mixer source. The samples are queued and
+ * consumed by the mixer at the source sample rate; the queue holds up to two
+ * mixer cycles of data, thus a blocking write paces the caller to the speed of
+ * the output stream. If the output stream has been preempted by one with higher
+ * priority, a blocking write returns as soon as the queue is full.
+ * This function must not be called concurrently with mixer_closeSource() on the
+ * same source.
+ *
+ * @param id: source identifier.
+ * @param samples: samples to be written.
+ * @param length: number of samples to be written.
+ * @param blocking: if true, wait until all the samples have been queued.
+ * @return number of samples effectively queued.
+ */
+size_t mixer_write(const mixerSource_t id, const stream_sample_t *samples,
+                   const size_t length, const bool blocking);
+
+/**
+ * Close a mixer source, discarding the samples still queued. When the last
+ * source is closed, the output stream is stopped before returning.
+ *
+ * @param id: source identifier.
+ */
+void mixer_closeSource(const mixerSource_t id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AUDIO_MIXER_H */
@@ -28,6 +28,7 @@
 #include <array>
 #include <cstddef>
 #include <cstdint>
+#include <utility>
 
 /**
  * Class for FIR filter with configurable coefficients.
@@ -94,4 +95,261 @@ private:
     size_t                        pos;     ///< Current position in history.
 };
 
+/**
+ * Convert a floating point value in the range [-1, 1) to Q15 fixed point
+ * format, with rounding to the nearest integer and saturation.
+ *
+ * @param value: value to be converted.
+ * @return Q15 representation of the input value.
+ */
+static constexpr int16_t toQ15(const float value)
+{
+    return (value >=  1.0f) ? INT16_MAX
+         : (value <= -1.0f) ? INT16_MIN
+         : static_cast< int16_t >(value * 32768.0f + ((value >= 0.0f) ? 0.5f : -0.5f));
+}
+
+template < size_t N, size_t... I >
+static constexpr std::array< int16_t, N > toQ15(const std::array< float, N >& values,
+                                                std::index_sequence< I... >)
+{
+    return {{ toQ15(values[I])... }};
+}
+
+/**
+ * Convert an array of floating point values in the range [-1, 1) to Q15
+ * fixed point format. Meant to be used at compile time to obtain the integer
+ * coefficients of a FIR filter.
+ *
+ * @param values: values to be converted.
+ * @return array of Q15 values.
+ */
+template < size_t N >
+static constexpr std::array< int16_t, N > toQ15(const std::array< float, N >& values)
+{
+    return toQ15(values, std::make_index_sequence< N >{});
+}
+
+/**
+ * Compute the sum of the absolute values of a set of Q15 coefficients, that is
+ * the maximum gain of the corresponding FIR filter. The 32 bit accumulator of
+ * the fixed point filters cannot overflow as long as this value is below 65536.
+ *
+ * @param taps: Q15 filter coefficients.
+ * @return sum of the absolute values of the coefficients.
+ */
+template < size_t N >
+static constexpr int32_t q15AbsSum(const std::array< int16_t, N >& taps)
+{
+    int32_t sum = 0;
+    for(size_t i = 0; i < N; i++)
+        sum += (taps[i] < 0) ? -taps[i] : taps[i];
+
+    return sum;
+}
+
+/**
+ * Compute the largest sum of the absolute values of the coefficients of a
+ * single branch of a polyphase interpolator by L, that is its maximum gain.
+ * The 32 bit accumulator of InterpolatorQ15 cannot overflow as long as this
+ * value is below 65536.
+ *
+ * @param taps: Q15 filter coefficients.
+ * @return largest sum of the absolute values of the branch coefficients.
+ */
+template < size_t L, size_t N >
+static constexpr int32_t q15PhaseAbsSum(const std::array< int16_t, N >& taps)
+{
+    int32_t max = 0;
+    for(size_t p = 0; p < L; p++)
+    {
+        int32_t sum = 0;
+        for(size_t i = p; i < N; i += L)
+            sum += (taps[i] < 0) ? -taps[i] : taps[i];
+
+        if(sum > max)
+            max = sum;
+    }
+
+    return max;
+}
+
+/**
+ * Class for FIR filter with Q15 fixed point coefficients, operating on 16 bit
+ * samples with a 32 bit accumulator. Every input sample is stored twice in a
+ * history buffer of double length, so that the last N samples are always
+ * available as a contiguous block and the inner loop runs without wrapping
+ * the index.
+ */
+template < size_t N >
+class FirQ15
+{
+public:
+
+    /**
+     * Constructor.
+     *
+     * @param taps: reference to a std::array of Q15 values representing the
+     * FIR filter coefficients.
+     */
+    FirQ15(const std::array< int16_t, N >& taps) : pos(0)
+    {
+        // Coefficients are stored in reverse order, so that the inner loop
+        // walks both arrays forward.
+        for(size_t i = 0; i < N; i++)
+            revTaps[i] = taps[N - 1 - i];
+
+        reset();
+    }
+
+    /**
+     * Destructor.
+     */
+    ~FirQ15() { }
+
+    /**
+     * Perform one step of the FIR filter, computing a new output value given
+     * the input value and the history of previous input values.
+     *
+     * @param input: FIR input value for the current time step.
+     * @return FIR output as a function of the current and past input values.
+     */
+    int16_t operator()(const int16_t input)
+    {
+        hist[pos]     = input;
+        hist[pos + N] = input;
+
+        // Last N inputs, from the oldest to the current one
+        const int16_t *x   = &hist[pos + 1];
+        int32_t        acc = 0;
+
+        for(size_t i = 0; i < N; i++)
+            acc += static_cast< int32_t >(revTaps[i]) * x[i];
+
+        pos += 1;
+        if(pos >= N) pos = 0;
+
+        acc = (acc + (1 << 14)) >> 15;
+        if(acc > INT16_MAX) acc = INT16_MAX;
+        if(acc < INT16_MIN) acc = INT16_MIN;
+
+        return static_cast< int16_t >(acc);
+    }
+
+    /**
+     * Filter a block of samples. Input and output buffers can be the same.
+     *
+     * @param input: pointer to the input samples.
+     * @param output: pointer to the destination buffer for the filtered samples.
+     * @param len: number of samples to be processed.
+     */
+    void process(const int16_t *input, int16_t *output, const size_t len)
+    {
+        for(size_t i = 0; i < len; i++)
+            output[i] = (*this)(input[i]);
+    }
+
+    /**
+     * Reset FIR history, clearing the memory of past values.
+     */
+    void reset()
+    {
+        hist.fill(0);
+        pos = 0;
+    }
+
+private:
+
+    std::array< int16_t, N >     revTaps;    ///< FIR filter coefficients, reversed.
+    std::array< int16_t, 2 * N > hist;       ///< History of past inputs, stored twice.
+    size_t                       pos;        ///< Current position in history.
+};
+
+/**
+ * Polyphase FIR interpolator with Q15 fixed point coefficients. Each input
+ * sample produces L output samples, as if the input was zero-stuffed by a
+ * factor L and filtered by an N taps FIR filter, but without ever multiplying
+ * the stuffed zeroes: the coefficients are split in L branches of N/L taps
+ * each, one for every output phase.
+ */
+template < size_t N, size_t L >
+class InterpolatorQ15
+{
+public:
+
+    /**
+     * Constructor.
+     *
+     * @param taps: reference to a std::array of Q15 values representing the
+     * coefficients of the interpolation filter.
+     */
+    InterpolatorQ15(const std::array< int16_t, N >& taps) : pos(0)
+    {
+        // Branch p holds the coefficients p, p + L, p + 2L, ... padded with
+        // zeroes when N is not a multiple of L, stored in reverse order.
+        for(size_t p = 0; p < L; p++)
+        {
+            for(size_t k = 0; k < K; k++)
+            {
+                size_t idx           = p + (k * L);
+                phases[p][K - 1 - k] = (idx < N) ? taps[idx] : 0;
+            }
+        }
+
+        reset();
+    }
+
+    /**
+     * Destructor.
+     */
+    ~InterpolatorQ15() { }
+
+    /**
+     * Perform one step of the interpolator, computing L new output values
+     * given the input value and the history of previous input values.
+     * Output values are the raw 32 bit accumulators, scaled by 2^15: scaling
+     * and conversion to the final sample format is left to the caller.
+     *
+     * @param input: interpolator input value for the current time step.
+     * @param output: pointer to the destination buffer for the L output values.
+     */
+    void operator()(const int16_t input, int32_t *output)
+    {
+        hist[pos]     = input;
+        hist[pos + K] = input;
+
+        // Last K inputs, from the oldest to the current one
+        const int16_t *x = &hist[pos + 1];
+
+        for(size_t p = 0; p < L; p++)
+        {
+            int32_t acc = 0;
+            for(size_t k = 0; k < K; k++)
+                acc += static_cast< int32_t >(phases[p][k]) * x[k];
+
+            output[p] = acc;
+        }
+
+        pos += 1;
+        if(pos >= K) pos = 0;
+    }
+
+    /**
+     * Reset interpolator history, clearing the memory of past values.
+     */
+    void reset()
+    {
+        hist.fill(0);
+        pos = 0;
+    }
+
+private:
+
+    static constexpr size_t K = (N + L - 1) / L;    ///< Taps per branch.
+
+    std::array< std::array< int16_t, K >, L > phases;    ///< Polyphase coefficients.
+    std::array< int16_t, 2 * K >              hist;      ///< History of past inputs, stored twice.
+    size_t                                    pos;       ///< Current position in history.
+};
+
 #endif /* DSP_H */
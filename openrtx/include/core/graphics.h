@@ -122,6 +122,8 @@ void gfx_renderRows(uint8_t startRow, uint8_t endRow);
  * This function calls the correspondent method of the low level interface display.h
  * Copy framebuffer content to the display internal buffer. To be called
  * whenever there is need to update the display.
+ * On color displays only the rows modified since the previous call are
+ * copied, nothing is done if the framebuffer has not been modified.
  */
 void gfx_render();
 
@@ -138,7 +140,7 @@ bool gfx_renderingInProgress();
  * This results in a black screen on color displays
  * And a white screen on B/W displays
  * @param startRow: first row of the framebuffer section to be cleared
- * @param endRow: last row of the framebuffer section to be cleared
+ * @param endRow: row following the last one of the section to be cleared
  */
 void gfx_clearRows(uint8_t startRow, uint8_t endRow);
 
@@ -213,6 +215,15 @@ void gfx_drawCircle(point_t start, uint16_t r, color_t color);
  */
 uint8_t gfx_getFontHeight(fontSize_t size);
 
+/**
+ * Compute the width of the first line of a text string, that is the space
+ * taken when printed with gfx_print().
+ * @param size: text font size, defined as enum.
+ * @param text: text string.
+ * @return text width, in pixels.
+ */
+uint16_t gfx_getTextWidth(fontSize_t size, const char *text);
+
 /**
  * Prints text on the screen at the specified coordinates.
  * Reads text from a given char buffer
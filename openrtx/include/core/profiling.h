@@ -0,0 +1,166 @@
+/***************************************************************************
+ *   Copyright (C) 2023 by Federico Amedeo Izzo IU2NUO,                    *
+ *                         Niccolò Izzo IU2KIN                             *
+ *                         Frederik Saraci IU2NRO                          *
+ *                         Silvano Seva IU2KWO                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+#ifndef PROFILING_H
+#define PROFILING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Execution time probes for the real time parts of the firmware. Each probe
+ * measures the time spent between its start and stop points and aggregates
+ * it in minimum, average and maximum values, plus an histogram.
+ * Time is measured with the DWT cycle counter on Cortex-M devices and with
+ * the monotonic clock on Linux.
+ *
+ * Probes are compiled only when ENABLE_PROFILING is defined, otherwise the
+ * PROF_* macros expand to nothing.
+ */
+
+/**
+ * Enumeration type for the available probes.
+ */
+enum ProfProbe
+{
+    PROF_RTX_TASK = 0,    ///< rtx_task(), including the wait for new samples
+    PROF_M17_DEMOD,       ///< M17Demodulator::update(), excluding the wait
+    PROF_M17_FILTER,      ///< M17 demodulator, DC removal and RRC filter
+    PROF_M17_SYNC,        ///< M17 demodulator, syncword search
+    PROF_M17_SYMBOLS,     ///< M17 demodulator, whole block, sync search included
+    PROF_M17_DECODE,      ///< M17FrameDecoder::decodeFrame()
+    PROF_M17_VITERBI,     ///< Viterbi decoding of a single frame
+    PROF_CODEC2_ENCODE,   ///< codec2_encode()
+    PROF_CODEC2_DECODE,   ///< codec2_decode()
+    PROF_UI_UPDATE,       ///< ui_updateGUI()
+
+    PROF_NUM_PROBES
+};
+
+/**
+ * Number of histogram bins. The first bin counts the measurements below
+ * 32us, each one of the following ones has double the upper limit of the
+ * previous one and the last one counts all the measurements above 8ms.
+ */
+#define PROF_HIST_BINS 10
+
+/**
+ * Execution time statistics of a probe, times are in microseconds.
+ */
+typedef struct
+{
+    uint32_t count;                   ///< Number of measurements
+    uint32_t min;                     ///< Minimum time
+    uint32_t avg;                     ///< Average time
+    uint32_t max;                     ///< Maximum time
+    uint32_t hist[PROF_HIST_BINS];    ///< Histogram of the measured times
+}
+profStats_t;
+
+/**
+ * Initialise the time counter used by the probes and clear their statistics.
+ */
+void prof_init();
+
+/**
+ * Get the current value of the time counter used by the probes. The unit of
+ * measurement is platform dependent and the counter wraps around, only the
+ * difference between two values is meaningful.
+ *
+ * @return current value of the time counter.
+ */
+uint32_t prof_getTicks();
+
+/**
+ * Record the end of a measurement.
+ *
+ * @param probe: probe identifier.
+ * @param start: value of the time counter at the beginning of the measurement.
+ */
+void prof_record(const enum ProfProbe probe, const uint32_t start);
+
+/**
+ * Get the statistics of a probe. Probes are updated without locking, the
+ * values may be slightly inconsistent if read during an update.
+ *
+ * @param probe: probe identifier.
+ * @param stats: pointer to the destination structure.
+ * @return false if the probe does not exist.
+ */
+bool prof_getStats(const enum ProfProbe probe, profStats_t *stats);
+
+/**
+ * Get the name of a probe.
+ *
+ * @param probe: probe identifier.
+ * @return probe name or NULL if the probe does not exist.
+ */
+const char *prof_getName(const enum ProfProbe probe);
+
+/**
+ * Clear the statistics of all the probes.
+ */
+void prof_reset();
+
+#ifdef ENABLE_PROFILING
+#define PROF_START(var)         uint32_t var = prof_getTicks()
+#define PROF_STOP(probe, var)   prof_record(probe, var)
+#else
+#define PROF_START(var)
+#define PROF_STOP(probe, var)
+#endif
+
+#ifdef __cplusplus
+}
+
+/**
+ * Probe measuring the time spent in the enclosing scope.
+ */
+class ProfScope
+{
+public:
+
+    ProfScope(const enum ProfProbe probe) : probe(probe), start(prof_getTicks())
+    { }
+
+    ~ProfScope()
+    {
+        prof_record(probe, start);
+    }
+
+private:
+
+    const enum ProfProbe probe;
+    const uint32_t       start;
+};
+
+#ifdef ENABLE_PROFILING
+#define PROF_SCOPE(probe)   ProfScope _profScope(probe)
+#else
+#define PROF_SCOPE(probe)
+#endif
+
+#endif /* __cplusplus */
+
+#endif /* PROFILING_H */
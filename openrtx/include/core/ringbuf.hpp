@@ -27,6 +27,9 @@
 
 #include <pthread.h>
 #include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <algorithm>
 
 /**
  * Class implementing a statically allocated circular buffer with blocking and
@@ -187,4 +190,318 @@ private:
     pthread_cond_t  not_full;   ///< Queue not full condition.
 };
 
+/**
+ * Lock-free circular buffer for a single producer and a single consumer.
+ * Producer and consumer each own one of the two indices and synchronise only
+ * through atomic loads and stores, thus none of them can be blocked by the
+ * other one: this makes the buffer suitable for passing data out of real-time
+ * threads without the risk of priority inversion.
+ *
+ * Push functions must be called only by the producer, pop and erase functions
+ * only by the consumer. Capacity must be a power of two.
+ */
+template < typename T, size_t N >
+class SpscRingBuffer
+{
+public:
+
+    /**
+     * Constructor.
+     */
+    SpscRingBuffer() : readPos(0), writePos(0)
+    {
+        static_assert((N != 0) && ((N & (N - 1)) == 0),
+                      "Buffer size must be a power of two");
+    }
+
+    /**
+     * Destructor.
+     */
+    ~SpscRingBuffer() { }
+
+    /**
+     * Push an element to the buffer, producer side.
+     *
+     * @param elem: element to be pushed.
+     * @return true if the element has been successfully pushed to the queue,
+     * false if the queue is full.
+     */
+    bool push(const T& elem)
+    {
+        size_t wr = writePos.load(std::memory_order_relaxed);
+        size_t rd = readPos.load(std::memory_order_acquire);
+
+        if((wr - rd) >= N)
+            return false;
+
+        data[wr & MASK] = elem;
+        writePos.store(wr + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    /**
+     * Push a block of elements to the buffer, producer side. Elements are
+     * copied in at most two contiguous chunks.
+     *
+     * @param elems: pointer to the elements to be pushed.
+     * @param count: number of elements to be pushed.
+     * @return number of elements actually pushed, less than count if the queue
+     * does not have enough free space.
+     */
+    size_t push(const T *elems, const size_t count)
+    {
+        size_t wr   = writePos.load(std::memory_order_relaxed);
+        size_t rd   = readPos.load(std::memory_order_acquire);
+        size_t free = N - (wr - rd);
+        size_t num  = (count < free) ? count : free;
+
+        size_t pos   = wr & MASK;
+        size_t first = ((N - pos) < num) ? (N - pos) : num;
+
+        std::copy(elems, elems + first, &data[pos]);
+        std::copy(elems + first, elems + num, &data[0]);
+        writePos.store(wr + num, std::memory_order_release);
+
+        return num;
+    }
+
+    /**
+     * Pop an element from the buffer, consumer side.
+     *
+     * @param elem: place where to store the popped element.
+     * @return true if the element has been successfully popped from the queue,
+     * false if the queue is empty.
+     */
+    bool pop(T& elem)
+    {
+        size_t rd = readPos.load(std::memory_order_relaxed);
+        size_t wr = writePos.load(std::memory_order_acquire);
+
+        if(wr == rd)
+            return false;
+
+        elem = data[rd & MASK];
+        readPos.store(rd + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    /**
+     * Pop a block of elements from the buffer, consumer side. Elements are
+     * copied out in at most two contiguous chunks.
+     *
+     * @param elems: destination buffer for the popped elements.
+     * @param count: maximum number of elements to be popped.
+     * @return number of elements actually popped.
+     */
+    size_t pop(T *elems, const size_t count)
+    {
+        size_t rd    = readPos.load(std::memory_order_relaxed);
+        size_t wr    = writePos.load(std::memory_order_acquire);
+        size_t avail = wr - rd;
+        size_t num   = (count < avail) ? count : avail;
+
+        size_t pos   = rd & MASK;
+        size_t first = ((N - pos) < num) ? (N - pos) : num;
+
+        std::copy(&data[pos], &data[pos] + first, elems);
+        std::copy(&data[0], &data[0] + (num - first), elems + first);
+        readPos.store(rd + num, std::memory_order_release);
+
+        return num;
+    }
+
+    /**
+     * Discard one element from the buffer's tail, consumer side.
+     */
+    void eraseElement()
+    {
+        size_t rd = readPos.load(std::memory_order_relaxed);
+        size_t wr = writePos.load(std::memory_order_acquire);
+
+        if(wr != rd)
+            readPos.store(rd + 1, std::memory_order_release);
+    }
+
+    /**
+     * Get the number of elements currently present in the buffer. The value
+     * is exact only when called by the producer or by the consumer, as a lower
+     * or upper bound respectively.
+     *
+     * @return number of elements in the buffer.
+     */
+    size_t size() const
+    {
+        size_t rd = readPos.load(std::memory_order_acquire);
+        size_t wr = writePos.load(std::memory_order_acquire);
+
+        return wr - rd;
+    }
+
+    /**
+     * Check if the buffer is empty.
+     *
+     * @return true if the buffer is empty.
+     */
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+    /**
+     * Check if the buffer is full.
+     *
+     * @return true if the buffer is full.
+     */
+    bool full() const
+    {
+        return size() >= N;
+    }
+
+protected:
+
+    static constexpr size_t MASK = N - 1;
+
+    std::atomic< size_t > readPos;   ///< Read counter, owned by the consumer.
+    std::atomic< size_t > writePos;  ///< Write counter, owned by the producer.
+    T data[N];                       ///< Data storage.
+};
+
+/**
+ * Lock-free single producer, single consumer circular buffer with optional
+ * blocking push and pop. Non-blocking operations never take the mutex, which
+ * is used only when one of the two sides has to wait: the producer or the
+ * consumer signal the other side only if it is actually waiting.
+ */
+template < typename T, size_t N >
+class BlockingSpscRingBuffer : public SpscRingBuffer< T, N >
+{
+public:
+
+    /**
+     * Constructor.
+     */
+    BlockingSpscRingBuffer()
+    {
+        producer.waiting = false;
+        consumer.waiting = false;
+        pthread_mutex_init(&mutex, NULL);
+        pthread_cond_init(&producer.cond, NULL);
+        pthread_cond_init(&consumer.cond, NULL);
+    }
+
+    /**
+     * Destructor.
+     */
+    ~BlockingSpscRingBuffer()
+    {
+        pthread_mutex_destroy(&mutex);
+        pthread_cond_destroy(&producer.cond);
+        pthread_cond_destroy(&consumer.cond);
+    }
+
+    /**
+     * Push an element to the buffer, producer side.
+     *
+     * @param elem: element to be pushed.
+     * @param blocking: if set to true, when the buffer is full this function
+     * blocks the execution flow until at least one empty slot is available.
+     * @return true if the element has been successfully pushed to the queue,
+     * false if the queue is full.
+     */
+    bool push(const T& elem, bool blocking)
+    {
+        bool ok = Base::push(elem);
+
+        if((ok == false) && blocking)
+        {
+            wait(producer, [this] { return Base::full() == false; });
+            ok = Base::push(elem);
+        }
+
+        if(ok) wakeup(consumer);
+        return ok;
+    }
+
+    /**
+     * Pop an element from the buffer, consumer side.
+     *
+     * @param elem: place where to store the popped element.
+     * @param blocking: if set to true, when the buffer is empty this function
+     * blocks the execution flow until at least one element is available.
+     * @return true if the element has been successfully popped from the queue,
+     * false if the queue is empty.
+     */
+    bool pop(T& elem, bool blocking)
+    {
+        bool ok = Base::pop(elem);
+
+        if((ok == false) && blocking)
+        {
+            wait(consumer, [this] { return Base::empty() == false; });
+            ok = Base::pop(elem);
+        }
+
+        if(ok) wakeup(producer);
+        return ok;
+    }
+
+private:
+
+    using Base = SpscRingBuffer< T, N >;
+
+    /**
+     * Wait state of one of the two sides.
+     */
+    struct Waiter
+    {
+        std::atomic< bool > waiting;  ///< Side is waiting on the condition.
+        pthread_cond_t      cond;     ///< Progress condition.
+    };
+
+    /**
+     * Wait until a condition becomes true.
+     *
+     * @param self: wait state of the calling side.
+     * @param ready: condition to wait for.
+     */
+    template < typename F >
+    void wait(Waiter& self, F ready)
+    {
+        pthread_mutex_lock(&mutex);
+
+        // Flag must be visible before checking the condition, so that either
+        // this thread sees the other side progress or the other side sees the
+        // flag and signals the condition variable.
+        self.waiting.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        while(ready() == false)
+            pthread_cond_wait(&self.cond, &mutex);
+
+        self.waiting.store(false, std::memory_order_relaxed);
+        pthread_mutex_unlock(&mutex);
+    }
+
+    /**
+     * Wake up the other side, if waiting.
+     *
+     * @param other: wait state of the side to be woken up.
+     */
+    void wakeup(Waiter& other)
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if(other.waiting.load(std::memory_order_relaxed) == false)
+            return;
+
+        pthread_mutex_lock(&mutex);
+        pthread_cond_signal(&other.cond);
+        pthread_mutex_unlock(&mutex);
+    }
+
+    Waiter          producer;  ///< Producer waiting for free space.
+    Waiter          consumer;  ///< Consumer waiting for data.
+    pthread_mutex_t mutex;     ///< Mutex for the condition variables.
+};
+
 #endif  // RINGBUF_H
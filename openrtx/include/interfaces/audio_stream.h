@@ -83,6 +83,57 @@ streamId inputStream_start(const enum AudioSource source,
  */
 dataBlock_t inputStream_getData(streamId id);
 
+/**
+ * Start the acquisition of an incoming audio stream in circular double buffer
+ * mode, reserving a history region at the head of the buffer. Each data block
+ * returned by inputStream_acquire() is preceded in memory by the history
+ * region, containing the last samples of the previous block as they were left
+ * by the consumer when releasing it: consumers processing the blocks in place
+ * can look back at the previous data without copying it.
+ * The history region is cleared when the stream is started.
+ * The history of the blocks in the second half of the buffer lies at the end
+ * of the first half: it is valid until the acquisition of the first half
+ * reaches it again.
+ *
+ * Buffer layout: | history | first half | second half |
+ *
+ * @param source: input source specifier.
+ * @param prio: priority of the requester.
+ * @param buf: pointer to a buffer used for management of sampled data.
+ * @param bufLength: length of the buffer, in elements, history included.
+ * @param history: length of the history region, in elements, not greater
+ * than half of the remaining part of the buffer.
+ * @param sampleRate: sample rate, in Hz.
+ * @return a unique identifier for the stream or -1 if the stream could not be
+ * opened.
+ */
+streamId inputStream_startWithHistory(const enum AudioSource source,
+                                      const enum AudioPriority prio,
+                                      stream_sample_t * const buf,
+                                      const size_t bufLength,
+                                      const size_t history,
+                                      const uint32_t sampleRate);
+
+/**
+ * Acquire the next data block from an input stream opened with
+ * inputStream_startWithHistory(), blocking function. The block is owned by
+ * the caller, which can modify its content, until inputStream_release() is
+ * called. Only one block at a time can be acquired.
+ *
+ * @param id: identifier of the stream from which data is get.
+ * @return dataBlock_t containing a pointer to the block head and its length,
+ * or < NULL, 0 > if the stream has been stopped.
+ */
+dataBlock_t inputStream_acquire(streamId id);
+
+/**
+ * Release the data block previously acquired, making its last samples the
+ * history of the next block.
+ *
+ * @param id: identifier of the stream.
+ */
+void inputStream_release(streamId id);
+
 /**
  * Release the current input stream, allowing for a new call of startInputStream.
  * If this function is called when sampler is running, acquisition is stopped
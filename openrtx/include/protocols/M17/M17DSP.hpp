@@ -86,10 +86,23 @@ static constexpr std::array<float, 41> rrc_taps_24k =
 };
 
 /*
- * FIR implementations of the RRC filter for baseband audio generation.
+ * Coefficients for M17 RRC filters, in Q15 fixed point format.
  */
-extern Fir< std::tuple_size< decltype(rrc_taps_48k) >::value > rrc_48k;
-extern Fir< std::tuple_size< decltype(rrc_taps_24k) >::value > rrc_24k;
+static constexpr auto rrc_taps_48k_q15 = toQ15(rrc_taps_48k);
+static constexpr auto rrc_taps_24k_q15 = toQ15(rrc_taps_24k);
+
+static_assert(q15AbsSum(rrc_taps_24k_q15) < 65536,
+              "RX RRC filter may overflow the accumulator");
+static_assert(q15PhaseAbsSum< 10 >(rrc_taps_48k_q15) < 65536,
+              "TX RRC interpolator may overflow the accumulator");
+
+/*
+ * Fixed point implementations of the RRC filter: polyphase interpolator by
+ * ten for baseband generation at 48kHz and FIR filter for baseband reception
+ * at 24kHz.
+ */
+extern InterpolatorQ15< std::tuple_size< decltype(rrc_taps_48k) >::value, 10 > rrc_48k;
+extern FirQ15< std::tuple_size< decltype(rrc_taps_24k) >::value > rrc_24k;
 
 } /* M17 */
 
@@ -38,6 +38,13 @@ using lich_t    = std::array< uint8_t, 12 >;   // Data type for Golay(24,12) enc
 using frame_t   = std::array< uint8_t, 48 >;   // Data type for a full M17 data frame, including sync word
 using syncw_t   = std::array< uint8_t, 2  >;   // Data type for a sync word
 
+/**
+ * Data type for a full M17 data frame, including sync word, stored as one soft
+ * bit per element. Soft bits range from 0x0000 (strong zero) to 0xFFFF (strong
+ * one), with 0x7FFF meaning "no information", as required by M17SoftViterbi.
+ */
+using softframe_t = std::array< uint16_t, 384 >;
+
 /**
  * This structure provides bit field definitions for the "TYPE" field
  * contained in an M17 Link Setup Frame.
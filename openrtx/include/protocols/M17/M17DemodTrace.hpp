@@ -0,0 +1,196 @@
+/***************************************************************************
+ *   Copyright (C) 2023 by Federico Amedeo Izzo IU2NUO,                    *
+ *                         Niccolò Izzo IU2KIN                             *
+ *                         Frederik Saraci IU2NRO                          *
+ *                         Silvano Seva IU2KWO                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+#ifndef M17_DEMODTRACE_H
+#define M17_DEMODTRACE_H
+
+#ifndef __cplusplus
+#error This header is C++ only!
+#endif
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <atomic>
+#include <pthread.h>
+#include <ringbuf.hpp>
+
+namespace M17
+{
+
+/**
+ * Trace channels, used as a bit mask to select the records to be traced.
+ */
+enum TraceChannel : uint8_t
+{
+    TRACE_CORR   = 0x01,    ///< Syncword correlation, one record per sample.
+    TRACE_QNT    = 0x02,    ///< Quantizer thresholds, one record per syncword.
+    TRACE_SYMBOL = 0x04,    ///< Symbol sampling, one record per symbol.
+    TRACE_ALL    = 0x07
+};
+
+/**
+ * Record types.
+ */
+enum TraceRecord : uint8_t
+{
+    TRACE_REC_BLOCK  = 0,   ///< Start of a block: a = length, b = dropped records.
+    TRACE_REC_CORR   = 1,   ///< a = stream syncword correlation, b = threshold.
+    TRACE_REC_QNT    = 2,   ///< a = positive threshold, b = negative threshold, sample = syncword errors.
+    TRACE_REC_SYMBOL = 3    ///< a = symbol, b = symbol index in the frame.
+};
+
+/**
+ * Trace stream header, sent when the trace is started.
+ */
+typedef struct
+{
+    char     magic[4];      ///< "M17T"
+    uint8_t  version;       ///< Trace format version.
+    uint8_t  channels;      ///< Enabled channels.
+    uint8_t  recordSize;    ///< Size of a record, in bytes.
+    uint8_t  _empty;
+    uint32_t sampleRate;    ///< Sample rate of the traced baseband, in Hz.
+    uint32_t recordRate;    ///< Maximum number of records per second, 0 if unlimited.
+}
+__attribute__((packed)) traceHeader_t;
+
+/**
+ * Trace record, the meaning of the a and b fields depends on the type.
+ */
+typedef struct
+{
+    uint8_t  type;          ///< Record type.
+    uint8_t  flags;         ///< Demodulator flags, bit 0 set when locked.
+    int16_t  sample;        ///< Filtered baseband sample.
+    int32_t  index;         ///< Absolute sample index, from the trace start.
+    int32_t  a;
+    int32_t  b;
+}
+__attribute__((packed)) traceRecord_t;
+
+/**
+ * Binary trace of the M17 demodulator internals. Records are pushed by the
+ * demodulator without locking or blocking, a low priority writer thread
+ * periodically sends them in large batches either to a file (Linux) or to
+ * the USB virtual COM port.
+ * Records exceeding the configured rate, or not fitting in the queue, are
+ * dropped and their number reported in the next block record. The rate limit
+ * is computed on the number of traced samples, so that the amount of records
+ * does not depend on the writer speed.
+ */
+class M17DemodTrace
+{
+public:
+
+    /**
+     * Constructor.
+     */
+    M17DemodTrace();
+
+    /**
+     * Destructor.
+     */
+    ~M17DemodTrace();
+
+    /**
+     * Start the trace, sending the stream header and starting the writer
+     * thread. On Linux the enabled channels, the maximum record rate and the
+     * destination file are taken from the OPENRTX_DEMOD_TRACE,
+     * OPENRTX_DEMOD_TRACE_RATE and OPENRTX_DEMOD_TRACE_FILE environment
+     * variables.
+     *
+     * @param sampleRate: sample rate of the traced baseband, in Hz.
+     */
+    void start(const uint32_t sampleRate);
+
+    /**
+     * Stop the trace, sending all the pending records.
+     */
+    void stop();
+
+    /**
+     * Mark the beginning of a new block of samples, indices of the following
+     * records are relative to it.
+     *
+     * @param len: length of the block, in samples.
+     * @param locked: demodulator lock status.
+     */
+    void newBlock(const size_t len, const bool locked);
+
+    /**
+     * @param channel: trace channel.
+     * @return true if the trace is running and the channel is enabled.
+     */
+    inline bool enabled(const TraceChannel channel) const
+    {
+        return (channels & channel) != 0;
+    }
+
+    /**
+     * Push a record to the trace, non blocking.
+     *
+     * @param type: record type.
+     * @param flags: demodulator flags.
+     * @param sample: filtered baseband sample.
+     * @param index: sample index, relative to the current block.
+     * @param a: first record field.
+     * @param b: second record field.
+     */
+    void push(const TraceRecord type, const uint8_t flags, const int16_t sample,
+              const int32_t index, const int32_t a, const int32_t b);
+
+private:
+
+    #ifdef PLATFORM_LINUX
+    static constexpr size_t QUEUE_SIZE = 16384;
+    #else
+    static constexpr size_t QUEUE_SIZE = 512;
+    #endif
+
+    static constexpr size_t BATCH_SIZE = 128;     ///< Records per write.
+
+    /**
+     * Writer thread, sends the queued records in batches.
+     */
+    static void *writerFunc(void *arg);
+
+    /**
+     * Send a chunk of data to the trace destination.
+     */
+    void write(const void *data, const size_t len);
+
+    SpscRingBuffer< traceRecord_t, QUEUE_SIZE > queue;
+
+    std::atomic< bool > running;     ///< Writer thread running.
+    pthread_t           writer;      ///< Writer thread.
+    FILE               *output;      ///< Destination file, Linux only.
+    uint8_t             channels;    ///< Enabled channels, zero if stopped.
+    uint32_t            sampleRate;  ///< Baseband sample rate.
+    uint32_t            rate;        ///< Maximum record rate, 0 if unlimited.
+    uint64_t            budget;      ///< Records left before the rate limit, times the sample rate.
+    int32_t             blockStart;  ///< Absolute index of the current block.
+    uint32_t            blockLen;    ///< Length of the current block.
+    uint32_t            dropped;     ///< Records dropped since the last block.
+};
+
+} /* M17 */
+
+#endif /* M17_DEMODTRACE_H */
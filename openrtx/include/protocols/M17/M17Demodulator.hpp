@@ -41,13 +41,29 @@
 namespace M17
 {
 
+/**
+ * Syncword types recognised by the demodulator, also used as index for the
+ * array of syncword correlations.
+ */
+enum SyncType : uint8_t
+{
+    SYNC_LSF    = 0,    ///< Link Setup Frame syncword.
+    SYNC_STREAM = 1,    ///< Stream frame syncword.
+    SYNC_PACKET = 2,    ///< Packet frame syncword.
+    SYNC_BERT   = 3,    ///< BERT frame syncword.
+    SYNC_NUM    = 4
+};
+
 typedef struct
 {
-    int32_t index;
-    bool lsf;
+    int32_t  index;     ///< Sample index of the correlation peak.
+    SyncType type;      ///< Syncword type.
+    float    offset;    ///< Fractional position of the peak, in samples.
 }
 sync_t;
 
+using corr_t = std::array< int32_t, SYNC_NUM >;
+
 class M17Demodulator
 {
 public:
@@ -90,6 +106,15 @@ public:
      */
     const frame_t& getFrame();
 
+    /**
+     * Returns the last frame decoded from the baseband signal in soft bit
+     * form, suitable for soft decision decoding.
+     *
+     * @return reference to the internal data structure containing the last
+     * decoded frame, one soft bit per element.
+     */
+    const softframe_t& getSoftFrame();
+
     /**
      * @return true if the last decoded frame is an LSF.
      */
@@ -128,35 +153,35 @@ private:
     static constexpr size_t  M17_FRAME_SAMPLES      = M17_FRAME_SYMBOLS * M17_SAMPLES_PER_SYMBOL;
     static constexpr size_t  M17_SAMPLE_BUF_SIZE    = M17_FRAME_SAMPLES / 2;
     static constexpr size_t  M17_SYNCWORD_SAMPLES   = M17_SAMPLES_PER_SYMBOL * M17_SYNCWORD_SYMBOLS;
-    static constexpr int8_t  SYNC_SWEEP_WIDTH       = 10;
-    static constexpr int8_t  SYNC_SWEEP_OFFSET      = ceil(SYNC_SWEEP_WIDTH / M17_SAMPLES_PER_SYMBOL);
-    static constexpr int16_t M17_BRIDGE_SIZE        = M17_SYNCWORD_SAMPLES + 2 * SYNC_SWEEP_WIDTH;
+    // Samples kept from the previous block: a whole syncword, plus the margin
+    // needed by the symbol interpolator and the timing error detector.
+    static constexpr int16_t M17_BRIDGE_SIZE        = M17_SYNCWORD_SAMPLES + 3 * M17_SAMPLES_PER_SYMBOL;
 
     static constexpr float  CONV_STATS_ALPHA       = 0.005f;
     static constexpr float  CONV_THRESHOLD_FACTOR  = 3.40;
     static constexpr int16_t QNT_SMA_WINDOW        = 8;
 
-    /**
-     * M17 syncwords;
-     */
-    int8_t  lsf_syncword[M17_SYNCWORD_SYMBOLS]    = { +3, +3, +3, +3, -3, -3, +3, -3 };
-    int8_t  stream_syncword[M17_SYNCWORD_SYMBOLS] = { -3, -3, -3, -3, +3, +3, -3, +3 };
+    static constexpr float  TED_LOOP_KP            = 0.12f;   ///< Proportional gain of the timing loop.
+    static constexpr float  TED_LOOP_KI            = 0.002f;  ///< Integral gain of the timing loop.
 
     /*
      * Buffers
      */
-    std::unique_ptr< int16_t[] > baseband_buffer; ///< Buffer for baseband audio handling.
+    std::unique_ptr< int16_t[] > baseband_buffer; ///< Buffer for baseband audio handling, history included.
     streamId                     basebandId;      ///< Id of the baseband input stream.
     pathId                       basebandPath;    ///< Id of the baseband input path.
     dataBlock_t                  baseband;        ///< Data block with samples to be processed.
     uint16_t                     frame_index;     ///< Index for filling the raw frame.
     std::unique_ptr<frame_t >    demodFrame;      ///< Frame being demodulated.
     std::unique_ptr<frame_t >    readyFrame;      ///< Fully demodulated frame to be returned.
+    std::unique_ptr<softframe_t> demodSoftFrame;  ///< Soft bits of the frame being demodulated.
+    std::unique_ptr<softframe_t> readySoftFrame;  ///< Soft bits of the fully demodulated frame.
     bool                         syncDetected;    ///< A syncword was detected.
     bool                         locked;          ///< A syncword was correctly demodulated.
     bool                         newFrame;        ///< A new frame has been fully decoded.
-    int16_t                      basebandBridge[M17_BRIDGE_SIZE] = { 0 }; ///< Bridge buffer
-    int16_t                      phase;           ///< Phase of the signal w.r.t. sampling
+    int16_t                      *samples;        ///< Filtered samples of the current block, preceded by the tail of the previous one.
+    int16_t                      phase;           ///< Index of the next symbol sample in the current block.
+    int16_t                      syncIndex;       ///< Index of the syncword being demodulated.
     bool                         invPhase;        ///< Invert signal phase
 
     /*
@@ -179,6 +204,13 @@ private:
     float qnt_pos_avg = 0.0f;      ///< Rolling average of positive samples
     float qnt_neg_avg = 0.0f;      ///< Rolling average of negative samples
 
+    /*
+     * Symbol timing recovery
+     */
+    float        timing;           ///< Fractional part of the symbol sampling instant
+    float        timingInteg;      ///< Integrator of the timing loop filter
+    float        prevSymbol;       ///< Previous symbol sample, for timing error detection
+
     /*
      * DSP filter state
      */
@@ -215,44 +247,83 @@ private:
      * @param offset: index value to be added to the exponential moving
      * average/variance computation
      */
-    void updateQuantizationStats(int32_t frame_index, int32_t symbol_index);
+    void updateQuantizationStats(int32_t frame_index, int16_t sample);
 
     /**
-     * Computes the convolution between a stride of samples starting from
-     * a given offset and a target waveform.
+     * Computes, in a single pass, the correlation between a stride of samples
+     * starting from a given offset and all the M17 syncwords.
      *
-     * @param offset: the offset in the active buffer where to start the stride
-     * @param target: a buffer containing the target waveform to be convoluted
-     * @param target_size: the number of symbols of the target waveform
-     * @return uint16_t numerical value of the convolution
+     * @param offset: the offset in the active buffer where to start the
+     * stride, can be negative down to -M17_BRIDGE_SIZE.
+     * @return correlation values, indexed by syncword type.
      */
-    int32_t convolution(int32_t offset, int8_t *target, size_t target_size);
+    corr_t correlate(int32_t offset);
 
     /**
      * Finds the index of the next frame syncword in the baseband stream.
      *
      * @param baseband: buffer containing the sampled baseband signal
      * @param offset: offset of the buffer after which syncword are searched
-     * @return uint16_t index of the first syncword in the buffer after the offset
+     * @return index, type and fractional position of the first syncword in
+     * the buffer after the offset, index is -1 if no syncword has been found.
      */
     sync_t nextFrameSync(int32_t offset);
 
     /**
-     * Takes the value from the input baseband at a given offsets and quantizes
-     * it leveraging the quantization max and min hold statistics.
+     * Quantizes a symbol sample leveraging the quantization max and min hold
+     * statistics.
      *
-     * @param offset: the offset in the input baseband
+     * @param sample: the symbol sample
      * @return int8_t quantized symbol
      */
-    int8_t quantize(int32_t offset);
+    int8_t quantize(int16_t sample);
+
+    /**
+     * Computes the two soft bits of a symbol sample, leveraging the same
+     * quantization statistics used by quantize().
+     *
+     * @param sample: the symbol sample
+     * @param softBits: pointer to the destination of the two soft bits
+     */
+    void quantizeSoft(int16_t sample, uint16_t *softBits);
+
+    /**
+     * Interpolates the filtered baseband at a fractional sample position,
+     * using a cubic interpolator on the four nearest samples.
+     *
+     * @param position: sample position in the current block, can be negative
+     * down to -M17_BRIDGE_SIZE + 1.
+     * @return interpolated sample value.
+     */
+    float interpolate(float position);
+
+    /**
+     * Resets the symbol timing recovery loop.
+     */
+    void resetTimingRecovery();
+
+    /**
+     * Runs one step of the symbol timing recovery loop, based on a Gardner
+     * timing error detector, and updates the sampling instant of the next
+     * symbol.
+     *
+     * @param symbol: sample of the current symbol.
+     * @param position: sampling position of the current symbol.
+     */
+    void updateTimingRecovery(float symbol, float position);
 
     /**
-     * Perform a limited search for a syncword using correlation
+     * Demodulate a block of baseband samples, filling the idle frame. The
+     * block length must not exceed M17_SAMPLE_BUF_SIZE and must be at least
+     * M17_BRIDGE_SIZE.
      *
-     * @param offset: sample index right after a syncword
-     * @return int32_t sample of the beginning of a syncword
+     * @param data: pointer to the baseband samples, DC removal and filtering
+     * are done in place on this buffer. The block has to be preceded in memory
+     * by the last M17_BRIDGE_SIZE samples of the previous one, as left by this
+     * function.
+     * @param len: number of samples in the block.
      */
-    int32_t syncwordSweep(int32_t offset);
+    void processBlock(int16_t *data, const size_t len);
 };
 
 } /* M17 */
@@ -75,6 +75,16 @@ public:
      */
     M17FrameType decodeFrame(const frame_t& frame);
 
+    /**
+     * Decode an M17 frame made of soft bits, identifying its type. Frame data
+     * must contain the sync word in the first sixteen soft bits. Convolutional
+     * decoding is performed using a soft decision Viterbi decoder.
+     *
+     * @param frame: soft bit array containg frame data.
+     * @return the type of frame recognized.
+     */
+    M17FrameType decodeFrame(const softframe_t& frame);
+
     /**
      * Get the latest Link Setup Frame decoded. Check of the validity of the
      * data contained in the LSF is left to application code.
@@ -117,6 +127,14 @@ private:
      */
     void decodeLSF(const std::array< uint8_t, 46 >& data);
 
+    /**
+     * Decode Link Setup Frame data from soft bits and update the internal LSF
+     * field with the new frame data.
+     *
+     * @param data: soft bit array containg frame data, without sync word.
+     */
+    void decodeLSF(const std::array< uint16_t, 368 >& data);
+
     /**
      * Decode stream data and update the internal LSF field with the new
      * frame data.
@@ -125,6 +143,22 @@ private:
      */
     void decodeStream(const std::array< uint8_t, 46 >& data);
 
+    /**
+     * Decode stream data from soft bits and update the internal LSF field with
+     * the new frame data.
+     *
+     * @param data: soft bit array containg frame data, without sync word.
+     */
+    void decodeStream(const std::array< uint16_t, 368 >& data);
+
+    /**
+     * Decode a LICH block and append the resulting segment to the Link Setup
+     * Frame being reassembled from the stream frames.
+     *
+     * @param lich: LICH block to be processed.
+     */
+    void processLich(const lich_t& lich);
+
     /**
      * Decode a LICH block.
      *
@@ -141,6 +175,7 @@ private:
     M17LinkSetupFrame lsfFromLich;      ///< LSF assembled from LICH segments.
     M17StreamFrame    streamFrame;      ///< Latest stream dat frame received.
     M17HardViterbi    viterbi;          ///< Viterbi decoder.
+    M17SoftViterbi    softViterbi;      ///< Soft decision Viterbi decoder.
 
     ///< Maximum allowed hamming distance when determining the frame type.
     static constexpr uint8_t MAX_SYNC_HAMM_DISTANCE = 4;
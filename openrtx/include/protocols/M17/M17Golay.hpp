@@ -28,6 +28,8 @@
 #endif
 
 #include <cstdint>
+#include <cstddef>
+#include <array>
 
 namespace M17
 {
@@ -45,6 +47,9 @@ uint16_t calcChecksum(const uint16_t& value);
 
 /**
  * Detect and correct errors in a Golay(24,12) codeword.
+ * Unless M17_GOLAY_NO_TABLE is defined, errors are found with a lookup in a
+ * precomputed table of 4096 entries indexed by the codeword syndrome,
+ * otherwise they are searched with searchErrors().
  *
  * @param codeword: input codeword.
  * @return bitmask corresponding to detected bit errors in the codeword, or
@@ -52,6 +57,17 @@ uint16_t calcChecksum(const uint16_t& value);
  */
 uint32_t detectErrors(const uint32_t& codeword);
 
+/**
+ * Detect and correct errors in a Golay(24,12) codeword by searching the error
+ * pattern starting from the codeword syndrome. Slower than the table lookup
+ * but without any memory footprint.
+ *
+ * @param codeword: input codeword.
+ * @return bitmask corresponding to detected bit errors in the codeword, or
+ * 0xFFFFFFFF if bit errors are unrecoverable.
+ */
+uint32_t searchErrors(const uint32_t& codeword);
+
 }   // namespace Golay24
 
 
@@ -90,6 +106,19 @@ static inline uint16_t golay24_decode(const uint32_t& codeword)
     return ((codeword ^ errors) >> 12) & 0x0FFF;
 }
 
+
+/**
+ * Decode the four Golay(24,12) codewords carried by a LICH segment, correcting
+ * eventual bit errors.
+ *
+ * \param lich: LICH segment, made of four big-endian 24 bit codewords.
+ * \param data: destination array for the four 12-bit data blocks.
+ * \return true if all the codewords have been successfully decoded, false in
+ * case of unrecoverable errors in at least one of them.
+ */
+bool golay24_decodeLich(const std::array< uint8_t, 12 >& lich,
+                        std::array< uint16_t, 4 >& data);
+
 }      // namespace M17
 
 #endif // M17_GOLAY_H
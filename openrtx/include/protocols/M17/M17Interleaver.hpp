@@ -27,33 +27,108 @@
 #error This header is C++ only!
 #endif
 
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include "M17Decorrelator.hpp"
 #include "M17Utils.hpp"
 
 namespace M17
 {
 
 /**
- * Interleave a block of data using the quadratic permutation polynomial from
- * M17 protocol specification. Polynomial used is P(x) = 45*x + 92*x^2.
+ * Permutation table of the quadratic permutation polynomial from M17 protocol
+ * specification, P(x) = 45*x + 92*x^2, over a block of NB bits.
+ */
+template < size_t NB >
+struct QppTable
+{
+    uint16_t index[NB];
+};
+
+template < size_t NB >
+static constexpr QppTable< NB > buildQppTable()
+{
+    static_assert(NB <= 65536, "Block size exceeds table range");
+
+    QppTable< NB > table = {};
+
+    for(size_t i = 0; i < NB; i++)
+        table.index[i] = ((45 * i) + (92 * i * i)) % NB;
+
+    return table;
+}
+
+/**
+ * Check if a permutation is the inverse of itself, in which case the same
+ * table can be used for both interleaving and deinterleaving.
+ */
+template < size_t NB >
+static constexpr bool isSelfInverse(const QppTable< NB >& table)
+{
+    for(size_t i = 0; i < NB; i++)
+    {
+        if(table.index[table.index[i]] != i)
+            return false;
+    }
+
+    return true;
+}
+
+template < size_t NB >
+static constexpr QppTable< NB > qppTable = buildQppTable< NB >();
+
+/**
+ * Gather the bits of a byte array according to the M17 permutation: bit i of
+ * the output is bit P(i) of the input. Optional bit masks can be xored to the
+ * input before the permutation and to the output after it.
  *
- * \param data: input byte array.
+ * \param in: input byte array.
+ * \param out: output byte array, must not overlap with the input one.
+ * \param inMask: bit mask applied to the input, can be nullptr.
+ * \param outMask: bit mask applied to the output, can be nullptr.
  */
 template < size_t N >
-void interleave(std::array< uint8_t, N >& data)
+inline void qppGather(const std::array< uint8_t, N >& in,
+                      std::array< uint8_t, N >& out, const uint8_t *inMask,
+                      const uint8_t *outMask)
 {
-    std::array< uint8_t, N > interleaved;
+    static_assert(isSelfInverse(qppTable< N*8 >),
+                  "Permutation is not an involution");
 
-    static constexpr size_t F1 = 45;
-    static constexpr size_t F2 = 92;
-    static constexpr size_t NB = N*8;
+    const uint16_t *index = qppTable< N*8 >.index;
 
-    for(size_t i = 0; i < NB; i++)
+    for(size_t i = 0; i < N; i++)
     {
-        size_t index = ((F1 * i) + (F2 * i * i)) % NB;
-        setBit(interleaved, index, getBit(data, i));
+        uint8_t byte = 0;
+
+        for(size_t j = 0; j < 8; j++)
+        {
+            uint16_t pos = *index++;
+            uint8_t  src = in[pos / 8];
+            if(inMask != nullptr) src ^= inMask[pos / 8];
+
+            byte = (byte << 1) | ((src >> (7 - (pos % 8))) & 0x01);
+        }
+
+        if(outMask != nullptr) byte ^= outMask[i];
+        out[i] = byte;
     }
+}
 
-    std::copy(interleaved.begin(), interleaved.end(), data.begin());
+/**
+ * Interleave a block of data using the quadratic permutation polynomial from
+ * M17 protocol specification. Polynomial used is P(x) = 45*x + 92*x^2.
+ *
+ * \param data: input byte array.
+ */
+template < size_t N >
+void interleave(std::array< uint8_t, N >& data)
+{
+    // P is an involution, interleaving and deinterleaving are the same thing.
+    std::array< uint8_t, N > interleaved;
+    qppGather(data, interleaved, nullptr, nullptr);
+    data = interleaved;
 }
 
 /**
@@ -67,18 +142,64 @@ template < size_t N >
 void deinterleave(std::array< uint8_t, N >& data)
 {
     std::array< uint8_t, N > deinterleaved;
+    qppGather(data, deinterleaved, nullptr, nullptr);
+    data = deinterleaved;
+}
+
+/**
+ * Interleave and then decorrelate a block of data in a single pass, equivalent
+ * to interleave() followed by decorrelate().
+ *
+ * \param data: input byte array.
+ */
+template < size_t N >
+void interleaveDecorrelate(std::array< uint8_t, N >& data)
+{
+    static_assert(N <= sequence.size(), "Input size exceeds sequence length");
 
-    static constexpr size_t F1 = 45;
-    static constexpr size_t F2 = 92;
-    static constexpr size_t NB = N*8;
+    std::array< uint8_t, N > interleaved;
+    qppGather(data, interleaved, nullptr, sequence.data());
+    data = interleaved;
+}
 
-    for(size_t i = 0; i < NB; i++)
+/**
+ * Decorrelate and then deinterleave a block of data in a single pass,
+ * equivalent to decorrelate() followed by deinterleave().
+ *
+ * \param data: input byte array.
+ */
+template < size_t N >
+void decorrelateDeinterleave(std::array< uint8_t, N >& data)
+{
+    static_assert(N <= sequence.size(), "Input size exceeds sequence length");
+
+    std::array< uint8_t, N > deinterleaved;
+    qppGather(data, deinterleaved, sequence.data(), nullptr);
+    data = deinterleaved;
+}
+
+/**
+ * Decorrelate and then deinterleave a block of soft bits in a single pass,
+ * equivalent to decorrelate() followed by deinterleave().
+ *
+ * \param in: input soft bit array, one bit per element.
+ * \param out: output soft bit array.
+ */
+template < size_t N >
+void decorrelateDeinterleave(const uint16_t *in, std::array< uint16_t, N >& out)
+{
+    static_assert(N <= sequence.size() * 8, "Input size exceeds sequence length");
+    static_assert(isSelfInverse(qppTable< N >),
+                  "Permutation is not an involution");
+
+    const uint16_t *index = qppTable< N >.index;
+
+    for(size_t i = 0; i < N; i++)
     {
-        size_t index = ((F1 * i) + (F2 * i * i)) % NB;
-        setBit(deinterleaved, i, getBit(data, index));
+        uint16_t pos  = index[i];
+        uint16_t flip = -((sequence[pos / 8] >> (7 - (pos % 8))) & 0x01);
+        out[i] = in[pos] ^ flip;
     }
-
-    std::copy(deinterleaved.begin(), deinterleaved.end(), data.begin());
 }
 
 }      // namespace M17
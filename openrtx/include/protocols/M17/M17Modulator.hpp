@@ -98,7 +98,7 @@ private:
     void symbolsToBaseband();
 
     /**
-     * Emit the baseband stream towards the output stage, platform dependent.
+     * Emit the baseband stream towards the output stage.
      */
     void sendBaseband();
 
@@ -31,7 +31,8 @@
 #include <cstdint>
 #include <cstddef>
 #include <array>
-#include <bitset>
+#include <algorithm>
+#include "M17ViterbiAcs.hpp"
 #include "M17Utils.hpp"
 
 namespace M17
@@ -147,46 +148,11 @@ private:
      */
     void decodeBit(uint8_t s0, uint8_t s1, size_t pos)
     {
-        static constexpr uint8_t COST_TABLE_0[] = {0, 0, 0, 0, 2, 2, 2, 2};
-        static constexpr uint8_t COST_TABLE_1[] = {0, 2, 2, 0, 0, 2, 2, 0};
+        uint16_t bm[NumStates/2];
 
-        for(uint8_t i = 0; i < NumStates/2; i++)
-        {
-            uint16_t metric = std::abs(COST_TABLE_0[i] - s0)
-                            + std::abs(COST_TABLE_1[i] - s1);
-
-
-            uint16_t m0 = (*prevMetrics)[i] + metric;
-            uint16_t m1 = (*prevMetrics)[i + NumStates/2] + (4 - metric);
-
-            uint16_t m2 = (*prevMetrics)[i] + (4 - metric);
-            uint16_t m3 = (*prevMetrics)[i + NumStates/2] + metric;
-
-            uint8_t i0 = 2 * i;
-            uint8_t i1 = i0 + 1;
-
-            if(m0 >= m1)
-            {
-                history[pos].set(i0, true);
-                (*currMetrics)[i0] = m1;
-            }
-            else
-            {
-                history[pos].set(i0, false);
-                (*currMetrics)[i0] = m0;
-            }
-
-            if(m2 >= m3)
-            {
-                history[pos].set(i1, true);
-                (*currMetrics)[i1] = m3;
-            }
-            else
-            {
-                history[pos].set(i1, false);
-                (*currMetrics)[i1] = m2;
-            }
-        }
+        viterbiBranchMetrics(s0, s1, 2, bm);
+        history[pos] = viterbiAcs(prevMetrics->data(), currMetrics->data(),
+                                  bm, 4);
 
         std::swap(currMetrics, prevMetrics);
     }
@@ -208,7 +174,7 @@ private:
         {
             bitPos--;
             pos--;
-            bool bit = history[pos].test(state >> 4);
+            bool bit = (history[pos] >> (state >> 4)) & 0x01;
             state >>= 1;
             if(bit) state |= 0x80;
             setBit(out, bitPos, bit);
@@ -235,7 +201,7 @@ private:
     std::array< uint16_t, NumStates >  prevMetricsData;
     std::array< uint16_t, NumStates >  currMetricsData;
 
-    std::array< std::bitset< NumStates >, 244 > history;
+    std::array< uint16_t, 244 > history;
 };
 
 /**
@@ -275,6 +241,7 @@ public:
 
         currMetricsData.fill(0);
         prevMetricsData.fill(0);
+        metricOffset = 0;
 
         size_t pos = 0;
         for (size_t i = 0; i < IN; i += 2)
@@ -286,7 +253,7 @@ public:
             pos++;
         }
 
-        return chainback(out, pos);
+        return chainback(out, pos) / SoftMax;
     }
 
     /**
@@ -306,6 +273,7 @@ public:
 
         currMetricsData.fill(0);
         prevMetricsData.fill(0);
+        metricOffset = 0;
 
         size_t   histPos     = 0;
         size_t   punctIndex  = 0;
@@ -336,7 +304,9 @@ public:
             histPos++;
         }
 
-        return chainback(out, histPos) - punctBitCnt;
+        // Each punctured bit adds half of the maximum symbol cost
+        uint32_t punctCost = punctBitCnt * (SoftMax / 2);
+        return (chainback(out, histPos) - punctCost) / SoftMax;
     }
 
 private:
@@ -350,50 +320,24 @@ private:
      */
     void decodeBit(uint16_t s0, uint16_t s1, size_t pos)
     {
-        static constexpr uint16_t COST_TABLE_0[] = {0, 0, 0, 0, 0xFFFF,
-                                                    0xFFFF, 0xFFFF, 0xFFFF};
-        static constexpr uint16_t COST_TABLE_1[] = {0, 0xFFFF, 0xFFFF, 0,
-                                                    0, 0xFFFF, 0xFFFF, 0};
-
-        for(uint8_t i = 0; i < NumStates/2; i++)
-        {
-            uint32_t metric = q_AbsDiff(COST_TABLE_0[i], s0)
-                            + q_AbsDiff(COST_TABLE_1[i], s1);
+        uint16_t bm[NumStates/2];
 
+        viterbiBranchMetrics(s0 >> 8, s1 >> 8, SoftMax, bm);
+        history[pos] = viterbiAcs(prevMetrics->data(), currMetrics->data(),
+                                  bm, 2 * SoftMax);
 
-            uint32_t m0 = (*prevMetrics)[i] + metric;
-            uint32_t m1 = (*prevMetrics)[i + NumStates/2] + (0x1FFFE - metric);
-
-            uint32_t m2 = (*prevMetrics)[i] + (0x1FFFE - metric);
-            uint32_t m3 = (*prevMetrics)[i + NumStates/2] + metric;
-
-            uint8_t i0 = 2 * i;
-            uint8_t i1 = i0 + 1;
-
-            if(m0 >= m1)
-            {
-                history[pos].set(i0, true);
-                (*currMetrics)[i0] = m1;
-            }
-            else
-            {
-                history[pos].set(i0, false);
-                (*currMetrics)[i0] = m0;
-            }
+        std::swap(currMetrics, prevMetrics);
 
-            if(m2 >= m3)
-            {
-                history[pos].set(i1, true);
-                (*currMetrics)[i1] = m3;
-            }
-            else
-            {
-                history[pos].set(i1, false);
-                (*currMetrics)[i1] = m2;
-            }
+        // Path metrics spread is bounded to (K - 1) times the maximum branch
+        // metric: subtract the minimum as soon as the metrics grow too much,
+        // keeping them within the range allowed by the ACS kernel.
+        if((*prevMetrics)[0] > 0x4000)
+        {
+            uint16_t min = (*prevMetrics)[0];
+            for(auto m : *prevMetrics) min = std::min(min, m);
+            for(auto& m : *prevMetrics) m -= min;
+            metricOffset += min;
         }
-
-        std::swap(currMetrics, prevMetrics);
     }
 
     /**
@@ -413,7 +357,7 @@ private:
         {
             bitPos--;
             pos--;
-            bool bit = history[pos].test(state >> 4);
+            bool bit = (history[pos] >> (state >> 4)) & 0x01;
             state >>= 1;
             if(bit) state |= 0x80;
             setBit(out, bitPos, bit);
@@ -427,34 +371,22 @@ private:
             if(m < cost) cost = m;
         }
 
-        return cost;
-    }
-
-    /**
-     * Utility function to compute the absolute value of a difference between
-     * two fixed-point values.
-     *
-     * @param v1: first value
-     * @param v2: second value
-     * @return abs(v1-v2)
-     */
-    inline uint16_t q_AbsDiff(const uint16_t v1, const uint16_t v2)
-    {
-        if(v2 > v1) return v2 - v1;
-        return v1 - v2;
+        return cost + metricOffset;
     }
 
+    static constexpr size_t   K         = 5;
+    static constexpr size_t   NumStates = (1 << (K - 1));
+    static constexpr uint16_t SoftMax   = 0xFF;    ///< Soft symbols are reduced to 8 bit.
 
-    static constexpr size_t K = 5;
-    static constexpr size_t NumStates = (1 << (K - 1));
+    std::array< uint16_t, NumStates > *prevMetrics;
+    std::array< uint16_t, NumStates > *currMetrics;
 
-    std::array< uint32_t, NumStates > *prevMetrics;
-    std::array< uint32_t, NumStates > *currMetrics;
+    std::array< uint16_t, NumStates >  prevMetricsData;
+    std::array< uint16_t, NumStates >  currMetricsData;
 
-    std::array< uint32_t, NumStates >  prevMetricsData;
-    std::array< uint32_t, NumStates >  currMetricsData;
+    uint32_t metricOffset;    ///< Sum of the renormalisation offsets.
 
-    std::array< std::bitset< NumStates >, 244 > history;
+    std::array< uint16_t, 244 > history;
 };
 
 }      // namespace M17
@@ -0,0 +1,192 @@
+/***************************************************************************
+ *   Copyright (C) 2023 by Federico Amedeo Izzo IU2NUO,                    *
+ *                         Niccolò Izzo IU2KIN                             *
+ *                         Frederik Saraci IU2NRO                          *
+ *                         Silvano Seva IU2KWO                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+#ifndef M17_VITERBI_ACS_H
+#define M17_VITERBI_ACS_H
+
+#ifndef __cplusplus
+#error This header is C++ only!
+#endif
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+/*
+ * Select the add-compare-select implementation: Cortex-M4 DSP extension,
+ * x86 SSE2 or portable scalar code. Defining M17_VITERBI_SCALAR forces the
+ * use of the scalar version on every target.
+ */
+#if !defined(M17_VITERBI_SCALAR)
+#if defined(__ARM_FEATURE_SIMD32)
+#include <arm_acle.h>
+#define M17_VITERBI_ACS_SIMD32
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define M17_VITERBI_ACS_SSE2
+#endif
+#endif
+
+namespace M17
+{
+
+/**
+ * Compute the branch metrics of the eight butterflies of the K = 5, R = 1/2
+ * M17 trellis for a given pair of received symbols. Symbols and branch metrics
+ * are expressed in the same unit, ranging from 0 (strong zero) to maxSym
+ * (strong one).
+ *
+ * @param s0: first received symbol.
+ * @param s1: second received symbol.
+ * @param maxSym: value of a symbol corresponding to a strong one.
+ * @param bm: destination array for the eight branch metrics.
+ */
+static inline void viterbiBranchMetrics(const uint16_t s0, const uint16_t s1,
+                                        const uint16_t maxSym, uint16_t *bm)
+{
+    // Expected encoder outputs for the upper branch of each butterfly are
+    // G1 = {0, 0, 0, 0, 1, 1, 1, 1} and G2 = {0, 1, 1, 0, 0, 1, 1, 0}, thus
+    // only four distinct metric values are possible.
+    uint16_t a0 = s0;
+    uint16_t a1 = maxSym - s0;
+    uint16_t b0 = s1;
+    uint16_t b1 = maxSym - s1;
+
+    bm[0] = a0 + b0;
+    bm[1] = a0 + b1;
+    bm[2] = a0 + b1;
+    bm[3] = a0 + b0;
+    bm[4] = a1 + b0;
+    bm[5] = a1 + b1;
+    bm[6] = a1 + b1;
+    bm[7] = a1 + b0;
+}
+
+/**
+ * Add-compare-select step updating all the sixteen states of the M17 trellis
+ * at once. Path metrics are 16 bit wide and must stay below 32768, caller is
+ * responsible for their renormalisation.
+ *
+ * @param prev: path metrics at the previous step.
+ * @param curr: destination array for the updated path metrics.
+ * @param bm: branch metrics of the eight butterflies.
+ * @param maxBm: maximum value of a branch metric, that is the sum of the
+ * metrics of the upper and lower branches of a butterfly.
+ * @return decision word, bit i is set when the surviving path entering state
+ * i comes from the lower half of the previous states.
+ */
+static inline uint16_t viterbiAcs(const uint16_t *prev, uint16_t *curr,
+                                  const uint16_t *bm, const uint16_t maxBm)
+{
+    #if defined(M17_VITERBI_ACS_SSE2)
+
+    __m128i pLo = _mm_loadu_si128(reinterpret_cast< const __m128i * >(prev));
+    __m128i pHi = _mm_loadu_si128(reinterpret_cast< const __m128i * >(prev + 8));
+    __m128i b   = _mm_loadu_si128(reinterpret_cast< const __m128i * >(bm));
+    __m128i bc  = _mm_sub_epi16(_mm_set1_epi16(maxBm), b);
+
+    __m128i m0  = _mm_add_epi16(pLo, b);
+    __m128i m1  = _mm_add_epi16(pHi, bc);
+    __m128i m2  = _mm_add_epi16(pLo, bc);
+    __m128i m3  = _mm_add_epi16(pHi, b);
+
+    // Lanes are set where the upper branch survives, that is the complement
+    // of the decision bit.
+    __m128i nE  = _mm_cmpgt_epi16(m1, m0);
+    __m128i nO  = _mm_cmpgt_epi16(m3, m2);
+    __m128i mE  = _mm_min_epi16(m0, m1);
+    __m128i mO  = _mm_min_epi16(m2, m3);
+
+    _mm_storeu_si128(reinterpret_cast< __m128i * >(curr),
+                     _mm_unpacklo_epi16(mE, mO));
+    _mm_storeu_si128(reinterpret_cast< __m128i * >(curr + 8),
+                     _mm_unpackhi_epi16(mE, mO));
+
+    __m128i n   = _mm_packs_epi16(_mm_unpacklo_epi16(nE, nO),
+                                  _mm_unpackhi_epi16(nE, nO));
+
+    return static_cast< uint16_t >(~_mm_movemask_epi8(n));
+
+    #elif defined(M17_VITERBI_ACS_SIMD32)
+
+    uint16_t   decisions = 0;
+    uint16x2_t max2      = (static_cast< uint32_t >(maxBm) << 16) | maxBm;
+
+    for(size_t i = 0; i < 8; i += 2)
+    {
+        uint16x2_t pLo, pHi, b;
+        memcpy(&pLo, prev + i,     sizeof(pLo));
+        memcpy(&pHi, prev + i + 8, sizeof(pHi));
+        memcpy(&b,   bm + i,       sizeof(b));
+
+        uint16x2_t bc = __usub16(max2, b);
+        uint16x2_t m0 = __uadd16(pLo, b);
+        uint16x2_t m1 = __uadd16(pHi, bc);
+        uint16x2_t m2 = __uadd16(pLo, bc);
+        uint16x2_t m3 = __uadd16(pHi, b);
+
+        // GE flags are set on the lanes where m0 >= m1
+        __usub16(m0, m1);
+        uint32_t mE = __sel(m1, m0);
+        uint32_t dE = __sel(0x00010001, 0);
+
+        __usub16(m2, m3);
+        uint32_t mO = __sel(m3, m2);
+        uint32_t dO = __sel(0x00010001, 0);
+
+        // Interleave even and odd states
+        uint32_t c0 = (mE & 0x0000FFFF) | (mO << 16);
+        uint32_t c1 = (mE >> 16) | (mO & 0xFFFF0000);
+        memcpy(curr + 2*i,     &c0, sizeof(c0));
+        memcpy(curr + 2*i + 2, &c1, sizeof(c1));
+
+        uint32_t d = dE | (dO << 1);
+        decisions |= ((d & 0x03) | ((d >> 14) & 0x0C)) << (2*i);
+    }
+
+    return decisions;
+
+    #else
+
+    uint16_t decisions = 0;
+
+    for(size_t i = 0; i < 8; i++)
+    {
+        uint16_t m0 = prev[i]     + bm[i];
+        uint16_t m1 = prev[i + 8] + (maxBm - bm[i]);
+        uint16_t m2 = prev[i]     + (maxBm - bm[i]);
+        uint16_t m3 = prev[i + 8] + bm[i];
+
+        uint16_t d0 = (m0 >= m1) ? 1 : 0;
+        uint16_t d1 = (m2 >= m3) ? 1 : 0;
+
+        curr[2*i]     = d0 ? m1 : m0;
+        curr[2*i + 1] = d1 ? m3 : m2;
+        decisions    |= (d0 << (2*i)) | (d1 << (2*i + 1));
+    }
+
+    return decisions;
+
+    #endif
+}
+
+}      // namespace M17
+
+#endif // M17_VITERBI_ACS_H
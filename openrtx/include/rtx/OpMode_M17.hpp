@@ -25,6 +25,7 @@
 #include <M17/M17FrameEncoder.hpp>
 #include <M17/M17Demodulator.hpp>
 #include <M17/M17Modulator.hpp>
+#include <audio_codec.h>
 #include <audio_path.h>
 #include "OpMode.hpp"
 
@@ -125,6 +126,8 @@ private:
     bool startRx;                      ///< Flag for RX management.
     bool startTx;                      ///< Flag for TX management.
     bool locked;                       ///< Demodulator locked on data stream.
+    bool streamActive;                 ///< Receiving a voice stream.
+    uint16_t lastFrameNum;             ///< Number of the last stream frame received.
     bool invertTxPhase;                ///< TX signal phase inversion setting.
     bool invertRxPhase;                ///< RX signal phase inversion setting.
     pathId rxAudioPath;                ///< Audio path ID for RX
@@ -133,6 +136,8 @@ private:
     M17::M17Demodulator  demodulator;  ///< M17 demodulator.
     M17::M17FrameDecoder decoder;      ///< M17 frame decoder
     M17::M17FrameEncoder encoder;      ///< M17 frame encoder
+    codec_t *rxCodec;                  ///< Codec instance for RX audio.
+    codec_t *txCodec;                  ///< Codec instance for TX audio.
 };
 
 #endif /* OPMODE_M17_H */
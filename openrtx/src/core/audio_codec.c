@@ -19,32 +19,68 @@
  ***************************************************************************/
 
 #include <interfaces/audio_stream.h>
+#include <interfaces/delays.h>
 #include <audio_codec.h>
+#include <audio_mixer.h>
+#include <stdatomic.h>
 #include <pthread.h>
 #include <codec2.h>
 #include <stdlib.h>
 #include <string.h>
 #include <dsp.h>
+#include <profiling.h>
+
+/*
+ * Size of the compressed frame queue, must be a power of two. Each frame holds
+ * 20ms of speech. The jitter buffer is limited to the queue size minus two, to
+ * leave room for the two frames carried by an M17 stream frame.
+ */
+#ifndef CODEC_QUEUE_SIZE
+#define CODEC_QUEUE_SIZE 8
+#endif
 
-#define BUF_SIZE 4
-
-static struct CODEC2   *codec2;
-static stream_sample_t *audioBuf;
-static streamId         audioStream;
-
-static uint8_t          initCnt = 0;
-static bool             running;
-
-static bool             stopThread;
-static pthread_t        codecThread;
-static pthread_mutex_t  mutex;
-static pthread_cond_t   not_empty;
-static pthread_cond_t   not_full;
-
-static uint8_t          readPos;
-static uint8_t          writePos;
-static uint8_t          numElements;
-static uint64_t         dataBuffer[BUF_SIZE];
+_Static_assert((CODEC_QUEUE_SIZE & (CODEC_QUEUE_SIZE - 1)) == 0,
+               "Codec queue size must be a power of two");
+
+/*
+ * Missing frames are concealed repeating the last good one, each repetition is
+ * attenuated by a factor PLC_GAIN / 256.
+ */
+#define PLC_GAIN 192
+
+/*
+ * Codec instance. The frame queue is single producer, single consumer and
+ * lock-free: read and write positions are free-running counters, each one
+ * written only by one side. The mutex and the condition variables are used
+ * only by blocking calls, when the corresponding waiting flag is set.
+ */
+struct codec
+{
+    struct CODEC2   *codec2;
+    stream_sample_t *audioBuf;
+    streamId         audioStream;
+    mixerSource_t    mixerSource;
+
+    bool             running;
+    atomic_bool      stopThread;
+    pthread_t        codecThread;
+    pthread_mutex_t  mutex;
+    pthread_cond_t   not_empty;
+    pthread_cond_t   not_full;
+
+    uint64_t         dataBuffer[CODEC_QUEUE_SIZE];
+    bool             lostFrame[CODEC_QUEUE_SIZE];   // Placeholder of a lost frame
+    atomic_uint      readPos;
+    atomic_uint      writePos;
+    atomic_uint      endPos;        // Write position at the end of the stream
+    atomic_bool      popWaiting;
+    atomic_bool      pushWaiting;
+
+    uint8_t          prefill;
+    atomic_uint      underruns;
+    atomic_uint      overruns;
+    atomic_uint      concealed;
+};
 
 #ifdef PLATFORM_MOD17
 static const uint8_t micGainPre  = 4;
@@ -56,194 +92,302 @@ static const uint8_t micGainPost = 4;
 
 static void *encodeFunc(void *arg);
 static void *decodeFunc(void *arg);
-static void startThread(void *(*func) (void *));
+static void startThread(codec_t *codec, void *(*func) (void *));
+static bool startDecode(codec_t *codec, const enum AudioSink destination,
+                        const enum AudioPriority prio, const uint8_t frames);
+
+/*
+ * The codec2 state and the audio buffer are allocated only for the duration of
+ * an encoding or decoding operation, so that idle instances take just the
+ * memory of their queue.
+ */
+static void freeState(codec_t *codec)
+{
+    if(codec->codec2 != NULL)
+        codec2_destroy(codec->codec2);
 
+    free(codec->audioBuf);
+    codec->codec2   = NULL;
+    codec->audioBuf = NULL;
+}
 
-void codec_init()
+static bool allocState(codec_t *codec)
 {
-    if(initCnt > 0)
-    {
-        pthread_mutex_lock(&mutex);
-        initCnt += 1;
-        pthread_mutex_unlock(&mutex);
-        return;
-    }
-    else
-    {
-        initCnt = 1;
-    }
+    codec->audioBuf = (stream_sample_t *) malloc(320 * sizeof(stream_sample_t));
+    codec->codec2   = codec2_create(CODEC2_MODE_3200);
+
+    if((codec->audioBuf != NULL) && (codec->codec2 != NULL))
+        return true;
+
+    freeState(codec);
+    return false;
+}
 
-    running     = false;
-    readPos     = 0;
-    writePos    = 0;
-    numElements = 0;
-    memset(dataBuffer, 0x00, BUF_SIZE * sizeof(uint64_t));
+static inline void queueReset(codec_t *codec)
+{
+    atomic_store(&codec->readPos,     0);
+    atomic_store(&codec->writePos,    0);
+    atomic_store(&codec->endPos,      0);
+    atomic_store(&codec->popWaiting,  false);
+    atomic_store(&codec->pushWaiting, false);
+    atomic_store(&codec->underruns,   0);
+    atomic_store(&codec->overruns,    0);
+    atomic_store(&codec->concealed,   0);
+}
 
-    audioBuf  = ((stream_sample_t *) malloc(320 * sizeof(stream_sample_t)));
+static inline unsigned int queueCount(codec_t *codec)
+{
+    unsigned int wr = atomic_load_explicit(&codec->writePos, memory_order_acquire);
+    unsigned int rd = atomic_load_explicit(&codec->readPos,  memory_order_acquire);
 
-    pthread_mutex_init(&mutex, NULL);
-    pthread_cond_init(&not_empty, NULL);
-    pthread_cond_init(&not_full, NULL);
+    return wr - rd;
 }
 
-void codec_terminate()
+/*
+ * Wake up the thread waiting on the other side of the queue, if any. The fence
+ * pairs with the one in queueWait(): either the waiting thread sees the queue
+ * update or this function sees its flag.
+ */
+static inline void queueWakeup(codec_t *codec, atomic_bool *waiting,
+                               pthread_cond_t *cond)
 {
-    pthread_mutex_lock(&mutex);
-    initCnt -= 1;
-    pthread_mutex_unlock(&mutex);
+    atomic_thread_fence(memory_order_seq_cst);
+    if(atomic_load_explicit(waiting, memory_order_relaxed) == false)
+        return;
+
+    pthread_mutex_lock(&codec->mutex);
+    pthread_cond_signal(cond);
+    pthread_mutex_unlock(&codec->mutex);
+}
 
-    if(initCnt > 0) return;
-    if(running) codec_stop();
+static void queueWait(codec_t *codec, atomic_bool *waiting,
+                      pthread_cond_t *cond, const bool push)
+{
+    pthread_mutex_lock(&codec->mutex);
 
-    pthread_mutex_destroy(&mutex);
-    pthread_cond_destroy(&not_empty);
-    pthread_cond_destroy(&not_full);
+    atomic_store_explicit(waiting, true, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
 
-    if(audioBuf != NULL)
+    while(push ? (queueCount(codec) >= CODEC_QUEUE_SIZE)
+               : (queueCount(codec) == 0))
     {
-        free(audioBuf);
-        audioBuf = NULL;
+        pthread_cond_wait(cond, &codec->mutex);
     }
+
+    atomic_store_explicit(waiting, false, memory_order_relaxed);
+    pthread_mutex_unlock(&codec->mutex);
 }
 
-bool codec_startEncode(const enum AudioSource source)
+static bool queuePush(codec_t *codec, const uint64_t *frame, const bool lost)
 {
-    if(running) return false;
-    if(audioBuf == NULL) return false;
+    unsigned int wr = atomic_load_explicit(&codec->writePos, memory_order_relaxed);
+    unsigned int rd = atomic_load_explicit(&codec->readPos,  memory_order_acquire);
 
-    running = true;
+    if((wr - rd) >= CODEC_QUEUE_SIZE)
+        return false;
 
-    audioStream = inputStream_start(source, PRIO_TX, audioBuf, 320,
-                                    BUF_CIRC_DOUBLE, 8000);
+    codec->dataBuffer[wr & (CODEC_QUEUE_SIZE - 1)] = *frame;
+    codec->lostFrame[wr & (CODEC_QUEUE_SIZE - 1)]  = lost;
+    atomic_store_explicit(&codec->writePos, wr + 1, memory_order_release);
+    queueWakeup(codec, &codec->popWaiting, &codec->not_empty);
 
-    if(audioStream == -1)
-    {
-        running = false;
+    return true;
+}
+
+static bool queuePop(codec_t *codec, uint64_t *frame, bool *lost)
+{
+    unsigned int rd = atomic_load_explicit(&codec->readPos,  memory_order_relaxed);
+    unsigned int wr = atomic_load_explicit(&codec->writePos, memory_order_acquire);
+
+    if(wr == rd)
         return false;
-    }
 
-    readPos     = 0;
-    writePos    = 0;
-    numElements = 0;
-    stopThread  = false;
-    startThread(encodeFunc);
+    *frame = codec->dataBuffer[rd & (CODEC_QUEUE_SIZE - 1)];
+    *lost  = codec->lostFrame[rd & (CODEC_QUEUE_SIZE - 1)];
+    atomic_store_explicit(&codec->readPos, rd + 1, memory_order_release);
+    queueWakeup(codec, &codec->pushWaiting, &codec->not_full);
 
     return true;
 }
 
-bool codec_startDecode(const enum AudioSink destination)
+
+codec_t *codec_open()
+{
+    codec_t *codec = (codec_t *) malloc(sizeof(codec_t));
+    if(codec == NULL) return NULL;
+
+    memset(codec, 0x00, sizeof(codec_t));
+
+    codec->running = false;
+    queueReset(codec);
+
+    pthread_mutex_init(&codec->mutex, NULL);
+    pthread_cond_init(&codec->not_empty, NULL);
+    pthread_cond_init(&codec->not_full, NULL);
+
+    return codec;
+}
+
+void codec_close(codec_t *codec)
+{
+    if(codec == NULL) return;
+    if(codec->running) codec_stop(codec);
+
+    pthread_mutex_destroy(&codec->mutex);
+    pthread_cond_destroy(&codec->not_empty);
+    pthread_cond_destroy(&codec->not_full);
+
+    free(codec);
+}
+
+bool codec_startEncode(codec_t *codec, const enum AudioSource source)
 {
-    if(running) return false;
-    if(audioBuf == NULL) return false;
+    if(codec == NULL) return false;
+    if(codec->running) return false;
+    if(allocState(codec) == false) return false;
 
-    running = true;
+    codec->running = true;
 
-    memset(audioBuf, 0x00, 320 * sizeof(stream_sample_t));
-    audioStream = outputStream_start(destination, PRIO_RX, audioBuf, 320,
-                                     BUF_CIRC_DOUBLE, 8000);
+    codec->audioStream = inputStream_start(source, PRIO_TX, codec->audioBuf,
+                                           320, BUF_CIRC_DOUBLE, 8000);
 
-    if(audioStream == -1)
+    if(codec->audioStream == -1)
     {
-        running = false;
+        freeState(codec);
+        codec->running = false;
         return false;
     }
 
-    readPos     = 0;
-    writePos    = 0;
-    numElements = 0;
-    stopThread  = false;
-    startThread(decodeFunc);
+    queueReset(codec);
+    codec->stopThread = false;
+    startThread(codec, encodeFunc);
 
     return true;
 }
 
-void codec_stop()
+bool codec_startDecode(codec_t *codec, const enum AudioSink destination,
+                       const enum AudioPriority prio)
 {
-    if(running == false) return;
+    return startDecode(codec, destination, prio, 0);
+}
+
+bool codec_startDecodeBuffered(codec_t *codec, const enum AudioSink destination,
+                               const enum AudioPriority prio,
+                               const uint8_t frames)
+{
+    return startDecode(codec, destination, prio, frames);
+}
 
-    stopThread = true;
-    pthread_join(codecThread, NULL);
+void codec_stop(codec_t *codec)
+{
+    if(codec == NULL) return;
+    if(codec->running == false) return;
+
+    codec->stopThread = true;
+    pthread_join(codec->codecThread, NULL);
+    freeState(codec);
 
-    running = false;
+    codec->running = false;
 }
 
-bool codec_popFrame(uint8_t *frame, const bool blocking)
+bool codec_isRunning(const codec_t *codec)
 {
-    if(running == false) return false;
+    if(codec == NULL) return false;
 
-    uint64_t element;
+    return codec->running;
+}
 
-    // No data available and non-blocking call: just return false.
-    if((numElements == 0) && (blocking == false))
-        return false;
+bool codec_popFrame(codec_t *codec, uint8_t *frame, const bool blocking)
+{
+    if(codec == NULL) return false;
+    if(codec->running == false) return false;
+
+    uint64_t element;
+    bool     lost;
 
-    // Blocking call: wait until some data is pushed
-    pthread_mutex_lock(&mutex);
-    while(numElements == 0)
+    while(queuePop(codec, &element, &lost) == false)
     {
-        pthread_cond_wait(&not_empty, &mutex);
-    }
+        // No data available and non-blocking call: just return false.
+        if(blocking == false)
+            return false;
 
-    element      = dataBuffer[readPos];
-    readPos      = (readPos + 1) % BUF_SIZE;
-    numElements -= 1;
-    pthread_mutex_unlock(&mutex);
+        // Blocking call: wait until some data is pushed
+        queueWait(codec, &codec->popWaiting, &codec->not_empty, false);
+    }
 
-    // Do memcpy after mutex unlock to reduce execution time spent inside the
-    // critical section
     memcpy(frame, &element, 8);
 
     return true;
 }
 
-bool codec_pushFrame(const uint8_t *frame, const bool blocking)
+static bool pushElement(codec_t *codec, const uint64_t *element,
+                        const bool lost, const bool blocking)
 {
-    if(running == false) return false;
+    if(codec == NULL) return false;
+    if(codec->running == false) return false;
+
+    while(queuePush(codec, element, lost) == false)
+    {
+        // No space available and non-blocking call: return
+        if(blocking == false)
+        {
+            atomic_fetch_add(&codec->overruns, 1);
+            return false;
+        }
+
+        // Blocking call: wait until there is some free space
+        queueWait(codec, &codec->pushWaiting, &codec->not_full, true);
+    }
+
+    return true;
+}
 
-    // Copy data to a temporary variable before mutex lock to reduce execution
-    // time spent inside the critical section
+bool codec_pushFrame(codec_t *codec, const uint8_t *frame, const bool blocking)
+{
     uint64_t element;
     memcpy(&element, frame, 8);
 
+    return pushElement(codec, &element, false, blocking);
+}
 
-    // No space available and non-blocking call: return
-    if((numElements >= BUF_SIZE) && (blocking == false))
-        return false;
-
-    // Blocking call: wait until there is some free space
-    pthread_mutex_lock(&mutex);
-    while(numElements >= BUF_SIZE)
-    {
-        pthread_cond_wait(&not_full, &mutex);
-    }
+bool codec_pushLostFrame(codec_t *codec, const bool blocking)
+{
+    uint64_t element = 0;
 
-    // There is free space, push data into the queue
-    dataBuffer[writePos] = element;
-    writePos = (writePos + 1) % BUF_SIZE;
+    return pushElement(codec, &element, true, blocking);
+}
 
-    // Signal that the queue is not empty
-    if(numElements == 0) pthread_cond_signal(&not_empty);
-    numElements += 1;
+void codec_endStream(codec_t *codec)
+{
+    if(codec == NULL) return;
+    if(codec->running == false) return;
 
-    pthread_mutex_unlock(&mutex);
-    return true;
+    unsigned int wr = atomic_load_explicit(&codec->writePos, memory_order_relaxed);
+    atomic_store_explicit(&codec->endPos, wr, memory_order_release);
 }
 
+void codec_getStats(codec_t *codec, codecStats_t *stats)
+{
+    if(codec == NULL) return;
+
+    stats->underruns = atomic_load(&codec->underruns);
+    stats->overruns  = atomic_load(&codec->overruns);
+    stats->concealed = atomic_load(&codec->concealed);
+    stats->queued    = queueCount(codec);
+}
 
 
 
 static void *encodeFunc(void *arg)
 {
-    (void) arg;
+    codec_t *codec = (codec_t *) arg;
 
     filter_state_t dcrState;
     dsp_resetFilterState(&dcrState);
 
-    codec2 = codec2_create(CODEC2_MODE_3200);
-
-    while(stopThread == false)
+    while(codec->stopThread == false)
     {
-        dataBlock_t audio = inputStream_getData(audioStream);
+        dataBlock_t audio = inputStream_getData(codec->audioStream);
 
         if(audio.data != NULL)
         {
@@ -263,92 +407,173 @@ static void *encodeFunc(void *arg)
             // half and then the second one, sequentially.
             // Data ready flag is rised once all the 16 bytes contain new data.
             uint64_t frame = 0;
-            codec2_encode(codec2, ((uint8_t*) &frame), audio.data);
-
-            pthread_mutex_lock(&mutex);
-
-            // If buffer is full erase the oldest frame
-            if(numElements >= BUF_SIZE)
-            {
-                readPos = (readPos + 1) % BUF_SIZE;
-            }
-
-            dataBuffer[writePos] = frame;
-            writePos = (writePos + 1) % BUF_SIZE;
-
-            if(numElements == 0) pthread_cond_signal(&not_empty);
-            if(numElements < BUF_SIZE) numElements += 1;
-
-            pthread_mutex_unlock(&mutex);
+            PROF_START(encStart);
+            codec2_encode(codec->codec2, ((uint8_t*) &frame), audio.data);
+            PROF_STOP(PROF_CODEC2_ENCODE, encStart);
+
+            // If the queue is full drop the new frame: only the consumer is
+            // allowed to remove elements.
+            if(queuePush(codec, &frame, false) == false)
+                atomic_fetch_add(&codec->overruns, 1);
         }
     }
 
-    inputStream_stop(audioStream);
-    codec2_destroy(codec2);
+    inputStream_stop(codec->audioStream);
 
     return NULL;
 }
 
 static void *decodeFunc(void *arg)
 {
-    (void) arg;
+    codec_t *codec = (codec_t *) arg;
+
+    #ifdef PLATFORM_MD3x0
+    // Bump up volume a little bit, as on MD3x0 is quite low
+    mixer_setGain(codec->mixerSource, 2 * MIXER_UNITY_GAIN);
+    #endif
+
+    // Playback starts, and restarts once the concealment of an underrun has
+    // run out, only when the queue holds at least the number of frames
+    // required by the jitter buffer.
+    unsigned int threshold = (codec->prefill > 0) ? codec->prefill : 1;
+    bool         playing   = false;
 
-    codec2 = codec2_create(CODEC2_MODE_3200);
+    // Last good frame and number of consecutive frames concealed with it
+    uint64_t lastFrame = 0;
+    uint8_t  misses    = 0;
 
-    // Ensure that thread start is correctly synchronized with the output
-    // stream to avoid having the decode function writing in a memory area
-    // being read at the same time by the output stream system causing cracking
-    // noises at speaker output. Behaviour observed on both Module17 and MD-UV380
-    outputStream_sync(audioStream, false);
+    // Frames concealed while the queue was empty: they took the place of the
+    // first lost frame placeholders pushed afterwards, which are skipped.
+    uint8_t  borrowed  = 0;
 
-    while(stopThread == false)
+    while(codec->stopThread == false)
     {
         // Try popping data from the queue
-        uint64_t frame   = 0;
+        uint64_t frame;
         bool     newData = false;
+        bool     conceal = false;
 
-        pthread_mutex_lock(&mutex);
+        if((playing == false) && (queueCount(codec) >= threshold))
+            playing = true;
 
-        if(numElements != 0)
+        if(playing)
         {
-            frame        = dataBuffer[readPos];
-            readPos      = (readPos + 1) % BUF_SIZE;
-            if(numElements >= BUF_SIZE) pthread_cond_signal(&not_full);
-            numElements -= 1;
-            newData      = true;
-        }
+            bool lost = false;
+            newData   = queuePop(codec, &frame, &lost);
 
-        pthread_mutex_unlock(&mutex);
+            while(newData && lost && (borrowed > 0))
+            {
+                borrowed -= 1;
+                newData   = queuePop(codec, &frame, &lost);
+            }
 
-        stream_sample_t *audioBuf = outputStream_getIdleBuffer(audioStream);
+            if(newData && lost)
+            {
+                // Frame lost in transmission: conceal it in its own slot,
+                // silence once the concealment has run out.
+                newData = false;
+                conceal = (misses < CODEC_PLC_MAX_FRAMES);
+            }
+            else if(newData == false)
+            {
+                // Queue run dry in the middle of a stream: conceal the missing
+                // frames in place of the silence, for a limited time, so that
+                // frames arriving late are played without adding delay.
+                unsigned int rd  = atomic_load_explicit(&codec->readPos, memory_order_relaxed);
+                unsigned int end = atomic_load_explicit(&codec->endPos,  memory_order_acquire);
+                bool ended       = (rd == end);
+
+                if((misses == 0) && (ended == false))
+                    atomic_fetch_add(&codec->underruns, 1);
+
+                if(ended || (misses >= CODEC_PLC_MAX_FRAMES))
+                {
+                    playing  = false;
+                    borrowed = 0;
+                }
+                else
+                {
+                    conceal   = true;
+                    borrowed += 1;
+                }
+            }
+        }
+
+        stream_sample_t *audioBuf = codec->audioBuf;
 
         if(newData)
         {
-            codec2_decode(codec2, audioBuf, ((uint8_t *) &frame));
-
-            #ifdef PLATFORM_MD3x0
-            // Bump up volume a little bit, as on MD3x0 is quite low
-            for(size_t i = 0; i < 160; i++) audioBuf[i] *= 2;
-            #endif
-
+            PROF_START(decStart);
+            codec2_decode(codec->codec2, audioBuf, ((uint8_t *) &frame));
+            PROF_STOP(PROF_CODEC2_DECODE, decStart);
+            lastFrame = frame;
+            misses    = 0;
+            borrowed  = 0;
+        }
+        else if(conceal)
+        {
+            // Decode again the parameters of the last good frame and fade out,
+            // ramping the gain along the frame to avoid steps.
+            PROF_START(decStart);
+            codec2_decode(codec->codec2, audioBuf, ((uint8_t *) &lastFrame));
+            PROF_STOP(PROF_CODEC2_DECODE, decStart);
+            misses += 1;
+            atomic_fetch_add(&codec->concealed, 1);
+
+            int32_t gain = 256;
+            for(uint8_t i = 1; i < misses; i++) gain = (gain * PLC_GAIN) / 256;
+
+            int32_t step = ((gain * PLC_GAIN) / 256) - gain;
+            for(size_t i = 0; i < 160; i++)
+            {
+                int32_t g   = gain + ((step * (int32_t) i) / 160);
+                audioBuf[i] = (stream_sample_t) ((audioBuf[i] * g) / 256);
+            }
         }
         else
         {
             memset(audioBuf, 0x00, 160 * sizeof(stream_sample_t));
         }
 
-        outputStream_sync(audioStream, true);
+        // Blocks until the mixer has room for the new frame, pacing the
+        // decoder to the output stream. If the stream has been preempted the
+        // frame is dropped, keep the pace of the audio instead.
+        if(mixer_write(codec->mixerSource, audioBuf, 160, true) < 160)
+            sleepFor(0u, 20u);
     }
 
-    // Stop stream and wait until its effective termination
-    outputStream_stop(audioStream);
-    outputStream_sync(audioStream, false);
-    codec2_destroy(codec2);
+    mixer_closeSource(codec->mixerSource);
 
     return NULL;
 }
 
-static void startThread(void *(*func) (void *))
+static bool startDecode(codec_t *codec, const enum AudioSink destination,
+                        const enum AudioPriority prio, const uint8_t frames)
+{
+    if(codec == NULL) return false;
+    if(codec->running) return false;
+    if(allocState(codec) == false) return false;
+
+    codec->running     = true;
+    codec->mixerSource = mixer_openSource(destination, prio, 8000);
+
+    if(codec->mixerSource == -1)
+    {
+        freeState(codec);
+        codec->running = false;
+        return false;
+    }
+
+    queueReset(codec);
+    codec->prefill    = (frames < (CODEC_QUEUE_SIZE - 2)) ? frames
+                                                          : (CODEC_QUEUE_SIZE - 2);
+    codec->stopThread = false;
+    startThread(codec, decodeFunc);
+
+    return true;
+}
+
+static void startThread(codec_t *codec, void *(*func) (void *))
 {
     #ifdef _MIOSIX
     // Set stack size of CODEC2 thread to 16kB.
@@ -362,9 +587,8 @@ static void startThread(void *(*func) (void *))
     pthread_attr_setschedparam(&codecAttr, &param);
 
     // Start thread
-    pthread_create(&codecThread, &codecAttr, func, NULL);
+    pthread_create(&codec->codecThread, &codecAttr, func, codec);
     #else
-    pthread_create(&codecThread, NULL, func, NULL);
+    pthread_create(&codec->codecThread, NULL, func, codec);
     #endif
-
 }
@@ -0,0 +1,460 @@
+/***************************************************************************
+ *   Copyright (C) 2023 by Federico Amedeo Izzo IU2NUO,                    *
+ *                         Niccolò Izzo IU2KIN                             *
+ *                         Frederik Saraci IU2NRO                          *
+ *                         Silvano Seva IU2KWO                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+#include <interfaces/audio_stream.h>
+#include <audio_mixer.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Maximum gain of a source, limits the partial sums within 32 bit.
+ */
+#define MIXER_MAX_GAIN (8 * MIXER_UNITY_GAIN)
+
+/*
+ * Mixer source. Samples are queued in a single producer, single consumer ring
+ * buffer whose positions are free-running counters: the write position is
+ * updated only by the producer and the read position only by the mixer thread.
+ * All the other fields are protected by the mixer mutex.
+ */
+typedef struct
+{
+    bool             open;
+    uint8_t          prio;      // Source priority
+    uint16_t         gain;      // Gain requested by the user
+    uint16_t         curGain;   // Gain applied at the end of the last cycle
+    uint8_t          up;        // Interpolation factor, source slower than mixer
+    uint8_t          down;      // Decimation factor, source faster than mixer
+    stream_sample_t  last;      // Last sample read, used for interpolation
+    stream_sample_t *buf;       // Ring buffer
+    unsigned int     mask;      // Ring buffer size minus one
+    unsigned int     depth;     // Maximum number of queued samples
+    atomic_uint      readPos;
+    atomic_uint      writePos;
+}
+source_t;
+
+static source_t        sources[MIXER_MAX_SOURCES];
+static stream_sample_t outBuf[2 * MIXER_BLOCK_SIZE];
+static int32_t         mixBuf[MIXER_BLOCK_SIZE];
+static streamId        outStream     = -1;
+static uint8_t         numSources    = 0;
+static bool            threadRunning = false;   // Mixer thread owns the stream
+static bool            threadStarted = false;   // Thread created, to be joined
+static pthread_t       mixerThread;
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  space = PTHREAD_COND_INITIALIZER;
+
+// Serialises the opening and closing of sources, which start and stop the
+// mixer thread and the output stream.
+static pthread_mutex_t ctrlMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void *mixerFunc(void *arg);
+static void startThread();
+
+
+static inline bool validId(const mixerSource_t id)
+{
+    return (id >= 0) && (id < MIXER_MAX_SOURCES) && sources[id].open;
+}
+
+static inline stream_sample_t saturate(const int32_t value)
+{
+    if(value > INT16_MAX) return INT16_MAX;
+    if(value < INT16_MIN) return INT16_MIN;
+
+    return (stream_sample_t) value;
+}
+
+/*
+ * Add one cycle of data of a source to the mixing buffer, converting it to
+ * the mixer sample rate and scaling it by a gain linearly ramped from the one
+ * of the previous cycle to the new one. Faster sources are decimated averaging
+ * groups of samples, slower ones are linearly interpolated. Missing samples,
+ * in case of producer underrun, are replaced with silence.
+ */
+static void accumulate(source_t *src, const uint16_t gain)
+{
+    unsigned int rd    = atomic_load_explicit(&src->readPos,  memory_order_relaxed);
+    unsigned int wr    = atomic_load_explicit(&src->writePos, memory_order_acquire);
+    unsigned int avail = wr - rd;
+    unsigned int need  = (MIXER_BLOCK_SIZE * src->down) / src->up;
+    int32_t      g     = ((int32_t) src->curGain) * 65536;
+    int32_t      step  = ((((int32_t) gain) - src->curGain) * 65536) / MIXER_BLOCK_SIZE;
+
+    if(avail > need)
+        avail = need;
+
+    for(unsigned int i = 0; i < MIXER_BLOCK_SIZE; i += src->up)
+    {
+        int32_t sample = 0;
+
+        if(src->down > 1)
+        {
+            for(uint8_t j = 0; j < src->down; j++)
+            {
+                if(avail > 0)
+                {
+                    sample += src->buf[rd & src->mask];
+                    rd    += 1;
+                    avail -= 1;
+                }
+            }
+
+            sample /= src->down;
+        }
+        else if(avail > 0)
+        {
+            sample = src->buf[rd & src->mask];
+            rd    += 1;
+            avail -= 1;
+        }
+
+        // Linear interpolation between the previous sample and the new one,
+        // reduces to a plain copy when the source runs at the mixer rate.
+        int32_t delta = sample - src->last;
+        for(uint8_t j = 1; j <= src->up; j++)
+        {
+            int32_t value = src->last + ((delta * j) / src->up);
+            mixBuf[i + j - 1] += value * (g >> 16);
+            g += step;
+        }
+
+        src->last = (stream_sample_t) sample;
+    }
+
+    atomic_store_explicit(&src->readPos, rd, memory_order_release);
+    src->curGain = gain;
+}
+
+/*
+ * Mix all the open sources into a block of output samples. Must be called
+ * with the mixer mutex locked.
+ */
+static void mix(stream_sample_t *out)
+{
+    uint8_t maxPrio = 0;
+
+    for(size_t i = 0; i < MIXER_MAX_SOURCES; i++)
+    {
+        if(sources[i].open && (sources[i].prio > maxPrio))
+            maxPrio = sources[i].prio;
+    }
+
+    memset(mixBuf, 0x00, sizeof(mixBuf));
+
+    for(size_t i = 0; i < MIXER_MAX_SOURCES; i++)
+    {
+        source_t *src = &sources[i];
+        if(src->open == false)
+            continue;
+
+        uint16_t gain = src->gain;
+        if(src->prio < maxPrio)
+            gain = (gain * MIXER_DUCK_GAIN) / MIXER_UNITY_GAIN;
+
+        accumulate(src, gain);
+    }
+
+    for(size_t i = 0; i < MIXER_BLOCK_SIZE; i++)
+        out[i] = saturate(mixBuf[i] / MIXER_UNITY_GAIN);
+}
+
+
+mixerSource_t mixer_openSource(const enum AudioSink destination,
+                               const enum AudioPriority prio,
+                               const uint32_t sampleRate)
+{
+    uint8_t up   = 1;
+    uint8_t down = 1;
+
+    if(destination != SINK_SPK)
+        return -1;
+
+    if((sampleRate == 0) || (sampleRate > (255 * MIXER_SAMPLE_RATE)))
+        return -1;
+
+    // Only integer ratios between source and mixer sample rates are supported
+    if((sampleRate >= MIXER_SAMPLE_RATE) && ((sampleRate % MIXER_SAMPLE_RATE) == 0))
+        down = sampleRate / MIXER_SAMPLE_RATE;
+    else if((MIXER_SAMPLE_RATE % sampleRate) == 0)
+        up = MIXER_SAMPLE_RATE / sampleRate;
+    else
+        return -1;
+
+    if((MIXER_BLOCK_SIZE % up) != 0)
+        return -1;
+
+    // Queue up to two cycles of source samples, ring buffer size is rounded
+    // up to the next power of two.
+    unsigned int depth = (2 * MIXER_BLOCK_SIZE * down) / up;
+    unsigned int size  = 1;
+    while(size < depth) size <<= 1;
+
+    stream_sample_t *buf = (stream_sample_t *) malloc(size * sizeof(stream_sample_t));
+    if(buf == NULL)
+        return -1;
+
+    pthread_mutex_lock(&ctrlMutex);
+    pthread_mutex_lock(&mutex);
+
+    mixerSource_t id = -1;
+    for(mixerSource_t i = 0; i < MIXER_MAX_SOURCES; i++)
+    {
+        if(sources[i].open == false)
+        {
+            id = i;
+            break;
+        }
+    }
+
+    // Start the output stream, if not already running. A mixer thread whose
+    // stream has been preempted has already exited, join it before starting
+    // a new one.
+    if((id >= 0) && (threadRunning == false))
+    {
+        if(threadStarted)
+        {
+            pthread_join(mixerThread, NULL);
+            threadStarted = false;
+        }
+
+        memset(outBuf, 0x00, sizeof(outBuf));
+        outStream = outputStream_start(SINK_SPK, PRIO_PROMPT, outBuf,
+                                       2 * MIXER_BLOCK_SIZE, BUF_CIRC_DOUBLE,
+                                       MIXER_SAMPLE_RATE);
+
+        if(outStream < 0)
+            id = -1;
+        else
+            startThread();
+    }
+
+    if(id < 0)
+    {
+        pthread_mutex_unlock(&mutex);
+        pthread_mutex_unlock(&ctrlMutex);
+        free(buf);
+        return -1;
+    }
+
+    source_t *src = &sources[id];
+    src->prio     = prio;
+    src->gain     = MIXER_UNITY_GAIN;
+    src->curGain  = MIXER_UNITY_GAIN;
+    src->up       = up;
+    src->down     = down;
+    src->last     = 0;
+    src->buf      = buf;
+    src->mask     = size - 1;
+    src->depth    = depth;
+    atomic_store(&src->readPos,  0);
+    atomic_store(&src->writePos, 0);
+    src->open     = true;
+    numSources   += 1;
+
+    pthread_mutex_unlock(&mutex);
+    pthread_mutex_unlock(&ctrlMutex);
+
+    return id;
+}
+
+void mixer_setGain(const mixerSource_t id, const uint16_t gain)
+{
+    pthread_mutex_lock(&mutex);
+
+    if(validId(id))
+        sources[id].gain = (gain < MIXER_MAX_GAIN) ? gain : MIXER_MAX_GAIN;
+
+    pthread_mutex_unlock(&mutex);
+}
+
+size_t mixer_write(const mixerSource_t id, const stream_sample_t *samples,
+                   const size_t length, const bool blocking)
+{
+    if((id < 0) || (id >= MIXER_MAX_SOURCES))
+        return 0;
+
+    source_t *src     = &sources[id];
+    size_t    written = 0;
+
+    while(written < length)
+    {
+        unsigned int wr   = atomic_load_explicit(&src->writePos, memory_order_relaxed);
+        unsigned int rd   = atomic_load_explicit(&src->readPos,  memory_order_acquire);
+        size_t       room = src->depth - (wr - rd);
+
+        if(room == 0)
+        {
+            if(blocking == false)
+                break;
+
+            // The mixer thread signals after each cycle, with the mutex held:
+            // checking again under the mutex ensures no wakeup is lost. If the
+            // output stream has been preempted nobody consumes the samples.
+            pthread_mutex_lock(&mutex);
+            while((atomic_load(&src->writePos) - atomic_load(&src->readPos) >= src->depth)
+                  && threadRunning)
+            {
+                pthread_cond_wait(&space, &mutex);
+            }
+
+            bool running = threadRunning;
+            pthread_mutex_unlock(&mutex);
+
+            if(running == false)
+                break;
+
+            continue;
+        }
+
+        if(room > (length - written))
+            room = length - written;
+
+        for(size_t i = 0; i < room; i++)
+            src->buf[(wr + i) & src->mask] = samples[written + i];
+
+        atomic_store_explicit(&src->writePos, wr + room, memory_order_release);
+        written += room;
+    }
+
+    return written;
+}
+
+void mixer_closeSource(const mixerSource_t id)
+{
+    pthread_mutex_lock(&ctrlMutex);
+    pthread_mutex_lock(&mutex);
+
+    if(validId(id) == false)
+    {
+        pthread_mutex_unlock(&mutex);
+        pthread_mutex_unlock(&ctrlMutex);
+        return;
+    }
+
+    source_t *src = &sources[id];
+    free(src->buf);
+    src->buf   = NULL;
+    src->open  = false;
+    numSources -= 1;
+
+    // Last source closed: terminate the mixer thread, which exits at the end
+    // of the current cycle.
+    bool stop = (numSources == 0) && threadStarted;
+    if(stop)
+        threadRunning = false;
+
+    pthread_mutex_unlock(&mutex);
+
+    // Stop the output stream and wait until its effective termination, unless
+    // it has been preempted by another one in the meantime.
+    if(stop)
+    {
+        pthread_join(mixerThread, NULL);
+        threadStarted = false;
+
+        if(outStream >= 0)
+        {
+            outputStream_stop(outStream);
+            outputStream_sync(outStream, false);
+            outStream = -1;
+        }
+    }
+
+    pthread_mutex_unlock(&ctrlMutex);
+}
+
+
+
+/*
+ * Release the output stream after it has been preempted by another one with
+ * higher priority: the stream no longer belongs to the mixer and must not be
+ * stopped. Blocked writers are woken up, their samples are discarded.
+ */
+static void streamPreempted()
+{
+    pthread_mutex_lock(&mutex);
+    threadRunning = false;
+    outStream     = -1;
+    pthread_cond_broadcast(&space);
+    pthread_mutex_unlock(&mutex);
+}
+
+static void *mixerFunc(void *arg)
+{
+    (void) arg;
+
+    // Synchronise with the output stream before writing the first block
+    if(outputStream_sync(outStream, false) == false)
+    {
+        streamPreempted();
+        return NULL;
+    }
+
+    while(true)
+    {
+        stream_sample_t *out = outputStream_getIdleBuffer(outStream);
+
+        pthread_mutex_lock(&mutex);
+
+        if(threadRunning == false)
+        {
+            pthread_mutex_unlock(&mutex);
+            break;
+        }
+
+        mix(out);
+        pthread_cond_broadcast(&space);
+        pthread_mutex_unlock(&mutex);
+
+        if(outputStream_sync(outStream, true) == false)
+        {
+            streamPreempted();
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+static void startThread()
+{
+    threadRunning = true;
+    threadStarted = true;
+
+    #ifdef _MIOSIX
+    // Set stack size of the mixer thread to 2kB.
+    pthread_attr_t mixerAttr;
+    pthread_attr_init(&mixerAttr);
+    pthread_attr_setstacksize(&mixerAttr, 2048);
+
+    // Set priority of the mixer thread to the maximum one, as the codec one.
+    struct sched_param param;
+    param.sched_priority = sched_get_priority_max(0);
+    pthread_attr_setschedparam(&mixerAttr, &param);
+
+    pthread_create(&mixerThread, &mixerAttr, mixerFunc, NULL);
+    #else
+    pthread_create(&mixerThread, NULL, mixerFunc, NULL);
+    #endif
+}
@@ -19,148 +19,225 @@
  ***************************************************************************/
 
 #include <audio_path.h>
-#include <map>
-#include <set>
+#include <cstddef>
+#include <array>
+
+/**
+ * Maximum number of audio paths existing at the same time, either open or
+ * suspended. Must not exceed the width of the route masks.
+ */
+#ifndef AUDIO_PATH_MAX_ROUTES
+#define AUDIO_PATH_MAX_ROUTES 16
+#endif
+
+static_assert(AUDIO_PATH_MAX_ROUTES <= 32, "Too many audio routes");
+
+/**
+ * \internal
+ * Number of audio endpoints on each side of a path and number of possible
+ * paths, each one identified by the index source * 3 + sink.
+ */
+static constexpr uint8_t NUM_ENDPOINTS = 3;
+static constexpr uint8_t NUM_PATHS     = NUM_ENDPOINTS * NUM_ENDPOINTS;
 
 /**
  * \internal
- * Data structure representing an audio path with source, destination and
- * priority.
+ * Data structure representing an established audio route. Sets of routes are
+ * represented as bit masks, where bit i corresponds to the route in slot i.
  */
-struct Path
+struct Route
 {
-    int8_t source      = -1;   ///< Source endpoint of the path.
-    int8_t destination = -1;   ///< Destination endpoint of the path.
-    int8_t priority    = -1;   ///< Path priority level.
+    pathId   id;            ///< Path ID, zero if the slot is free.
+    uint8_t  path;          ///< Path index.
+    int8_t   priority;      ///< Path priority level.
+    uint32_t suspendList;   ///< Suspended routes with lower priority.
+    uint32_t suspendedBy;   ///< Routes which suspended this one.
 
-    bool isValid() const
+    bool isActive() const
     {
-        return (source      != -1) &&
-               (destination != -1) &&
-               (priority    != -1);
+        return suspendedBy == 0;
     }
+};
 
-    void open() const
-    {
-        if(isValid() == false)
-            return;
 
-        enum AudioSource src  = (enum AudioSource) source;
-        enum AudioSink   sink = (enum AudioSink)   destination;
+static Route    routes[AUDIO_PATH_MAX_ROUTES];  // Route data, indexed by slot.
+static uint32_t activeRoutes = 0;               // Slots of currently active routes.
+static uint8_t  connections[NUM_PATHS];         // Active routes using each path.
+static pathId   pathCounter  = 1;               // Counter for path ID generation.
 
-        audio_connect(src, sink);
-    }
 
-    void close() const
-    {
-        if(isValid() == false)
-            return;
+/**
+ * \internal
+ * Compute the compatibility masks of all the paths from the platform
+ * compatibility table. Audio from MCU to speaker goes through the software
+ * mixer, thus more paths of this kind can share the same connection.
+ */
+static std::array< uint16_t, NUM_PATHS > buildCompatibility()
+{
+    const uint8_t mixed = (SOURCE_MCU * NUM_ENDPOINTS) + SINK_SPK;
+    std::array< uint16_t, NUM_PATHS > compatible;
 
-        enum AudioSource src  = (enum AudioSource) source;
-        enum AudioSink   sink = (enum AudioSink)   destination;
+    for(uint8_t p1 = 0; p1 < NUM_PATHS; p1++)
+    {
+        compatible[p1] = 0;
 
-        audio_disconnect(src, sink);
+        for(uint8_t p2 = 0; p2 < NUM_PATHS; p2++)
+        {
+            auto p1Source = (enum AudioSource) (p1 / NUM_ENDPOINTS);
+            auto p1Sink   = (enum AudioSink)   (p1 % NUM_ENDPOINTS);
+            auto p2Source = (enum AudioSource) (p2 / NUM_ENDPOINTS);
+            auto p2Sink   = (enum AudioSink)   (p2 % NUM_ENDPOINTS);
+
+            bool compat = audio_checkPathCompatibility(p1Source, p1Sink,
+                                                       p2Source, p2Sink);
+            if((p1 == mixed) && (p2 == mixed))
+                compat = true;
+
+            if(compat)
+                compatible[p1] |= (1 << p2);
+        }
     }
 
-    bool isCompatible(const Path& other) const
-    {
-        if((isValid() == false) || (other.isValid() == false))
-            return false;
+    return compatible;
+}
 
-        enum AudioSource p1Source = (enum AudioSource) source;
-        enum AudioSource p2Source = (enum AudioSource) other.source;
-        enum AudioSink   p1Sink   = (enum AudioSink)   destination;
-        enum AudioSink   p2Sink   = (enum AudioSink)   other.destination;
+// Paths compatible with each path, computed once at startup from the constant
+// table of the platform, before any thread can request a path.
+static const std::array< uint16_t, NUM_PATHS > compatible = buildCompatibility();
 
-        return audio_checkPathCompatibility(p1Source, p1Sink, p2Source, p2Sink);
-    }
+/**
+ * \internal
+ * Get the slot of the route with a given ID.
+ *
+ * @param id: path ID.
+ * @return slot index or -1 if no route with the given ID exists.
+ */
+static int findRoute(const pathId id)
+{
+    if(id <= 0)
+        return -1;
 
-    bool operator<(const Path& other) const
-    {
-        if((isValid() == false) || (other.isValid() == false))
-            return false;
+    int slot = id % AUDIO_PATH_MAX_ROUTES;
+    if(routes[slot].id != id)
+        return -1;
 
-        return (source      < other.source) &&
-               (destination < other.destination);
-    }
-};
+    return slot;
+}
 
 /**
  * \internal
- * Data structure representing an established audio route.
+ * Mark a route as active, connecting its path if not already in use by other
+ * active routes.
  */
-struct Route
+static void activate(const int slot)
 {
-    Path path;                    ///< Path associated to this route.
-    std::set< int > suspendList;  ///< Suspended paths with lower priority.
-    std::set< int > suspendedBy;  ///< List of paths which suspended this route.
+    uint8_t path = routes[slot].path;
 
-    bool isActive() const
+    activeRoutes |= (1UL << slot);
+    connections[path] += 1;
+
+    if(connections[path] == 1)
     {
-        return suspendedBy.empty();
+        audio_connect((enum AudioSource) (path / NUM_ENDPOINTS),
+                      (enum AudioSink)   (path % NUM_ENDPOINTS));
     }
-};
+}
+
+/**
+ * \internal
+ * Mark a route as not active, disconnecting its path if not in use by other
+ * active routes.
+ */
+static void deactivate(const int slot)
+{
+    uint8_t path = routes[slot].path;
 
+    activeRoutes &= ~(1UL << slot);
+    connections[path] -= 1;
 
-static std::set< int >        activePaths;      // IDs of currently active paths.
-static std::map< int, Route > routes;           // Route data of currently active paths.
-static int                    pathCounter = 1;  // Counter for path ID generation.
+    if(connections[path] == 0)
+    {
+        audio_disconnect((enum AudioSource) (path / NUM_ENDPOINTS),
+                         (enum AudioSink)   (path % NUM_ENDPOINTS));
+    }
+}
 
 
 pathId audioPath_request(enum AudioSource source, enum AudioSink sink,
                          enum AudioPriority prio)
 {
-    const Path path{source, sink, prio};
-    if (!path.isValid())
+    if(((unsigned) source >= NUM_ENDPOINTS) ||
+       ((unsigned) sink   >= NUM_ENDPOINTS) || ((int) prio < 0))
         return -1;
 
-    std::set< int > pathsToSuspend;
+    const uint8_t path = (source * NUM_ENDPOINTS) + sink;
+    uint32_t pathsToSuspend = 0;
 
     // Check if this new path can be activated, otherwise return -1
-    for (const auto& id : activePaths)
+    for(uint32_t mask = activeRoutes; mask != 0; mask &= (mask - 1))
     {
-        const Path& activePath = routes.at(id).path;
-        if(path.isCompatible(activePath))
+        int i = __builtin_ctz(mask);
+        const Route& active = routes[i];
+
+        if((compatible[path] & (1 << active.path)) != 0)
             continue;
 
         // Not compatible where active one has higher priority
-        if(activePath.priority >= path.priority)
+        if(active.priority >= prio)
             return -1;
 
         // Active path has lower priority than this new one
-        pathsToSuspend.insert(id);
+        pathsToSuspend |= (1UL << i);
     }
 
-    // New path can be activated
-    const int newPathId = pathCounter;
+    // Find a free slot, the ID encodes the slot index
+    int slot = -1;
+    for(int i = 0; i < AUDIO_PATH_MAX_ROUTES; i++)
+    {
+        if(routes[i].id == 0)
+        {
+            slot = i;
+            break;
+        }
+    }
+
+    if(slot < 0)
+        return -1;
+
+    if(pathCounter > (INT32_MAX / AUDIO_PATH_MAX_ROUTES) - 1)
+        pathCounter = 1;
+
+    const pathId newPathId = (pathCounter * AUDIO_PATH_MAX_ROUTES) + slot;
     pathCounter += 1;
-    const Route newRoute{path, pathsToSuspend, {}};
 
-    // Move active paths that should be suspended to the suspend-list and
-    // close them to free resources for the new path.
-    for(const auto& id : pathsToSuspend)
+    // Suspend the incompatible active paths, closing them to free resources
+    // for the new path.
+    for(uint32_t mask = pathsToSuspend; mask != 0; mask &= (mask - 1))
     {
-        activePaths.erase(id);
-        routes.at(id).suspendedBy.insert(newPathId);
-        routes.at(id).path.close();
+        int i = __builtin_ctz(mask);
+        routes[i].suspendedBy |= (1UL << slot);
+        deactivate(i);
     }
 
     // Set this new path as active and open it
-    routes.insert(std::make_pair(newPathId, newRoute));
-    activePaths.insert(newPathId);
-    path.open();
+    routes[slot].id          = newPathId;
+    routes[slot].path        = path;
+    routes[slot].priority    = prio;
+    routes[slot].suspendList = pathsToSuspend;
+    routes[slot].suspendedBy = 0;
+    activate(slot);
 
     return newPathId;
 }
 
 enum PathStatus audioPath_getStatus(const pathId id)
 {
-    const auto it = routes.find(id);
+    int slot = findRoute(id);
 
-    if(it == routes.end())
+    if(slot < 0)
         return PATH_CLOSED;
 
-    if(it->second.isActive())
+    if(routes[slot].isActive())
         return PATH_OPEN;
 
     return PATH_SUSPENDED;
@@ -168,30 +245,28 @@ enum PathStatus audioPath_getStatus(const pathId id)
 
 void audioPath_release(const pathId id)
 {
-    auto it = routes.find(id);
-    if(it == routes.end())  // Does not exists
+    int slot = findRoute(id);
+    if(slot < 0)  // Does not exists
         return;
 
-    Route routeToRemove = it->second;
-    routes.erase(it);
-    activePaths.erase(id);
+    const Route    routeToRemove = routes[slot];
+    const uint32_t bit           = (1UL << slot);
 
     // If path is active, close it
     if(routeToRemove.isActive())
-        routeToRemove.path.close();
+        deactivate(slot);
+
+    routes[slot].id = 0;
 
     /*
      * For each path that suspended the one to be removed:
      * - remove the ID from its suspend list.
      * - add to its suspend list the paths suspended by the one being removed.
      */
-    for(const auto& i : routeToRemove.suspendedBy)
+    for(uint32_t mask = routeToRemove.suspendedBy; mask != 0; mask &= (mask - 1))
     {
-        auto& suspendList = routes.at(i).suspendList;
-        suspendList.erase(id);
-
-        for(const auto& j : routeToRemove.suspendList)
-            suspendList.insert(j);
+        Route& route = routes[__builtin_ctz(mask)];
+        route.suspendList = (route.suspendList & ~bit) | routeToRemove.suspendList;
     }
 
     /*
@@ -202,25 +277,15 @@ void audioPath_release(const pathId id)
      * - if the path to be removed was not suspended by any other path, resume
      *   the path.
      */
-    for(const auto& i : routeToRemove.suspendList)
+    for(uint32_t mask = routeToRemove.suspendList; mask != 0; mask &= (mask - 1))
     {
-        auto& suspendedBy = routes.at(i).suspendedBy;
-        suspendedBy.erase(id);
+        int    i     = __builtin_ctz(mask);
+        Route& route = routes[i];
 
-        if(routeToRemove.suspendedBy.empty() == false)
-        {
-            // If I was suspended, propagate who suspended me
-            for(const auto& j : routeToRemove.suspendedBy)
-                suspendedBy.insert(j);
-        }
-        else
-        {
-            // This path can be started again
-            if(suspendedBy.empty())
-            {
-                activePaths.insert(i);
-                routes.at(i).path.open();
-            }
-        }
+        route.suspendedBy = (route.suspendedBy & ~bit) | routeToRemove.suspendedBy;
+
+        // This path can be started again
+        if(route.suspendedBy == 0)
+            activate(i);
     }
 }
@@ -113,6 +113,12 @@ static rgb565_t _true2highColor(color_t true_color)
     return high_color;
 }
 
+/*
+ * Pixel spans are written with 16 and 32 bit stores.
+ */
+typedef uint16_t __attribute__((may_alias)) pix16_t;
+typedef uint32_t __attribute__((may_alias)) pix32_t;
+
 #elif defined PIX_FMT_BW
 
 /**
@@ -149,6 +155,163 @@ static PIXEL_T *buf;
 static uint16_t fbSize;
 static char text[32];
 
+/*
+ * Range of framebuffer rows modified since the last render, end excluded.
+ * The range is empty when dirtyStart >= dirtyEnd.
+ */
+static int16_t dirtyStart;
+static int16_t dirtyEnd;
+
+static inline void markDirty(int16_t startRow, int16_t endRow)
+{
+    if(startRow < dirtyStart) dirtyStart = startRow;
+    if(endRow   > dirtyEnd)   dirtyEnd   = endRow;
+}
+
+/*
+ * Drawing colour, converted to the framebuffer pixel format.
+ */
+typedef struct
+{
+#ifdef PIX_FMT_RGB565
+    rgb565_t pixel;     // Converted colour
+    uint16_t value;     // Converted colour, as a raw framebuffer value
+#elif defined PIX_FMT_BW
+    uint8_t  fill;      // Value of a framebuffer byte with all pixels set
+#endif
+    uint8_t  alpha;     // Colour opacity
+}
+pen_t;
+
+static inline pen_t makePen(color_t color)
+{
+    pen_t pen;
+    pen.alpha = color.alpha;
+
+#ifdef PIX_FMT_RGB565
+    pen.pixel = _true2highColor(color);
+    memcpy(&pen.value, &pen.pixel, sizeof(pen.value));
+#elif defined PIX_FMT_BW
+    pen.fill = (_color2bw(color) == BLACK) ? 0xFF : 0x00;
+#endif
+
+    return pen;
+}
+
+/**
+ * \internal
+ * Draw an horizontal span of pixels. Coordinates have to be already clipped
+ * to the screen and the span must not be empty.
+ *
+ * @param pen: drawing colour.
+ * @param x0: leftmost column of the span.
+ * @param x1: column following the rightmost one of the span.
+ * @param y: row of the span.
+ */
+static inline void drawSpan(const pen_t *pen, int32_t x0, int32_t x1, int32_t y)
+{
+#ifdef PIX_FMT_RGB565
+    if(pen->alpha < 255)
+    {
+        // Blend old pixel values and new one
+        uint16_t alpha = pen->alpha;
+        uint16_t beta  = 255 - alpha;
+        rgb565_t *ptr  = &buf[x0 + y*SCREEN_WIDTH];
+
+        for(int32_t x = x0; x < x1; x++, ptr++)
+        {
+            rgb565_t pixel;
+            pixel.r = (beta*ptr->r + alpha*pen->pixel.r)/255;
+            pixel.g = (beta*ptr->g + alpha*pen->pixel.g)/255;
+            pixel.b = (beta*ptr->b + alpha*pen->pixel.b)/255;
+            *ptr = pixel;
+        }
+
+        return;
+    }
+
+    pix16_t *ptr = (pix16_t *) &buf[x0 + y*SCREEN_WIDTH];
+    int32_t  len = x1 - x0;
+
+    // Align to a word boundary, then write two pixels at a time
+    if((((uintptr_t) ptr) & 0x02) != 0)
+    {
+        *ptr++ = pen->value;
+        len--;
+    }
+
+    uint32_t pair   = (((uint32_t) pen->value) << 16) | pen->value;
+    pix32_t *ptr32 = (pix32_t *) ptr;
+    for(; len >= 2; len -= 2)
+        *ptr32++ = pair;
+
+    if(len > 0)
+        *((pix16_t *) ptr32) = pen->value;
+#elif defined PIX_FMT_BW
+    // Ignore more than half transparent pixels
+    if(pen->alpha < 128) return;
+
+    uint32_t start = x0 + y*SCREEN_WIDTH;
+    uint32_t end   = x1 + y*SCREEN_WIDTH;
+    uint32_t cell  = start / 8;
+    uint8_t  fill  = pen->fill;
+    uint8_t  mask;
+
+    // Span contained in a single byte
+    if(cell == ((end - 1) / 8))
+    {
+        mask = (0xFF << (start % 8)) & (0xFF >> (8 - (end - cell*8)));
+        buf[cell] = (buf[cell] & ~mask) | (fill & mask);
+        return;
+    }
+
+    // Leading partial byte, whole bytes and trailing partial byte
+    if((start % 8) != 0)
+    {
+        mask = 0xFF << (start % 8);
+        buf[cell] = (buf[cell] & ~mask) | (fill & mask);
+        cell++;
+    }
+
+    memset(buf + cell, fill, (end / 8) - cell);
+
+    if((end % 8) != 0)
+    {
+        cell = end / 8;
+        mask = 0xFF >> (8 - (end % 8));
+        buf[cell] = (buf[cell] & ~mask) | (fill & mask);
+    }
+#endif
+}
+
+/**
+ * \internal
+ * Fill a rectangular area of the framebuffer with a given colour. The area is
+ * clipped to the screen and the colour converted only once, then each row is
+ * written as a single span.
+ *
+ * @param x0: leftmost column of the area.
+ * @param y0: topmost row of the area.
+ * @param x1: column following the rightmost one of the area.
+ * @param y1: row following the bottom one of the area.
+ * @param color: fill colour.
+ */
+static void fillArea(int32_t x0, int32_t y0, int32_t x1, int32_t y1,
+                     color_t color)
+{
+    if(x0 < 0) x0 = 0;
+    if(y0 < 0) y0 = 0;
+    if(x1 > SCREEN_WIDTH)  x1 = SCREEN_WIDTH;
+    if(y1 > SCREEN_HEIGHT) y1 = SCREEN_HEIGHT;
+    if((x0 >= x1) || (y0 >= y1)) return;
+
+    pen_t pen = makePen(color);
+    for(int32_t y = y0; y < y1; y++)
+        drawSpan(&pen, x0, x1, y);
+
+    markDirty(y0, y1);
+}
+
 void gfx_init()
 {
     display_init();
@@ -166,6 +329,10 @@ void gfx_init()
 #endif
     // Clear text buffer
     memset(text, 0x00, 32);
+
+    // Display content is unknown, first render has to be a full one
+    dirtyStart = 0;
+    dirtyEnd   = SCREEN_HEIGHT;
 }
 
 void gfx_terminate()
@@ -181,7 +348,20 @@ void gfx_renderRows(uint8_t startRow, uint8_t endRow)
 
 void gfx_render()
 {
+    /*
+     * Only color displays are partially rendered: all their drivers address
+     * the screen by pixel rows, while monochrome ones use either pixel rows
+     * or pages and their framebuffer is small anyway.
+     */
+    #ifdef PIX_FMT_RGB565
+    if(dirtyStart < dirtyEnd)
+        display_renderRows(dirtyStart, dirtyEnd);
+    #else
     display_render();
+    #endif
+
+    dirtyStart = SCREEN_HEIGHT;
+    dirtyEnd   = 0;
 }
 
 bool gfx_renderingInProgress()
@@ -192,11 +372,28 @@ bool gfx_renderingInProgress()
 void gfx_clearRows(uint8_t startRow, uint8_t endRow)
 {
     if(!initialized) return;
-    if(endRow < startRow) return;
-    uint16_t start = startRow * SCREEN_WIDTH * sizeof(PIXEL_T);
-    uint16_t height = endRow - startRow * SCREEN_WIDTH * sizeof(PIXEL_T);
+    if(endRow > SCREEN_HEIGHT) endRow = SCREEN_HEIGHT;
+    if(endRow <= startRow) return;
+
+#ifdef PIX_FMT_RGB565
+    uint32_t start = startRow * SCREEN_WIDTH;
+    uint32_t len   = (endRow - startRow) * SCREEN_WIDTH;
     // Set the specified rows to 0x00 = make the screen black
-    memset(buf + start, 0x00, height);
+    memset(buf + start, 0x00, len * sizeof(PIXEL_T));
+#elif defined PIX_FMT_BW
+    // Rows may not start on a byte boundary, clear the partial bytes first
+    uint32_t bit = startRow * SCREEN_WIDTH;
+    uint32_t end = endRow * SCREEN_WIDTH;
+    for(; ((bit % 8) != 0) && (bit < end); bit++)
+        buf[bit / 8] &= ~(1 << (bit % 8));
+
+    for(; (end % 8) != 0 && (end > bit); end--)
+        buf[(end - 1) / 8] &= ~(1 << ((end - 1) % 8));
+
+    memset(buf + (bit / 8), 0x00, (end - bit) / 8);
+#endif
+
+    markDirty(startRow, endRow);
 }
 
 void gfx_clearScreen()
@@ -204,19 +401,13 @@ void gfx_clearScreen()
     if(!initialized) return;
     // Set the whole framebuffer to 0x00 = make the screen black
     memset(buf, 0x00, fbSize);
+    markDirty(0, SCREEN_HEIGHT);
 }
 
 void gfx_fillScreen(color_t color)
 {
     if(!initialized) return;
-    for(int16_t y = 0; y < SCREEN_HEIGHT; y++)
-    {
-        for(int16_t x = 0; x < SCREEN_WIDTH; x++)
-        {
-            point_t pos = {x, y};
-            gfx_setPixel(pos, color);
-        }
-    }
+    fillArea(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, color);
 }
 
 inline void gfx_setPixel(point_t pos, color_t color)
@@ -225,6 +416,8 @@ inline void gfx_setPixel(point_t pos, color_t color)
             || pos.x < 0 || pos.y < 0)
         return; // off the screen
 
+    markDirty(pos.y, pos.y + 1);
+
 #ifdef PIX_FMT_RGB565
     // Blend old pixel value and new one
     if (color.alpha < 255)
@@ -319,24 +512,29 @@ void gfx_drawRect(point_t start, uint16_t width, uint16_t height, color_t color,
     if(!initialized) return;
     if(width == 0) return;
     if(height == 0) return;
-    uint16_t x_max = start.x + width - 1;
-    uint16_t y_max = start.y + height - 1;
-    bool perimeter = 0;
-    if(x_max > (SCREEN_WIDTH - 1)) x_max = SCREEN_WIDTH - 1;
-    if(y_max > (SCREEN_HEIGHT - 1)) y_max = SCREEN_HEIGHT - 1;
-    for(int16_t y = start.y; y <= y_max; y++)
+
+    // Right and bottom sides are clipped to the screen edges
+    int32_t x_max = start.x + width;
+    int32_t y_max = start.y + height;
+    if(x_max > SCREEN_WIDTH)  x_max = SCREEN_WIDTH;
+    if(y_max > SCREEN_HEIGHT) y_max = SCREEN_HEIGHT;
+
+    if(fill)
     {
-        for(int16_t x = start.x; x <= x_max; x++)
-        {
-            if(y == start.y || y == y_max || x == start.x || x == x_max) perimeter = 1;
-            else perimeter = 0;
-            // If fill is false, draw only rectangle perimeter
-            if(fill || perimeter)
-            {
-                point_t pos = {x, y};
-                gfx_setPixel(pos, color);
-            }
-        }
+        fillArea(start.x, start.y, x_max, y_max, color);
+        return;
+    }
+
+    // Draw only rectangle perimeter, each pixel exactly once
+    fillArea(start.x, start.y, x_max, start.y + 1, color);
+    if(y_max - start.y > 1)
+        fillArea(start.x, y_max - 1, x_max, y_max, color);
+
+    if(y_max - start.y > 2)
+    {
+        fillArea(start.x, start.y + 1, start.x + 1, y_max - 1, color);
+        if(x_max - start.x > 1)
+            fillArea(x_max - 1, start.y + 1, x_max, y_max - 1, color);
     }
 }
 
@@ -401,14 +599,14 @@ void gfx_drawCircle(point_t start, uint16_t r, color_t color)
 
 void gfx_drawHLine(int16_t y, uint16_t height, color_t color)
 {
-    point_t start = {0, y};
-    gfx_drawRect(start, SCREEN_WIDTH, height, color, 1);
+    if(!initialized) return;
+    fillArea(0, y, SCREEN_WIDTH, y + height, color);
 }
 
 void gfx_drawVLine(int16_t x, uint16_t width, color_t color)
 {
-    point_t start = {x, 0};
-    gfx_drawRect(start, width, SCREEN_HEIGHT, color, 1);
+    if(!initialized) return;
+    fillArea(x, 0, x + width, SCREEN_HEIGHT, color);
 }
 
 /**
@@ -453,6 +651,224 @@ static inline uint16_t get_reset_x(textAlign_t alignment, uint16_t line_size,
     return 0;
 }
 
+/*
+ * Glyph cache: the most recently drawn glyphs are kept decoded as runs of set
+ * pixels, so that redrawing them does not require to unpack their bitmap.
+ * Entries are replaced on a least recently used basis. Glyphs having more runs
+ * than an entry can hold are decoded and drawn in chunks at every use.
+ *
+ * Each entry takes 8 + 3 * GLYPH_CACHE_RUNS bytes of RAM: the default sizes
+ * amount to 6400 bytes for color displays and to 832 bytes for the monochrome
+ * ones, mounted on the radios with less memory. Targets can override them in
+ * their hwconfig.h.
+ */
+#ifndef GLYPH_CACHE_SIZE
+#ifdef PIX_FMT_BW
+#define GLYPH_CACHE_SIZE 8
+#else
+#define GLYPH_CACHE_SIZE 32
+#endif
+#endif
+
+#ifndef GLYPH_CACHE_RUNS
+#ifdef PIX_FMT_BW
+#define GLYPH_CACHE_RUNS 32
+#else
+#define GLYPH_CACHE_RUNS 64
+#endif
+#endif
+
+typedef struct
+{
+    uint8_t x;      // First pixel of the run, relative to the glyph bitmap
+    uint8_t y;      // Row of the run, relative to the glyph bitmap
+    uint8_t len;    // Length of the run
+}
+glyphRun_t;
+
+typedef struct
+{
+    uint32_t   lastUse;     // Value of the use counter when last drawn
+    char       c;           // Cached character, zero if the entry is empty
+    uint8_t    size;        // Font size of the cached character
+    uint8_t    numRuns;     // Number of runs
+    glyphRun_t runs[GLYPH_CACHE_RUNS];
+}
+cachedGlyph_t;
+
+static cachedGlyph_t glyphCache[GLYPH_CACHE_SIZE];
+static uint32_t      glyphUseCount;
+
+/**
+ * \internal
+ * Decode the bitmap of a glyph into runs of set pixels. Only the runs starting
+ * from a given one are stored, up to the capacity of a cache entry.
+ *
+ * @param f: font of the glyph.
+ * @param glyph: glyph to be decoded.
+ * @param entry: cache entry where to store the runs.
+ * @param skip: number of runs to be skipped.
+ * @return total number of runs of the glyph.
+ */
+static uint16_t decodeGlyph(const GFXfont *f, const GFXglyph *glyph,
+                            cachedGlyph_t *entry, uint16_t skip)
+{
+    const uint8_t *bitmap = f->bitmap + glyph->bitmapOffset;
+    uint16_t numRuns = 0;
+    uint8_t  bits    = 0;
+    uint8_t  bit     = 0;
+
+    entry->numRuns = 0;
+
+    for(uint8_t yy = 0; yy < glyph->height; yy++)
+    {
+        int16_t runX = -1;
+
+        // One extra iteration to close the runs ending on the last column
+        for(uint8_t xx = 0; xx <= glyph->width; xx++)
+        {
+            bool set = false;
+            if(xx < glyph->width)
+            {
+                if(!(bit++ & 7))
+                    bits = *bitmap++;
+
+                set    = (bits & 0x80) != 0;
+                bits <<= 1;
+            }
+
+            if(set)
+            {
+                if(runX < 0) runX = xx;
+                continue;
+            }
+
+            if(runX < 0)
+                continue;
+
+            if((numRuns >= skip) && (entry->numRuns < GLYPH_CACHE_RUNS))
+            {
+                glyphRun_t *run = &entry->runs[entry->numRuns];
+                run->x   = runX;
+                run->y   = yy;
+                run->len = xx - runX;
+                entry->numRuns++;
+            }
+
+            numRuns++;
+            runX = -1;
+        }
+    }
+
+    return numRuns;
+}
+
+/**
+ * \internal
+ * Draw the runs stored in a glyph cache entry.
+ *
+ * @param pen: drawing colour.
+ * @param entry: cache entry.
+ * @param x: screen column of the top left corner of the glyph bitmap.
+ * @param y: screen row of the top left corner of the glyph bitmap.
+ * @param clip: true if the glyph is not entirely inside the screen.
+ */
+static void blitGlyph(const pen_t *pen, const cachedGlyph_t *entry,
+                      int32_t x, int32_t y, bool clip)
+{
+    const glyphRun_t *run = entry->runs;
+    const glyphRun_t *end = entry->runs + entry->numRuns;
+
+    if(clip == false)
+    {
+        for(; run < end; run++)
+            drawSpan(pen, x + run->x, x + run->x + run->len, y + run->y);
+
+        return;
+    }
+
+    for(; run < end; run++)
+    {
+        int32_t row = y + run->y;
+        int32_t x0  = x + run->x;
+        int32_t x1  = x0 + run->len;
+
+        if((row < 0) || (row >= SCREEN_HEIGHT)) continue;
+        if(x0 < 0) x0 = 0;
+        if(x1 > SCREEN_WIDTH) x1 = SCREEN_WIDTH;
+        if(x0 < x1) drawSpan(pen, x0, x1, row);
+    }
+}
+
+/**
+ * \internal
+ * Draw a glyph, taking it from the glyph cache when possible.
+ *
+ * @param pen: drawing colour.
+ * @param size: font size.
+ * @param c: character to be drawn.
+ * @param x: screen column of the glyph origin.
+ * @param y: screen row of the glyph origin, that is the text baseline.
+ */
+static void drawGlyph(const pen_t *pen, fontSize_t size, char c, int32_t x,
+                      int32_t y)
+{
+    const GFXfont  *f     = &fonts[size];
+    const GFXglyph *glyph = &f->glyph[c - f->first];
+
+    x += glyph->xOffset;
+    y += glyph->yOffset;
+
+    int32_t x1 = x + glyph->width;
+    int32_t y1 = y + glyph->height;
+    if((x >= SCREEN_WIDTH) || (y >= SCREEN_HEIGHT) || (x1 <= 0) || (y1 <= 0))
+        return;
+
+    bool clip = (x < 0) || (y < 0) || (x1 > SCREEN_WIDTH) ||
+                (y1 > SCREEN_HEIGHT);
+
+    markDirty((y < 0) ? 0 : y, (y1 > SCREEN_HEIGHT) ? SCREEN_HEIGHT : y1);
+
+    glyphUseCount++;
+
+    // Look for the glyph, keeping track of the least recently used entry
+    cachedGlyph_t *entry = &glyphCache[0];
+    for(size_t i = 0; i < GLYPH_CACHE_SIZE; i++)
+    {
+        cachedGlyph_t *e = &glyphCache[i];
+        if((e->c == c) && (e->size == size))
+        {
+            e->lastUse = glyphUseCount;
+            blitGlyph(pen, e, x, y, clip);
+            return;
+        }
+
+        if(e->lastUse < entry->lastUse)
+            entry = e;
+    }
+
+    uint16_t numRuns = decodeGlyph(f, glyph, entry, 0);
+    blitGlyph(pen, entry, x, y, clip);
+
+    if(numRuns <= GLYPH_CACHE_RUNS)
+    {
+        entry->c       = c;
+        entry->size    = size;
+        entry->lastUse = glyphUseCount;
+        return;
+    }
+
+    // Glyph too big to be cached, draw the remaining runs
+    for(uint16_t skip = GLYPH_CACHE_RUNS; skip < numRuns; skip += GLYPH_CACHE_RUNS)
+    {
+        decodeGlyph(f, glyph, entry, skip);
+        blitGlyph(pen, entry, x, y, clip);
+    }
+
+    entry->c       = 0;
+    entry->lastUse = 0;
+}
+
 uint8_t gfx_getFontHeight(fontSize_t size)
 {
     GFXfont f = fonts[size];
@@ -460,6 +876,11 @@ uint8_t gfx_getFontHeight(fontSize_t size)
     return glyph.height;
 }
 
+uint16_t gfx_getTextWidth(fontSize_t size, const char *text)
+{
+    return get_line_size(fonts[size], text, strlen(text));
+}
+
 point_t gfx_printBuffer(point_t start, fontSize_t size, textAlign_t alignment,
                         color_t color, const char *buf)
 {
@@ -474,20 +895,15 @@ point_t gfx_printBuffer(point_t start, fontSize_t size, textAlign_t alignment,
     // Save initial start.y value to calculate vertical size
     uint16_t saved_start_y = start.y;
     uint16_t line_h = 0;
+    // Convert the text colour only once
+    pen_t pen = makePen(color);
 
     /* For each char in the string */
     for(unsigned i = 0; i < len; i++)
     {
         char c = buf[i];
         GFXglyph glyph = f.glyph[c - f.first];
-        uint8_t *bitmap = f.bitmap;
-
-        uint16_t bo = glyph.bitmapOffset;
-        uint8_t w = glyph.width, h = glyph.height;
-        int8_t xo = glyph.xOffset,
-               yo = glyph.yOffset;
-        uint8_t xx, yy, bits = 0, bit = 0;
-        line_h = h;
+        line_h = glyph.height;
 
         // Handle newline and carriage return
         if (c == '\n')
@@ -519,34 +935,7 @@ point_t gfx_printBuffer(point_t start, fontSize_t size, textAlign_t alignment,
             start.y += f.yAdvance;
         }
 
-        // Draw bitmap
-        for (yy = 0; yy < h; yy++)
-        {
-            for (xx = 0; xx < w; xx++)
-            {
-                if (!(bit++ & 7))
-                {
-                    bits = bitmap[bo++];
-                }
-
-                if (bits & 0x80)
-                {
-                    if (start.y + yo + yy < SCREEN_HEIGHT &&
-                        start.x + xo + xx < SCREEN_WIDTH &&
-                        start.y + yo + yy > 0 &&
-                        start.x + xo + xx > 0)
-                    {
-                        point_t pos;
-                        pos.x = start.x + xo + xx;
-                        pos.y = start.y + yo + yy;
-                        gfx_setPixel(pos, color);
-
-                    }
-                }
-
-                bits <<= 1;
-            }
-        }
+        drawGlyph(&pen, size, c, start.x, start.y);
 
         start.x += glyph.xAdvance;
     }
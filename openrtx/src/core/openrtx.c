@@ -25,6 +25,7 @@
 #include <interfaces/cps_io.h>
 #include <interfaces/gps.h>
 #include <voicePrompts.h>
+#include <profiling.h>
 #include <graphics.h>
 #include <openrtx.h>
 #include <threads.h>
@@ -41,6 +42,7 @@ void openrtx_init()
     state.devStatus = STARTUP;
 
     platform_init();    // Initialize low-level platform drivers
+    prof_init();        // Initialize execution time probes
     state_init();       // Initialize radio state
 
     gfx_init();         // Initialize display and graphics driver
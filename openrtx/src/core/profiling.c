@@ -0,0 +1,149 @@
+/***************************************************************************
+ *   Copyright (C) 2023 by Federico Amedeo Izzo IU2NUO,                    *
+ *                         Niccolò Izzo IU2KIN                             *
+ *                         Frederik Saraci IU2NRO                          *
+ *                         Silvano Seva IU2KWO                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+#include <profiling.h>
+#include <string.h>
+#ifdef PLATFORM_LINUX
+#include <time.h>
+#else
+#include <hwconfig.h>
+#endif
+
+typedef struct
+{
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t total;
+    uint32_t hist[PROF_HIST_BINS];
+}
+probe_t;
+
+static const char *names[PROF_NUM_PROBES] =
+{
+    "RTX task",
+    "M17 demod",
+    "M17 filter",
+    "M17 sync",
+    "M17 symbols",
+    "M17 decode",
+    "M17 Viterbi",
+    "Codec2 enc",
+    "Codec2 dec",
+    "UI update"
+};
+
+static probe_t probes[PROF_NUM_PROBES];
+
+/**
+ * \internal
+ * Number of time counter ticks in a microsecond: the counter runs at the core
+ * clock on Cortex-M devices, at 1GHz on Linux.
+ */
+static inline uint32_t ticksPerUs()
+{
+    #ifdef PLATFORM_LINUX
+    return 1000;
+    #else
+    return SystemCoreClock / 1000000;
+    #endif
+}
+
+
+void prof_init()
+{
+    #ifndef PLATFORM_LINUX
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT       = 0;
+    DWT->CTRL        |= DWT_CTRL_CYCCNTENA_Msk;
+    #endif
+
+    prof_reset();
+}
+
+uint32_t prof_getTicks()
+{
+    #ifdef PLATFORM_LINUX
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t) ((ts.tv_sec * 1000000000ull) + ts.tv_nsec);
+    #else
+    return DWT->CYCCNT;
+    #endif
+}
+
+void prof_record(const enum ProfProbe probe, const uint32_t start)
+{
+    uint32_t ticks = prof_getTicks() - start;
+
+    if(probe >= PROF_NUM_PROBES)
+        return;
+
+    probe_t *p = &probes[probe];
+
+    if((p->count == 0) || (ticks < p->min)) p->min = ticks;
+    if(ticks > p->max) p->max = ticks;
+    p->total += ticks;
+    p->count += 1;
+
+    // Logarithmic histogram, starting from 32us
+    uint32_t us  = ticks / ticksPerUs();
+    uint32_t bin = 0;
+    if(us >= 32)
+    {
+        bin = (31 - __builtin_clz(us)) - 4;
+        if(bin >= PROF_HIST_BINS) bin = PROF_HIST_BINS - 1;
+    }
+
+    p->hist[bin] += 1;
+}
+
+bool prof_getStats(const enum ProfProbe probe, profStats_t *stats)
+{
+    if(probe >= PROF_NUM_PROBES)
+        return false;
+
+    const probe_t *p   = &probes[probe];
+    uint32_t      tpus = ticksPerUs();
+
+    stats->count = p->count;
+    stats->min   = p->min / tpus;
+    stats->max   = p->max / tpus;
+    stats->avg   = 0;
+    if(p->count > 0)
+        stats->avg = (p->total / p->count) / tpus;
+
+    memcpy(stats->hist, p->hist, sizeof(stats->hist));
+
+    return true;
+}
+
+const char *prof_getName(const enum ProfProbe probe)
+{
+    if(probe >= PROF_NUM_PROBES)
+        return NULL;
+
+    return names[probe];
+}
+
+void prof_reset()
+{
+    memset(probes, 0x00, sizeof(probes));
+}
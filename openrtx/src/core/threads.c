@@ -39,6 +39,7 @@
 #include <gps.h>
 #endif
 #include <voicePrompts.h>
+#include <profiling.h>
 
 
 /* Mutex for concurrent access to RTX state variable */
@@ -109,7 +110,11 @@ void *ui_threadFunc(void *arg)
         }
 
         // Update UI and render on screen, if necessary
-        if(ui_updateGUI() == true)
+        PROF_START(uiStart);
+        bool updated = ui_updateGUI();
+        PROF_STOP(PROF_UI_UPDATE, uiStart);
+
+        if(updated == true)
         {
             gfx_render();
         }
@@ -198,7 +203,9 @@ void *rtx_threadFunc(void *arg)
 
     while(state.devStatus == RUNNING)
     {
+        PROF_START(rtxStart);
         rtx_task();
+        PROF_STOP(PROF_RTX_TASK, rtxStart);
     }
 
     rtx_terminate();
@@ -20,7 +20,6 @@
  ***************************************************************************/
 #include <interfaces/platform.h>
 #include <interfaces/keyboard.h>
-#include <interfaces/delays.h>
 #include <voicePromptUtils.h>
 #include <ui/ui_strings.h>
 #include <voicePrompts.h>
@@ -108,7 +107,7 @@ static uint8_t    beepSeriesIndex     = 0;
 static bool       delayBeepUntilTick  = false;
 
 static pathId     vpAudioPath;
-static long long  vpStartTime;
+static codec_t   *vpCodec;
 
 #ifdef VP_USE_FILESYSTEM
 static FILE *vpFile = NULL;
@@ -385,8 +384,10 @@ void vp_init()
             state.settings.vpLevel = vpBeep;
     }
 
-    // Initialize codec2 module
-    codec_init();
+    // Open the codec2 instance dedicated to voice prompts, not needed if
+    // only beeps are available.
+    if (vpDataLoaded)
+        vpCodec = codec_open();
 }
 
 void vp_terminate()
@@ -394,7 +395,8 @@ void vp_terminate()
     if (voicePromptActive)
         vp_flush();
 
-    codec_terminate();
+    codec_close(vpCodec);
+    vpCodec = NULL;
 
     #ifdef VP_USE_FILESYSTEM
     fclose(vpFile);
@@ -405,7 +407,7 @@ void vp_stop()
 {
     voicePromptActive = false;
     disableSpkOutput();
-    codec_stop();
+    codec_stop(vpCodec);
 
     // Clear voice prompt sequence data
     vpCurrentSequence.pos          = 0;
@@ -554,9 +556,12 @@ void vp_play()
     if (vpCurrentSequence.length <= 0)
         return;
 
-    // TODO: remove this once switching to hardware-based I2C driver for AT1846S
-    // management.
-    vpStartTime = getTick();
+    // Decoded audio goes through the output mixer, which keeps the speaker
+    // stream running: playback can start right away, without waiting for the
+    // synchronisation with the output stream.
+    voicePromptActive = true;
+    codec_startDecode(vpCodec, SINK_SPK, PRIO_PROMPT);
+    enableSpkOutput();
 }
 
 void vp_tick()
@@ -570,21 +575,6 @@ void vp_tick()
     if (beep_tick())
         return;
 
-    // Temporary fix for the following bug: on MD-UV3x0 the configuration of
-    // the AT1846S chip may take more than 20ms, making the codec2 thread miss
-    // the syncronization point with the output stream. By delaying the start
-    // of the voice prompt by 50ms, a time span almost not noticeable, we avoid
-    // to incur in such a problem.
-    // TODO: remove this once switched to hardware-based I2C driver for AT1846S
-    // management.
-    if((vpStartTime > 0) && ((getTick() - vpStartTime) > 50))
-    {
-        vpStartTime       = 0;
-        voicePromptActive = true;
-        codec_startDecode(SINK_SPK);
-        enableSpkOutput();
-    }
-
     if (voicePromptActive == false)
         return;
 
@@ -614,7 +604,7 @@ void vp_tick()
             if(audioPath_getStatus(vpAudioPath) != PATH_OPEN)
                 return;
 
-            if (codec_pushFrame(c2Frame, false) == false)
+            if (codec_pushFrame(vpCodec, c2Frame, false) == false)
                 return;
 
             vpCurrentSequence.c2DataIndex += 8;
@@ -633,7 +623,7 @@ void vp_tick()
         vpCurrentSequence.c2DataIndex  = 0;
         vpCurrentSequence.c2DataLength = 0;
         disableSpkOutput();
-        codec_stop();
+        codec_stop(vpCodec);
     }
 }
 
@@ -20,5 +20,5 @@
 
 #include <M17/M17DSP.hpp>
 
-Fir< std::tuple_size< decltype(M17::rrc_taps_48k) >::value > M17::rrc_48k(M17::rrc_taps_48k);
-Fir< std::tuple_size< decltype(M17::rrc_taps_24k) >::value > M17::rrc_24k(M17::rrc_taps_24k);
+InterpolatorQ15< std::tuple_size< decltype(M17::rrc_taps_48k) >::value, 10 > M17::rrc_48k(M17::rrc_taps_48k_q15);
+FirQ15< std::tuple_size< decltype(M17::rrc_taps_24k) >::value > M17::rrc_24k(M17::rrc_taps_24k_q15);
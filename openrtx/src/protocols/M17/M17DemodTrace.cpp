@@ -0,0 +1,251 @@
+/***************************************************************************
+ *   Copyright (C) 2023 by Federico Amedeo Izzo IU2NUO,                    *
+ *                         Niccolò Izzo IU2KIN                             *
+ *                         Frederik Saraci IU2NRO                          *
+ *                         Silvano Seva IU2KWO                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+#ifdef ENABLE_DEMOD_LOG
+
+#include <M17/M17DemodTrace.hpp>
+#include <interfaces/delays.h>
+#include <cstdlib>
+#include <cstring>
+#ifndef PLATFORM_LINUX
+#include <usb_vcom.h>
+#endif
+
+using namespace M17;
+
+static constexpr uint8_t TRACE_VERSION = 1;
+
+#ifndef DEMOD_TRACE_CHANNELS
+#define DEMOD_TRACE_CHANNELS (TRACE_QNT | TRACE_SYMBOL)
+#endif
+
+/*
+ * Period of the writer thread, in ms. The host is fast enough to demodulate
+ * files much faster than real time, the queue has to be emptied more often.
+ */
+#ifdef PLATFORM_LINUX
+static constexpr unsigned int WRITER_PERIOD = 2;
+#else
+static constexpr unsigned int WRITER_PERIOD = 20;
+#endif
+
+#ifndef DEMOD_TRACE_RATE
+#ifdef PLATFORM_LINUX
+#define DEMOD_TRACE_RATE 0
+#else
+#define DEMOD_TRACE_RATE 4000
+#endif
+#endif
+
+
+M17DemodTrace::M17DemodTrace() : running(false), output(NULL), channels(0)
+{
+
+}
+
+M17DemodTrace::~M17DemodTrace()
+{
+    stop();
+}
+
+void M17DemodTrace::start(const uint32_t sampleRate)
+{
+    if(running)
+        return;
+
+    uint8_t enabled  = DEMOD_TRACE_CHANNELS;
+    this->sampleRate = sampleRate;
+    rate             = DEMOD_TRACE_RATE;
+
+    #ifdef PLATFORM_LINUX
+    // Channel list, comma separated: corr, qnt, sym or all
+    const char *env = getenv("OPENRTX_DEMOD_TRACE");
+    if(env != NULL)
+    {
+        enabled = 0;
+        if(strstr(env, "corr") != NULL) enabled |= TRACE_CORR;
+        if(strstr(env, "qnt")  != NULL) enabled |= TRACE_QNT;
+        if(strstr(env, "sym")  != NULL) enabled |= TRACE_SYMBOL;
+        if(strstr(env, "all")  != NULL) enabled |= TRACE_ALL;
+    }
+
+    env = getenv("OPENRTX_DEMOD_TRACE_RATE");
+    if(env != NULL)
+        rate = strtoul(env, NULL, 10);
+
+    env = getenv("OPENRTX_DEMOD_TRACE_FILE");
+    if(env == NULL)
+        env = "demod_trace.bin";
+
+    output = fopen(env, "wb");
+    if(output == NULL)
+    {
+        fprintf(stderr, "Demodulator trace: cannot open %s\n", env);
+        return;
+    }
+    #endif
+
+    // Start with a full second of records
+    budget     = static_cast< uint64_t >(rate) * sampleRate;
+    blockStart = 0;
+    blockLen   = 0;
+    dropped    = 0;
+    channels   = enabled;
+    running    = true;
+
+    #ifdef _MIOSIX
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, 1024);
+
+    // Lowest priority, the writer must never delay the demodulator
+    struct sched_param param;
+    param.sched_priority = sched_get_priority_min(0);
+    pthread_attr_setschedparam(&attr, &param);
+
+    pthread_create(&writer, &attr, writerFunc, this);
+    #else
+    pthread_create(&writer, NULL, writerFunc, this);
+    #endif
+}
+
+void M17DemodTrace::stop()
+{
+    if(running == false)
+        return;
+
+    channels = 0;
+    running  = false;
+    pthread_join(writer, NULL);
+
+    #ifdef PLATFORM_LINUX
+    fclose(output);
+    output = NULL;
+    #endif
+}
+
+void M17DemodTrace::newBlock(const size_t len, const bool locked)
+{
+    if(channels == 0)
+        return;
+
+    blockStart += blockLen;
+    blockLen    = len;
+
+    if(rate != 0)
+    {
+        uint64_t maxBudget = static_cast< uint64_t >(rate) * sampleRate;
+        budget += static_cast< uint64_t >(rate) * len;
+        if(budget > maxBudget)
+            budget = maxBudget;
+    }
+
+    // Block records are not subject to the rate limit, they carry the count
+    // of the dropped records.
+    traceRecord_t rec;
+    rec.type   = TRACE_REC_BLOCK;
+    rec.flags  = locked ? 1 : 0;
+    rec.sample = 0;
+    rec.index  = blockStart;
+    rec.a      = len;
+    rec.b      = dropped;
+
+    if(queue.push(rec))
+        dropped = 0;
+    else
+        dropped++;
+}
+
+void M17DemodTrace::push(const TraceRecord type, const uint8_t flags,
+                         const int16_t sample, const int32_t index,
+                         const int32_t a, const int32_t b)
+{
+    if(rate != 0)
+    {
+        if(budget < sampleRate)
+        {
+            dropped++;
+            return;
+        }
+
+        budget -= sampleRate;
+    }
+
+    traceRecord_t rec;
+    rec.type   = type;
+    rec.flags  = flags;
+    rec.sample = sample;
+    rec.index  = blockStart + index;
+    rec.a      = a;
+    rec.b      = b;
+
+    if(queue.push(rec) == false)
+        dropped++;
+}
+
+void *M17DemodTrace::writerFunc(void *arg)
+{
+    M17DemodTrace *trace = reinterpret_cast< M17DemodTrace * >(arg);
+    static traceRecord_t batch[BATCH_SIZE];
+
+    traceHeader_t header;
+    memcpy(header.magic, "M17T", 4);
+    header.version    = TRACE_VERSION;
+    header.channels   = trace->channels;
+    header.recordSize = sizeof(traceRecord_t);
+    header._empty     = 0;
+    header.sampleRate = trace->sampleRate;
+    header.recordRate = trace->rate;
+
+    trace->write(&header, sizeof(header));
+
+    // Sleep between the batches instead of polling the queue: the writer
+    // has to stay out of the way of the demodulator.
+    bool running = true;
+    while(running)
+    {
+        running = trace->running;
+
+        size_t num;
+        do
+        {
+            num = trace->queue.pop(batch, BATCH_SIZE);
+            if(num > 0)
+                trace->write(batch, num * sizeof(traceRecord_t));
+        }
+        while(num == BATCH_SIZE);
+
+        if(running)
+            sleepFor(0u, WRITER_PERIOD);
+    }
+
+    return NULL;
+}
+
+void M17DemodTrace::write(const void *data, const size_t len)
+{
+    #ifdef PLATFORM_LINUX
+    fwrite(data, 1, len, output);
+    #else
+    vcom_writeBlock(data, len);
+    #endif
+}
+
+#endif
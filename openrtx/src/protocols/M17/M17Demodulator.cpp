@@ -24,127 +24,29 @@
 #include <M17/M17DSP.hpp>
 #include <M17/M17Utils.hpp>
 #include <interfaces/audio_stream.h>
+#include <profiling.h>
 #include <math.h>
+#include <algorithm>
 #include <cstring>
 #include <stdio.h>
 
 using namespace M17;
 
-#ifdef ENABLE_DEMOD_LOG
-
-#include <ringbuf.h>
-#include <atomic>
-#ifndef PLATFORM_LINUX
-#include <usb_vcom.h>
-#endif
-
-typedef struct
-{
-    int16_t sample;
-    int32_t conv;
-    float   conv_th;
-    int32_t sample_index;
-    float   qnt_pos_avg;
-    float   qnt_neg_avg;
-    int32_t symbol;
-    int32_t frame_index;
-    uint8_t flags;
-    uint8_t _empty;
-}
-__attribute__((packed)) log_entry_t;
-
-#ifdef PLATFORM_LINUX
-#define LOG_QUEUE 160000
-#else
-#define LOG_QUEUE 1024
-#endif
-
-static RingBuffer< log_entry_t, LOG_QUEUE > logBuf;
-static std::atomic_bool dumpData;
-static bool      logRunning;
-static bool      trigEnable;
-static bool      triggered;
-static uint32_t  trigCnt;
-static pthread_t logThread;
-
-static void *logFunc(void *arg)
-{
-    (void) arg;
-
-    #ifdef PLATFORM_LINUX
-    FILE *csv_log = fopen("demod_log.csv", "w");
-    fprintf(csv_log, "Sample,Convolution,Threshold,Index,Max,Min,Symbol,I,Flags\n");
-    #endif
-
-    uint8_t emptyCtr = 0;
-
-    while(logRunning)
-    {
-        if(dumpData)
-        {
-            // Log up to four entries filled with zeroes before terminating
-            // the dump.
-            log_entry_t entry;
-            memset(&entry, 0x00, sizeof(log_entry_t));
-            if(logBuf.pop(entry, false) == false) emptyCtr++;
-
-            if(emptyCtr >= 100)
-            {
-                dumpData = false;
-                emptyCtr = 0;
-                #ifdef PLATFORM_LINUX
-                logRunning = false;
-                #endif
-            }
-
-            #ifdef PLATFORM_LINUX
-            fprintf(csv_log, "%" PRId16 ",%d,%f,%d,%f,%f,%d,%d,%d\n",
-                    entry.sample,
-                    entry.conv,
-                    entry.conv_th,
-                    entry.sample_index,
-                    entry.qnt_pos_avg,
-                    entry.qnt_neg_avg,
-                    entry.symbol,
-                    entry.frame_index,
-                    entry.flags);
-            fflush(csv_log);
-            #else
-            vcom_writeBlock(&entry, sizeof(log_entry_t));
-            #endif
-        }
-    }
-
-    #ifdef PLATFORM_LINUX
-    fclose(csv_log);
-    exit(-1);
-    #endif
-
-    return NULL;
-}
-
-static inline void pushLog(const log_entry_t& e)
+/*
+ * M17 syncwords, as symbols. LSF and BERT syncwords are the opposite of the
+ * stream and packet ones, thus their correlation is obtained by negation.
+ */
+static constexpr int8_t streamSyncword[M17_SYNCWORD_SYMBOLS] = { -3, -3, -3, -3, +3, +3, -3, +3 };
+static constexpr int8_t packetSyncword[M17_SYNCWORD_SYMBOLS] = { +3, -3, +3, +3, +3, +3, +3, +3 };
+static constexpr syncw_t syncwords[SYNC_NUM] =
 {
-    /*
-     * 1) do not push data to log while dump is in progress
-     * 2) if triggered, increase the counter
-     * 3) fill half of the buffer with entries after the trigger, then start dump
-     * 4) if buffer is full, erase the oldest element
-     * 5) push data without blocking
-     */
+    LSF_SYNC_WORD, STREAM_SYNC_WORD, PACKET_SYNC_WORD, BERT_SYNC_WORD
+};
 
-    if(dumpData) return;
-    if(triggered) trigCnt++;
-    if(trigCnt >= LOG_QUEUE/2)
-    {
-        dumpData  = true;
-        triggered = false;
-        trigCnt   = 0;
-    }
-    if(logBuf.full()) logBuf.eraseElement();
-    logBuf.push(e, false);
-}
+#ifdef ENABLE_DEMOD_LOG
+#include <M17/M17DemodTrace.hpp>
 
+static M17DemodTrace trace;
 #endif
 
 
@@ -162,28 +64,23 @@ void M17Demodulator::init()
 {
     /*
      * Allocate a chunk of memory to contain two complete buffers for baseband
-     * audio. Split this chunk in two separate blocks for double buffering using
-     * placement new.
+     * audio, preceded by the history region holding the tail of the previous
+     * block.
      */
 
-    baseband_buffer = std::make_unique< int16_t[] >(2 * M17_SAMPLE_BUF_SIZE);
+    baseband_buffer = std::make_unique< int16_t[] >(M17_BRIDGE_SIZE + 2 * M17_SAMPLE_BUF_SIZE);
+    samples         = nullptr;
     demodFrame      = std::make_unique< frame_t >();
     readyFrame      = std::make_unique< frame_t >();
+    demodSoftFrame  = std::make_unique< softframe_t >();
+    readySoftFrame  = std::make_unique< softframe_t >();
     baseband        = { nullptr, 0 };
     frame_index     = 0;
     phase           = 0;
     syncDetected    = false;
     locked          = false;
     newFrame        = false;
-
-    #ifdef ENABLE_DEMOD_LOG
-    logRunning = true;
-    triggered  = false;
-    dumpData   = false;
-    trigEnable = false;
-    trigCnt    = 0;
-    pthread_create(&logThread, NULL, logFunc, NULL);
-    #endif
+    resetTimingRecovery();
 }
 
 void M17Demodulator::terminate()
@@ -194,27 +91,34 @@ void M17Demodulator::terminate()
 
     // Delete the buffers and deallocate memory.
     baseband_buffer.reset();
+    samples = nullptr;
     demodFrame.reset();
     readyFrame.reset();
+    demodSoftFrame.reset();
+    readySoftFrame.reset();
 
     #ifdef ENABLE_DEMOD_LOG
-    logRunning = false;
+    trace.stop();
     #endif
 }
 
 void M17Demodulator::startBasebandSampling()
 {
     basebandPath = audioPath_request(SOURCE_RTX, SINK_MCU, PRIO_RX);
-    basebandId = inputStream_start(SOURCE_RTX, PRIO_RX,
-                                   baseband_buffer.get(),
-                                   2 * M17_SAMPLE_BUF_SIZE,
-                                   BUF_CIRC_DOUBLE,
-                                   M17_RX_SAMPLE_RATE);
+    basebandId = inputStream_startWithHistory(SOURCE_RTX, PRIO_RX,
+                                              baseband_buffer.get(),
+                                              M17_BRIDGE_SIZE + 2 * M17_SAMPLE_BUF_SIZE,
+                                              M17_BRIDGE_SIZE,
+                                              M17_RX_SAMPLE_RATE);
     // Clean start of the demodulation statistics
     resetCorrelationStats();
     resetQuantizationStats();
     // DC removal filter reset
     dsp_resetFilterState(&dsp_state);
+
+    #ifdef ENABLE_DEMOD_LOG
+    trace.start(M17_RX_SAMPLE_RATE);
+    #endif
 }
 
 void M17Demodulator::stopBasebandSampling()
@@ -224,6 +128,10 @@ void M17Demodulator::stopBasebandSampling()
      phase = 0;
      syncDetected = false;
      locked = false;
+
+     #ifdef ENABLE_DEMOD_LOG
+     trace.stop();
+     #endif
 }
 
 void M17Demodulator::resetCorrelationStats()
@@ -253,14 +161,8 @@ void M17Demodulator::resetQuantizationStats()
 }
 
 void M17Demodulator::updateQuantizationStats(int32_t frame_index,
-                                             int32_t symbol_index)
+                                             int16_t sample)
 {
-    int16_t sample = 0;
-    // When we are at negative indices use bridge buffer
-    if (symbol_index < 0)
-        sample = basebandBridge[M17_BRIDGE_SIZE + symbol_index];
-    else
-        sample = baseband.data[symbol_index];
     if (sample > 0)
     {
         qnt_pos_acc += sample;
@@ -283,79 +185,95 @@ void M17Demodulator::updateQuantizationStats(int32_t frame_index,
     }
 }
 
-int32_t M17Demodulator::convolution(int32_t offset,
-                                    int8_t *target,
-                                    size_t target_size)
+corr_t M17Demodulator::correlate(int32_t offset)
 {
-    // Compute convolution
-    int32_t conv = 0;
-    for(uint32_t i = 0; i < target_size; i++)
+    // Fetch each strided sample once and correlate it with both the stream
+    // and packet syncwords.
+    int32_t streamCorr = 0;
+    int32_t packetCorr = 0;
+    const int16_t *stride = samples + offset;
+
+    for(size_t i = 0; i < M17_SYNCWORD_SYMBOLS; i++)
     {
-        int32_t sample_index = offset + i * M17_SAMPLES_PER_SYMBOL;
-        int16_t sample = 0;
-        // When we are at negative indices use bridge buffer
-        if (sample_index < 0)
-            sample = basebandBridge[M17_BRIDGE_SIZE + sample_index];
-        else
-            sample = baseband.data[sample_index];
-        conv += (int32_t) target[i] * (int32_t) sample;
+        int32_t sample = stride[i * M17_SAMPLES_PER_SYMBOL];
+        streamCorr += streamSyncword[i] * sample;
+        packetCorr += packetSyncword[i] * sample;
     }
-    return conv;
+
+    corr_t corr;
+    corr[SYNC_LSF]    = -streamCorr;
+    corr[SYNC_STREAM] =  streamCorr;
+    corr[SYNC_PACKET] =  packetCorr;
+    corr[SYNC_BERT]   = -packetCorr;
+
+    return corr;
 }
 
 sync_t M17Demodulator::nextFrameSync(int32_t offset)
 {
 
-    sync_t syncword = { -1, false };
-    // Find peaks in the correlation between the baseband and the frame syncword
-    // Leverage the fact LSF syncword is the opposite of the frame syncword
-    // to detect both syncwords at once. Stop early because convolution needs
-    // access samples ahead of the starting offset.
+    sync_t syncword = { -1, SYNC_STREAM, 0.0f };
+    // Find peaks in the correlation between the baseband and the syncwords.
+    // Stop early because correlation needs access samples ahead of the
+    // starting offset.
     int32_t maxLen = static_cast < int32_t >(baseband.len - M17_SYNCWORD_SAMPLES);
     for(int32_t i = offset; (syncword.index == -1) && (i < maxLen); i++)
     {
-        int32_t conv = convolution(i, stream_syncword, M17_SYNCWORD_SYMBOLS);
-        updateCorrelationStats(conv);
+        corr_t corr = correlate(i);
+        updateCorrelationStats(corr[SYNC_STREAM]);
+
+        // Pick the strongest correlation peak above threshold
+        int32_t peak = static_cast< int32_t >(getCorrelationStddev()
+                                              * CONV_THRESHOLD_FACTOR);
 
         #ifdef ENABLE_DEMOD_LOG
-        log_entry_t log;
-        log.sample       = (i < 0) ? basebandBridge[M17_BRIDGE_SIZE + i] : baseband.data[i];
-        log.conv         = conv;
-        log.conv_th      = CONV_THRESHOLD_FACTOR * getCorrelationStddev();
-        log.sample_index = i;
-        log.qnt_pos_avg  = 0.0;
-        log.qnt_neg_avg  = 0.0;
-        log.symbol       = 0;
-        log.frame_index  = 0;
-        log.flags        = 1;
-
-        pushLog(log);
+        if(trace.enabled(TRACE_CORR))
+            trace.push(TRACE_REC_CORR, locked, samples[i], i,
+                       corr[SYNC_STREAM], peak);
         #endif
 
-        // Positive correlation peak -> frame syncword
-        if (conv > (getCorrelationStddev() * CONV_THRESHOLD_FACTOR))
+        for(uint8_t type = 0; type < SYNC_NUM; type++)
         {
-            syncword.lsf = false;
-            syncword.index = i;
-        }
-        // Negative correlation peak -> LSF syncword
-        else if (conv < -(getCorrelationStddev() * CONV_THRESHOLD_FACTOR))
-        {
-            syncword.lsf = true;
-            syncword.index = i;
+            if(corr[type] > peak)
+            {
+                peak           = corr[type];
+                syncword.index = i;
+                syncword.type  = static_cast< SyncType >(type);
+            }
         }
     }
 
+    if(syncword.index == -1)
+        return syncword;
+
+    // The threshold is crossed on the rising edge of the correlation peak:
+    // move to the top of the peak, then estimate the fractional position of
+    // the maximum by fitting a parabola on the three samples around it.
+    int32_t prev = correlate(syncword.index - 1)[syncword.type];
+    int32_t curr = correlate(syncword.index)[syncword.type];
+    int32_t next = correlate(syncword.index + 1)[syncword.type];
+
+    while((next > curr) && (syncword.index + 1 < maxLen))
+    {
+        syncword.index += 1;
+        prev = curr;
+        curr = next;
+        next = correlate(syncword.index + 1)[syncword.type];
+    }
+
+    float den = static_cast< float >(prev - 2 * curr + next);
+    syncword.offset = 0.0f;
+    if(den < 0.0f)
+    {
+        syncword.offset = 0.5f * static_cast< float >(prev - next) / den;
+        syncword.offset = std::min(std::max(syncword.offset, -0.5f), 0.5f);
+    }
+
     return syncword;
 }
 
-int8_t M17Demodulator::quantize(int32_t offset)
+int8_t M17Demodulator::quantize(int16_t sample)
 {
-    int16_t sample = 0;
-    if (offset < 0) // When we are at negative offsets use bridge buffer
-        sample = basebandBridge[M17_BRIDGE_SIZE + offset];
-    else            // Otherwise use regular data buffer
-        sample = baseband.data[offset];
     if (sample > static_cast< int16_t >(qnt_pos_avg / 1.5f))
         return +3;
     else if (sample < static_cast< int16_t >(qnt_neg_avg / 1.5f))
@@ -366,6 +284,35 @@ int8_t M17Demodulator::quantize(int32_t offset)
         return -1;
 }
 
+void M17Demodulator::quantizeSoft(int16_t sample, uint16_t *softBits)
+{
+    // Outer symbol level, measured on the syncword
+    float level = (sample > 0) ? qnt_pos_avg : -qnt_neg_avg;
+
+    // Statistics not yet available, fall back to hard decision
+    if(level <= 0.0f)
+    {
+        int8_t symbol = quantize(sample);
+        softBits[0]   = (symbol < 0) ? 0xFFFF : 0x0000;
+        softBits[1]   = ((symbol == -3) || (symbol == +3)) ? 0xFFFF : 0x0000;
+        return;
+    }
+
+    // Normalise the sample so that symbols lie at -3, -1, +1 and +3. The
+    // first bit is the symbol sign, the second one tells inner from outer
+    // symbols. Soft values are proportional to the distance from the decision
+    // threshold, saturating at the nominal symbol positions.
+    float x    = 3.0f * static_cast< float >(sample) / level;
+    float msb  = (1.0f - x) / 2.0f;
+    float lsb  = (fabsf(x) - 1.0f) / 2.0f;
+
+    msb = std::min(std::max(msb, 0.0f), 1.0f);
+    lsb = std::min(std::max(lsb, 0.0f), 1.0f);
+
+    softBits[0] = static_cast< uint16_t >(msb * 65535.0f);
+    softBits[1] = static_cast< uint16_t >(lsb * 65535.0f);
+}
+
 const frame_t& M17Demodulator::getFrame()
 {
     // When a frame is read is not new anymore
@@ -373,222 +320,251 @@ const frame_t& M17Demodulator::getFrame()
     return *readyFrame;
 }
 
+const softframe_t& M17Demodulator::getSoftFrame()
+{
+    // When a frame is read is not new anymore
+    newFrame = false;
+    return *readySoftFrame;
+}
+
 bool M17Demodulator::isLocked()
 {
     return locked;
 }
 
-int32_t M17Demodulator::syncwordSweep(int32_t offset)
+float M17Demodulator::interpolate(float position)
+{
+    int32_t index = static_cast< int32_t >(floorf(position));
+    float   mu    = position - static_cast< float >(index);
+
+    float p0 = samples[index - 1];
+    float p1 = samples[index];
+    float p2 = samples[index + 1];
+    float p3 = samples[index + 2];
+
+    // Catmull-Rom cubic interpolation between p1 and p2
+    return p1 + 0.5f * mu * (p2 - p0 + mu * (2.0f * p0 - 5.0f * p1 + 4.0f * p2
+                        - p3 + mu * (3.0f * (p1 - p2) + p3 - p0)));
+}
+
+void M17Demodulator::resetTimingRecovery()
 {
-    int32_t max_conv = 0, max_index = 0;
-    // Start from 5 samples behind, end 5 samples after
-    for(int i = -SYNC_SWEEP_WIDTH; i <= SYNC_SWEEP_WIDTH; i++)
+    timing      = 0.0f;
+    timingInteg = 0.0f;
+    prevSymbol  = 0.0f;
+}
+
+void M17Demodulator::updateTimingRecovery(float symbol, float position)
+{
+    // Outer symbol level, needed to make the loop gain independent from the
+    // signal amplitude. Not available until the first syncword is received.
+    float level = (qnt_pos_avg - qnt_neg_avg) / 2.0f;
+
+    if(level > 0.0f)
     {
-        // TODO: Extend for LSF and BER syncwords
-        int32_t conv = convolution(offset + i,
-                                   stream_syncword,
-                                   M17_SYNCWORD_SYMBOLS);
-        #ifdef ENABLE_DEMOD_LOG
-        int16_t sample;
-        if (offset + i < 0)
-            sample = basebandBridge[M17_BRIDGE_SIZE + offset + i];
-        else
-            sample = baseband.data[offset + i];
-
-        log_entry_t log;
-        log.sample       = sample;
-        log.conv         = conv;
-        log.conv_th      = 0.0;
-        log.sample_index = offset + i;
-        log.qnt_pos_avg  = 0.0;
-        log.qnt_neg_avg  = 0.0;
-        log.symbol       = 0;
-        log.frame_index  = 0;
-        log.flags        = 2;
-
-        pushLog(log);
-        #endif
+        // Gardner timing error detector: the sample halfway between two
+        // symbols is zero when the sampling instant is correct, otherwise
+        // its sign tells whether the sampling is early or late with respect
+        // to the symbol transition.
+        float middle = interpolate(position - (M17_SAMPLES_PER_SYMBOL / 2.0f));
+        float error  = (symbol - prevSymbol) * middle / (level * level);
+
+        // Proportional-integral loop filter, the integral term tracks the
+        // clock frequency offset between transmitter and receiver.
+        timingInteg += TED_LOOP_KI * error;
+        timing      -= TED_LOOP_KP * error + timingInteg;
+    }
 
-        if (conv > max_conv)
-        {
-            max_conv = conv;
-            max_index = i;
-        }
+    prevSymbol = symbol;
+
+    // Move the integer part of the timing correction to the symbol index,
+    // keeping the fractional part within half a sample.
+    while(timing >= 0.5f)
+    {
+        timing -= 1.0f;
+        phase++;
     }
 
-    return max_index;
+    while(timing < -0.5f)
+    {
+        timing += 1.0f;
+        phase--;
+    }
 }
 
 bool M17Demodulator::update()
 {
-    sync_t syncword = { 0, false };
-    phase = (syncDetected) ? phase % M17_SAMPLES_PER_SYMBOL : -M17_BRIDGE_SIZE;
-    uint16_t decoded_syms = 0;
-
     // Read samples from the ADC
     if(audioPath_getStatus(basebandPath) != PATH_OPEN) return false;
-    baseband = inputStream_getData(basebandId);
+    baseband = inputStream_acquire(basebandId);
 
-    if(baseband.data != NULL)
+    if((baseband.data != NULL) && (baseband.len <= M17_SAMPLE_BUF_SIZE))
     {
-        // Apply DC removal filter
-        dsp_dcRemoval(&dsp_state, baseband.data, baseband.len);
+        PROF_SCOPE(PROF_M17_DEMOD);
+        processBlock(baseband.data, baseband.len);
+    }
 
-        // Apply RRC on the baseband buffer
-        for(size_t i = 0; i < baseband.len; i++)
-        {
-            float elem = static_cast< float >(baseband.data[i]);
-            if(invPhase) elem = 0.0f - elem;
-            baseband.data[i]  = static_cast< int16_t >(M17::rrc_24k(elem));
-        }
+    // The tail of the filtered block becomes the history of the next one
+    inputStream_release(basebandId);
+
+    return newFrame;
+}
+
+void M17Demodulator::processBlock(int16_t *data, const size_t len)
+{
+    sync_t syncword = { 0, SYNC_STREAM, 0.0f };
+    baseband        = { data, len };
+
+    // Search for a syncword also across the end of the previous block
+    if(syncDetected == false)
+        phase = -static_cast< int16_t >(M17_SYNCWORD_SAMPLES + M17_SAMPLES_PER_SYMBOL);
+
+    // Apply DC removal filter and RRC in place, the filtered samples lie
+    // right after the tail of the previous block
+    PROF_START(filterStart);
+    samples = data;
+    dsp_dcRemoval(&dsp_state, data, len);
+    M17::rrc_24k.process(data, samples, len);
+
+    if(invPhase)
+    {
+        for(size_t i = 0; i < len; i++)
+            samples[i] = -samples[i];
+    }
+
+    PROF_STOP(PROF_M17_FILTER, filterStart);
+    PROF_SCOPE(PROF_M17_SYMBOLS);
+
+    #ifdef ENABLE_DEMOD_LOG
+    trace.newBlock(len, locked);
+    #endif
 
-        // Process the buffer
-        while(syncword.index != -1)
+    // Process the buffer
+    while(syncword.index != -1)
+    {
+
+        // If we are not demodulating a syncword, search for one
+        if (syncDetected == false)
         {
+            PROF_START(syncStart);
+            syncword = nextFrameSync(phase);
+            PROF_STOP(PROF_M17_SYNC, syncStart);
 
-            // If we are not demodulating a syncword, search for one
-            if (syncDetected == false)
+            if (syncword.index != -1) // Valid syncword found
             {
-                syncword = nextFrameSync(phase);
-
-                if (syncword.index != -1) // Valid syncword found
-                {
-                    phase = syncword.index + 1;
-                    syncDetected = true;
-                    frame_index  = 0;
-                    decoded_syms = 0;
-                }
+                phase        = syncword.index;
+                syncIndex    = syncword.index;
+                syncDetected = true;
+                frame_index  = 0;
+                resetTimingRecovery();
+                timing       = syncword.offset;
+                prevSymbol   = interpolate(static_cast< float >(phase) + timing
+                                           - M17_SAMPLES_PER_SYMBOL);
             }
-            // While we detected a syncword, demodulate available samples
-            else
-            {
-                // Slice the input buffer to extract a frame and quantize
-                int32_t symbol_index = phase
-                    + (M17_SAMPLES_PER_SYMBOL * decoded_syms);
-                if (symbol_index >= static_cast<int32_t>(baseband.len))
-                    break;
-                // Update quantization stats only on syncwords
-                if (frame_index < M17_SYNCWORD_SYMBOLS)
-                    updateQuantizationStats(frame_index, symbol_index);
-                int8_t symbol = quantize(symbol_index);
+        }
+        // While we detected a syncword, demodulate available samples
+        else
+        {
+            // Sample the symbol at the instant given by the timing recovery
+            // loop, the interpolator needs two samples after the symbol.
+            int32_t symbol_index = phase;
+            if ((symbol_index + 2) >= static_cast<int32_t>(len))
+                break;
+
+            float   position = static_cast< float >(phase) + timing;
+            float   value    = interpolate(position);
+            value            = std::min(std::max(value, -32768.0f), 32767.0f);
+            int16_t sample   = static_cast< int16_t >(value);
+
+            // Update quantization stats only on syncwords
+            if (frame_index < M17_SYNCWORD_SYMBOLS)
+                updateQuantizationStats(frame_index, sample);
+            int8_t symbol = quantize(sample);
+
+            #ifdef ENABLE_DEMOD_LOG
+            if(trace.enabled(TRACE_SYMBOL))
+                trace.push(TRACE_REC_SYMBOL, locked, sample, symbol_index,
+                           symbol, frame_index);
+            #endif
 
-                #ifdef ENABLE_DEMOD_LOG
-                // Log quantization
-                for (int i = -2; i <= 2; i++)
-                {
-                    if ((symbol_index + i) >= 0 &&
-                        (symbol_index + i) < static_cast<int32_t> (baseband.len))
-                    {
-                        log_entry_t log;
-                        log.sample       = baseband.data[symbol_index + i];
-                        log.conv         = phase;
-                        log.conv_th      = 0.0;
-                        log.sample_index = symbol_index + i;
-                        log.qnt_pos_avg  = qnt_pos_avg / 1.5f;
-                        log.qnt_neg_avg  = qnt_neg_avg / 1.5f;
-                        log.symbol       = symbol;
-                        log.frame_index  = frame_index;
-                        log.flags        = 3;
-                        if(i == 0) log.flags += 8;
-
-                        pushLog(log);
-                    }
-                }
-                #endif
+            setSymbol(*demodFrame, frame_index, symbol);
+            quantizeSoft(sample, demodSoftFrame->data() + 2 * frame_index);
+            frame_index++;
 
-                setSymbol(*demodFrame, frame_index, symbol);
-                decoded_syms++;
-                frame_index++;
+            // Track the symbol timing and move to the next symbol
+            updateTimingRecovery(value, position);
+            phase += M17_SAMPLES_PER_SYMBOL;
 
-                if (frame_index == M17_SYNCWORD_SYMBOLS)
+            if (frame_index == M17_SYNCWORD_SYMBOLS)
+            {
+                /*
+                 * Check for valid syncword using hamming distance.
+                 * The demodulator switches to locked state only if there
+                 * is an exact syncword match, this avoids continuous false
+                 * detections in absence of an M17 signal.
+                 */
+                uint8_t maxHamming = 2;
+                if(locked == false) maxHamming = 0;
+
+                uint8_t minHamming = 0xFF;
+                for(uint8_t type = 0; type < SYNC_NUM; type++)
                 {
-                    /*
-                     * Check for valid syncword using hamming distance.
-                     * The demodulator switches to locked state only if there
-                     * is an exact syncword match, this avoids continuous false
-                     * detections in absence of an M17 signal.
-                     */
-                    uint8_t maxHamming = 2;
-                    if(locked == false) maxHamming = 0;
-
-                    uint8_t hammingSync = hammingDistance((*demodFrame)[0],
-                                                          STREAM_SYNC_WORD[0])
-                                        + hammingDistance((*demodFrame)[1],
-                                                          STREAM_SYNC_WORD[1]);
-
-                    uint8_t hammingLsf = hammingDistance((*demodFrame)[0],
-                                                         LSF_SYNC_WORD[0])
-                                       + hammingDistance((*demodFrame)[1],
-                                                         LSF_SYNC_WORD[1]);
-
-                    if ((hammingSync > maxHamming) && (hammingLsf > maxHamming))
-                    {
-                        // Lock lost, reset demodulator alignment (phase) only
-                        // if we were locked on a valid signal.
-                        // This to avoid, in case of absence of carrier, to fall
-                        // in a loop where the demodulator continues to search
-                        // for the syncword in the same block of samples, causing
-                        // the update function to take more than 20ms to complete.
-                        if(locked) phase = 0;
-                        syncDetected = false;
-                        locked       = false;
-
-                        #ifdef ENABLE_DEMOD_LOG
-                        // Pre-arm the log trigger.
-                        trigEnable = true;
-                        #endif
-                    }
-                    else
-                    {
-                        // Correct syncword found
-                        locked = true;
-
-                        #ifdef ENABLE_DEMOD_LOG
-                        // Trigger a data dump when lock is re-acquired.
-                        if((dumpData == false) && (trigEnable == true))
-                        {
-                            trigEnable = false;
-                            triggered  = true;
-                        }
-                        #endif
-                    }
+                    uint8_t hamming = hammingDistance((*demodFrame)[0],
+                                                      syncwords[type][0])
+                                    + hammingDistance((*demodFrame)[1],
+                                                      syncwords[type][1]);
+                    if(hamming < minHamming)
+                        minHamming = hamming;
                 }
 
-                // Locate syncword to correct clock skew between Tx and Rx
-                if (frame_index == M17_SYNCWORD_SYMBOLS + SYNC_SWEEP_OFFSET)
+                if (minHamming > maxHamming)
                 {
-                    // Find index (possibly negative) of the syncword
-                    int32_t expected_sync =
-                        phase +
-                        M17_SAMPLES_PER_SYMBOL * decoded_syms -
-                        M17_SYNCWORD_SAMPLES -
-                        SYNC_SWEEP_OFFSET * M17_SAMPLES_PER_SYMBOL;
-                    int32_t sync_skew = syncwordSweep(expected_sync);
-                    phase += sync_skew;
-                }
+                    // Lock lost, reset demodulator alignment (phase) only
+                    // if we were locked on a valid signal.
+                    // This to avoid, in case of absence of carrier, to fall
+                    // in a loop where the demodulator continues to search
+                    // for the syncword in the same block of samples, causing
+                    // the update function to take more than 20ms to complete.
+                    // Otherwise, restart the search right after the false
+                    // syncword.
+                    if(locked)
+                        phase = 0;
+                    else
+                        phase = syncIndex + 1;
 
-                // If the frame buffer is full switch demod and ready frame
-                if (frame_index == M17_FRAME_SYMBOLS)
+                    syncDetected = false;
+                    locked       = false;
+                }
+                else
                 {
-                    demodFrame.swap(readyFrame);
-                    frame_index = 0;
-                    newFrame    = true;
+                    // Correct syncword found
+                    locked = true;
                 }
+
+                #ifdef ENABLE_DEMOD_LOG
+                if(trace.enabled(TRACE_QNT))
+                    trace.push(TRACE_REC_QNT, locked, minHamming, syncIndex,
+                               qnt_pos_avg / 1.5f, qnt_neg_avg / 1.5f);
+                #endif
             }
-        }
 
-        // Copy last N samples to bridge buffer
-        memcpy(basebandBridge,
-               baseband.data + (baseband.len - M17_BRIDGE_SIZE),
-               sizeof(int16_t) * M17_BRIDGE_SIZE);
+            // If the frame buffer is full switch demod and ready frame
+            if (frame_index == M17_FRAME_SYMBOLS)
+            {
+                demodFrame.swap(readyFrame);
+                demodSoftFrame.swap(readySoftFrame);
+                frame_index = 0;
+                newFrame    = true;
+            }
+        }
     }
 
-    #if defined(PLATFORM_LINUX) && defined(ENABLE_DEMOD_LOG)
-    if (baseband.data == NULL)
-        dumpData = true;
-    #endif
-
-    return newFrame;
+    // Symbol and syncword indices relative to the next block
+    if(syncDetected)
+    {
+        phase     -= static_cast< int16_t >(len);
+        syncIndex -= static_cast< int16_t >(len);
+    }
 }
 
 void M17Demodulator::invertPhase(const bool status)
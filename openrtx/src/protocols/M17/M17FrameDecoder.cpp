@@ -25,6 +25,7 @@
 #include <M17/M17CodePuncturing.hpp>
 #include <M17/M17Constants.hpp>
 #include <M17/M17Utils.hpp>
+#include <profiling.h>
 #include <algorithm>
 
 using namespace M17;
@@ -43,6 +44,8 @@ void M17FrameDecoder::reset()
 
 M17FrameType M17FrameDecoder::decodeFrame(const frame_t& frame)
 {
+    PROF_SCOPE(PROF_M17_DECODE);
+
     std::array< uint8_t, 2 >  syncWord;
     std::array< uint8_t, 46 > data;
 
@@ -50,8 +53,42 @@ M17FrameType M17FrameDecoder::decodeFrame(const frame_t& frame)
     std::copy(frame.begin() + 2, frame.end(), data.begin());
 
     // Re-correlating data is the same operation as decorrelating
-    decorrelate(data);
-    deinterleave(data);
+    decorrelateDeinterleave(data);
+
+    auto type = getFrameType(syncWord);
+
+    switch(type)
+    {
+        case M17FrameType::LINK_SETUP:
+            decodeLSF(data);
+            break;
+
+        case M17FrameType::STREAM:
+            decodeStream(data);
+            break;
+
+        default:
+            break;
+    }
+
+    return type;
+}
+
+M17FrameType M17FrameDecoder::decodeFrame(const softframe_t& frame)
+{
+    PROF_SCOPE(PROF_M17_DECODE);
+
+    syncw_t syncWord;
+    std::array< uint16_t, 368 > data;
+
+    // Sync word is only needed for frame identification, hard-decode it
+    for(size_t i = 0; i < syncWord.size() * 8; i++)
+    {
+        setBit(syncWord, i, frame[i] > 0x7FFF);
+    }
+
+    // Decorrelate and deinterleave straight from the frame payload
+    decorrelateDeinterleave(frame.data() + 16, data);
 
     auto type = getFrameType(syncWord);
 
@@ -111,7 +148,19 @@ void M17FrameDecoder::decodeLSF(const std::array< uint8_t, 46 >& data)
 {
     std::array< uint8_t, sizeof(M17LinkSetupFrame) > tmp;
 
+    PROF_START(viterbiStart);
     viterbi.decodePunctured(data, tmp, LSF_PUNCTURE);
+    PROF_STOP(PROF_M17_VITERBI, viterbiStart);
+    memcpy(&lsf.data, tmp.data(), tmp.size());
+}
+
+void M17FrameDecoder::decodeLSF(const std::array< uint16_t, 368 >& data)
+{
+    std::array< uint8_t, sizeof(M17LinkSetupFrame) > tmp;
+
+    PROF_START(viterbiStart);
+    softViterbi.decodePunctured(data, tmp, LSF_PUNCTURE);
+    PROF_STOP(PROF_M17_VITERBI, viterbiStart);
     memcpy(&lsf.data, tmp.data(), tmp.size());
 }
 
@@ -119,31 +168,8 @@ void M17FrameDecoder::decodeStream(const std::array< uint8_t, 46 >& data)
 {
     // Extract and unpack the LICH segment contained at beginning of frame
     lich_t lich;
-    std::array < uint8_t, 6 > lsfSegment;
-
     std::copy_n(data.begin(), lich.size(), lich.begin());
-    bool decodeOk = decodeLich(lsfSegment, lich);
-
-    if(decodeOk)
-    {
-        // Append LICH segment
-        uint8_t segmentNum  = lsfSegment[5];
-        uint8_t segmentSize = lsfSegment.size() - 1;
-        uint8_t *ptr = reinterpret_cast < uint8_t * >(&lsfFromLich.data);
-        ptr += segmentNum * segmentSize;
-        memcpy(ptr, lsfSegment.data(), segmentSize);
-
-        // Mark this segment as present
-        lsfSegmentMap |= 1 << segmentNum;
-
-        // Check if we have received all the five LICH segments
-        if(lsfSegmentMap == 0x3F)
-        {
-            if(lsfFromLich.valid()) lsf = lsfFromLich;
-            lsfSegmentMap = 0;
-            lsfFromLich.clear();
-        }
-    }
+    processLich(lich);
 
     // Extract and decode stream data
     std::array< uint8_t, 34 > punctured;
@@ -153,10 +179,63 @@ void M17FrameDecoder::decodeStream(const std::array< uint8_t, 46 >& data)
     begin     += lich.size();
     std::copy(begin, data.end(), punctured.begin());
 
+    PROF_START(viterbiStart);
     viterbi.decodePunctured(punctured, tmp, DATA_PUNCTURE);
+    PROF_STOP(PROF_M17_VITERBI, viterbiStart);
     memcpy(&streamFrame.data, tmp.data(), tmp.size());
 }
 
+void M17FrameDecoder::decodeStream(const std::array< uint16_t, 368 >& data)
+{
+    // Golay decoding of the LICH is hard decision only, slice the soft bits
+    lich_t lich;
+    for(size_t i = 0; i < lich.size() * 8; i++)
+    {
+        setBit(lich, i, data[i] > 0x7FFF);
+    }
+
+    processLich(lich);
+
+    // Extract and decode stream data
+    std::array< uint16_t, 272 > punctured;
+    std::array< uint8_t, sizeof(M17StreamFrame) > tmp;
+
+    auto begin = data.begin();
+    begin     += lich.size() * 8;
+    std::copy(begin, data.end(), punctured.begin());
+
+    PROF_START(viterbiStart);
+    softViterbi.decodePunctured(punctured, tmp, DATA_PUNCTURE);
+    PROF_STOP(PROF_M17_VITERBI, viterbiStart);
+    memcpy(&streamFrame.data, tmp.data(), tmp.size());
+}
+
+void M17FrameDecoder::processLich(const lich_t& lich)
+{
+    std::array < uint8_t, 6 > lsfSegment;
+
+    bool decodeOk = decodeLich(lsfSegment, lich);
+    if(decodeOk == false) return;
+
+    // Append LICH segment
+    uint8_t segmentNum  = lsfSegment[5];
+    uint8_t segmentSize = lsfSegment.size() - 1;
+    uint8_t *ptr = reinterpret_cast < uint8_t * >(&lsfFromLich.data);
+    ptr += segmentNum * segmentSize;
+    memcpy(ptr, lsfSegment.data(), segmentSize);
+
+    // Mark this segment as present
+    lsfSegmentMap |= 1 << segmentNum;
+
+    // Check if we have received all the five LICH segments
+    if(lsfSegmentMap == 0x3F)
+    {
+        if(lsfFromLich.valid()) lsf = lsfFromLich;
+        lsfSegmentMap = 0;
+        lsfFromLich.clear();
+    }
+}
+
 bool M17FrameDecoder::decodeLich(std::array < uint8_t, 6 >& segment,
                             const lich_t& lich)
 {
@@ -167,27 +246,20 @@ bool M17FrameDecoder::decodeLich(std::array < uint8_t, 6 >& segment,
      * is the segment number, allowing to determine the correct position of the
      * segment when reassembling the LSF.
      *
-     * NOTE: LICH data is stored in big-endian format, swap and shift after
-     * memcpy convert it to little-endian.
+     * NOTE: LICH data is stored in big-endian format, unpacking of the four
+     * codewords is done by golay24_decodeLich().
      */
 
     segment.fill(0x00);
 
-    size_t   index = 0;
-    uint32_t block = 0;
+    std::array< uint16_t, 4 > blocks;
+    if(golay24_decodeLich(lich, blocks) == false)
+        return false;
 
+    size_t index = 0;
     for(size_t i = 0; i < 4; i++)
     {
-        memcpy(&block, lich.data() + 3*i, 3);
-        block = __builtin_bswap32(block) >> 8;
-        uint16_t decoded = golay24_decode(block);
-
-        // Unrecoverable error, abort decoding
-        if(decoded == 0xFFFF)
-        {
-            segment.fill(0x00);
-            return false;
-        }
+        uint16_t decoded = blocks[i];
 
         if(i & 1)
         {
@@ -44,30 +44,98 @@ static constexpr uint16_t decode_matrix[12] =
 };
 
 
-uint16_t Golay24::calcChecksum(const uint16_t& value)
+/**
+ * Compute the Golay(24,12) checksum of a 12-bit data block, usable at compile
+ * time.
+ */
+static constexpr uint16_t checksum(const uint16_t value)
 {
     uint16_t checksum = 0;
 
+    // Branchless: data bits are random, a conditional here is mispredicted
+    // half of the times.
     for(uint8_t i = 0; i < 12; i++)
     {
-        if(value & (1 << i))
-        {
-            checksum ^= encode_matrix[i];
-        }
+        uint16_t mask = -((value >> i) & 0x01);
+        checksum ^= encode_matrix[i] & mask;
     }
 
     return checksum;
 }
 
+#ifndef M17_GOLAY_NO_TABLE
 
-/**
- * Detect and correct errors in a Golay(24,12) codeword.
- *
- * @param codeword: input codeword.
- * @return bitmask corresponding to detected bit errors in the codeword, or
- * 0xFFFFFFFF if bit errors are unrecoverable.
+/*
+ * Table mapping each of the 4096 syndromes to the corresponding error pattern.
+ * Being the minimum distance of the code equal to eight, every error pattern
+ * with up to three bit errors has a distinct syndrome: the table is built by
+ * enumerating all of them, the remaining syndromes are marked as unrecoverable.
  */
+struct SyndromeTable
+{
+    uint32_t errors[4096];
+};
+
+static constexpr uint16_t syndrome(const uint32_t codeword)
+{
+    return (codeword & 0xFFF) ^ checksum((codeword >> 12) & 0xFFF);
+}
+
+static constexpr SyndromeTable buildSyndromeTable()
+{
+    SyndromeTable table = {};
+
+    for(uint32_t i = 0; i < 4096; i++)
+        table.errors[i] = 0xFFFFFFFF;
+
+    table.errors[0] = 0;
+
+    for(uint8_t i = 0; i < 24; i++)
+    {
+        uint32_t e1 = 1UL << i;
+        table.errors[syndrome(e1)] = e1;
+
+        for(uint8_t j = i + 1; j < 24; j++)
+        {
+            uint32_t e2 = e1 | (1UL << j);
+            table.errors[syndrome(e2)] = e2;
+
+            for(uint8_t k = j + 1; k < 24; k++)
+            {
+                uint32_t e3 = e2 | (1UL << k);
+                table.errors[syndrome(e3)] = e3;
+            }
+        }
+    }
+
+    return table;
+}
+
+static constexpr SyndromeTable syndromeTable = buildSyndromeTable();
+
+#endif // M17_GOLAY_NO_TABLE
+
+
+uint16_t Golay24::calcChecksum(const uint16_t& value)
+{
+    return checksum(value);
+}
+
+
 uint32_t Golay24::detectErrors(const uint32_t& codeword)
+{
+    #ifndef M17_GOLAY_NO_TABLE
+    uint16_t data   = (codeword >> 12) & 0xFFF;
+    uint16_t parity = codeword & 0xFFF;
+
+    return syndromeTable.errors[parity ^ checksum(data)];
+    #else
+    return searchErrors(codeword);
+    #endif
+}
+
+
+uint32_t Golay24::searchErrors(const uint32_t& codeword)
 {
     uint16_t data   = codeword >> 12;
     uint16_t parity = codeword & 0xFFF;
@@ -117,3 +185,25 @@ uint32_t Golay24::detectErrors(const uint32_t& codeword)
 
     return 0xFFFFFFFF;
 }
+
+
+bool M17::golay24_decodeLich(const std::array< uint8_t, 12 >& lich,
+                             std::array< uint16_t, 4 >& data)
+{
+    // Unpack the four big-endian codewords, then decode all of them. Errors
+    // are checked only once at the end.
+    uint32_t errors = 0;
+
+    for(size_t i = 0; i < 4; i++)
+    {
+        const uint8_t *ptr = lich.data() + 3*i;
+        uint32_t codeword  = (ptr[0] << 16) | (ptr[1] << 8) | ptr[2];
+        uint32_t mask      = Golay24::detectErrors(codeword);
+
+        errors |= mask & 0xFF000000;
+        data[i] = ((codeword ^ mask) >> 12) & 0x0FFF;
+    }
+
+    return (errors == 0);
+}
+
@@ -26,10 +26,6 @@
 #include <M17/M17Utils.hpp>
 #include <M17/M17DSP.hpp>
 
-#if defined(PLATFORM_LINUX)
-#include <stdio.h>
-#endif
-
 using namespace M17;
 
 
@@ -89,7 +85,6 @@ void M17Modulator::start()
 
     // Generate baseband signal and then start transmission
     symbolsToBaseband();
-    #ifndef PLATFORM_LINUX
     outPath = audioPath_request(SOURCE_MCU, SINK_RTX, PRIO_TX);
     if(outPath < 0)
     {
@@ -101,9 +96,6 @@ void M17Modulator::start()
                                    2*M17_FRAME_SAMPLES, BUF_CIRC_DOUBLE,
                                    M17_TX_SAMPLE_RATE);
     idleBuffer = outputStream_getIdleBuffer(outStream);
-    #else
-    sendBaseband();
-    #endif
 
     // Repeat baseband generation and transmission, this makes the preamble to
     // be long 80ms (two frames)
@@ -149,26 +141,27 @@ void M17Modulator::invertPhase(const bool status)
 
 void M17Modulator::symbolsToBaseband()
 {
-    memset(idleBuffer, 0x00, M17_FRAME_SAMPLES * sizeof(stream_sample_t));
+    // The polyphase RRC interpolator outputs the samples of a whole symbol
+    // period at once, scaled by 2^15.
+    static constexpr float gain = M17_RRC_GAIN / 32768.0f;
+    int32_t filtered[M17_SAMPLES_PER_SYMBOL];
 
     for(size_t i = 0; i < symbols.size(); i++)
     {
-        idleBuffer[i * 10] = symbols[i];
-    }
-
-    for(size_t i = 0; i < M17_FRAME_SAMPLES; i++)
-    {
-        float elem    = static_cast< float >(idleBuffer[i]);
-        elem          = M17::rrc_48k(elem * M17_RRC_GAIN) - M17_RRC_OFFSET;
-        #if defined(PLATFORM_MD3x0) || defined(PLATFORM_MDUV3x0)
-        elem          = pwmComp(elem);
-        #endif
-        if(invPhase) elem = 0.0f - elem;    // Invert signal phase
-        idleBuffer[i] = static_cast< int16_t >(elem);
+        M17::rrc_48k(symbols[i], filtered);
+
+        for(size_t j = 0; j < M17_SAMPLES_PER_SYMBOL; j++)
+        {
+            float elem = static_cast< float >(filtered[j]) * gain - M17_RRC_OFFSET;
+            #if defined(PLATFORM_MD3x0) || defined(PLATFORM_MDUV3x0)
+            elem       = pwmComp(elem);
+            #endif
+            if(invPhase) elem = 0.0f - elem;    // Invert signal phase
+            idleBuffer[i * M17_SAMPLES_PER_SYMBOL + j] = static_cast< int16_t >(elem);
+        }
     }
 }
 
-#ifndef PLATFORM_LINUX
 void M17Modulator::sendBaseband()
 {
     if(txRunning == false) return;
@@ -178,17 +171,3 @@ void M17Modulator::sendBaseband()
     outputStream_sync(outStream, true);
     idleBuffer = outputStream_getIdleBuffer(outStream);
 }
-#else
-void M17Modulator::sendBaseband()
-{
-    FILE *outfile = fopen("/tmp/m17_output.raw", "ab");
-
-    for(size_t i = 0; i < M17_FRAME_SAMPLES; i++)
-    {
-        auto s = idleBuffer[i];
-        fwrite(&s, sizeof(s), 1, outfile);
-    }
-
-    fclose(outfile);
-}
-#endif
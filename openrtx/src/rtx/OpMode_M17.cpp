@@ -33,8 +33,18 @@
 using namespace std;
 using namespace M17;
 
+// Codec2 frames buffered before starting playback, one M17 frame carries two
+// of them: absorbs the arrival jitter of up to two stream frames.
+static constexpr uint8_t RX_JITTER_FRAMES = 4;
+
+// Maximum number of consecutive stream frames missing from a transmission,
+// each one carries two codec2 frames concealed by the decoder.
+static constexpr uint16_t MAX_LOST_FRAMES = CODEC_PLC_MAX_FRAMES / 2;
+
 OpMode_M17::OpMode_M17() : startRx(false), startTx(false), locked(false),
-                           invertTxPhase(false), invertRxPhase(false)
+                           streamActive(false), lastFrameNum(0),
+                           invertTxPhase(false), invertRxPhase(false),
+                           rxCodec(nullptr), txCodec(nullptr)
 {
 
 }
@@ -46,12 +56,23 @@ OpMode_M17::~OpMode_M17()
 
 void OpMode_M17::enable()
 {
-    codec_init();
+    rxCodec = codec_open();
+    txCodec = codec_open();
     modulator.init();
     demodulator.init();
     locked  = false;
     startRx = true;
     startTx = false;
+
+    // Without codec instances there is no way to handle voice: stay off.
+    if((rxCodec == nullptr) || (txCodec == nullptr))
+    {
+        codec_close(rxCodec);
+        codec_close(txCodec);
+        rxCodec = nullptr;
+        txCodec = nullptr;
+        startRx = false;
+    }
 }
 
 void OpMode_M17::disable()
@@ -62,7 +83,10 @@ void OpMode_M17::disable()
     platform_ledOff(RED);
     audioPath_release(rxAudioPath);
     audioPath_release(txAudioPath);
-    codec_terminate();
+    codec_close(rxCodec);
+    codec_close(txCodec);
+    rxCodec = nullptr;
+    txCodec = nullptr;
     radio_disableRtx();
     modulator.terminate();
     demodulator.terminate();
@@ -142,14 +166,16 @@ void OpMode_M17::offState(rtxStatus_t *const status)
 
     audioPath_release(rxAudioPath);
     audioPath_release(txAudioPath);
-    codec_stop();
+    codec_stop(rxCodec);
+    codec_stop(txCodec);
 
     if(startRx)
     {
         status->opStatus = RX;
     }
 
-    if(platform_getPttStatus() && (status->txDisable == 0))
+    if(platform_getPttStatus() && (status->txDisable == 0) &&
+       (txCodec != nullptr))
     {
         startTx = true;
         status->opStatus = TX;
@@ -164,10 +190,12 @@ void OpMode_M17::rxState(rtxStatus_t *const status)
         demodulator.invertPhase(invertRxPhase);
 
         rxAudioPath = audioPath_request(SOURCE_MCU, SINK_SPK, PRIO_RX);
-        codec_startDecode(SINK_SPK);
+        codec_startDecodeBuffered(rxCodec, SINK_SPK, PRIO_RX, RX_JITTER_FRAMES);
 
         radio_enableRx();
 
+        streamActive = false;
+
         startRx = false;
     }
 
@@ -184,7 +212,7 @@ void OpMode_M17::rxState(rtxStatus_t *const status)
 
     if(locked && newData)
     {
-        auto&   frame  = demodulator.getFrame();
+        auto&   frame  = demodulator.getSoftFrame();
         auto    type   = decoder.decodeFrame(frame);
         bool    lsfOk  = decoder.getLsf().valid();
         uint8_t pthSts = audioPath_getStatus(rxAudioPath);
@@ -193,8 +221,34 @@ void OpMode_M17::rxState(rtxStatus_t *const status)
            (pthSts == PATH_OPEN))
         {
             M17StreamFrame sf = decoder.getStreamFrame();
-            codec_pushFrame(sf.payload().data(),     false);
-            codec_pushFrame(sf.payload().data() + 8, false);
+            uint16_t fn   = sf.getFrameNumber();
+            uint16_t lost = (fn - lastFrameNum - 1) & 0x7FFF;
+
+            // Frame received twice, including the last one of a transmission
+            bool repeated = (lost == 0x7FFF) &&
+                            (streamActive || ((fn & 0x8000) != 0));
+
+            if(repeated == false)
+            {
+                // Frames missed since the last one of the transmission: queue
+                // a placeholder for each of them, the decoder conceals them
+                // when their playout time comes.
+                if(streamActive && (lost <= MAX_LOST_FRAMES))
+                {
+                    for(uint16_t i = 0; i < (2 * lost); i++)
+                        codec_pushLostFrame(rxCodec, false);
+                }
+
+                codec_pushFrame(rxCodec, sf.payload().data(),     false);
+                codec_pushFrame(rxCodec, sf.payload().data() + 8, false);
+
+                // Last frame of the transmission has the MSB set
+                lastFrameNum = fn & 0x7FFF;
+                streamActive = ((fn & 0x8000) == 0);
+
+                if(streamActive == false)
+                    codec_endStream(rxCodec);
+            }
         }
     }
 
@@ -234,7 +288,7 @@ void OpMode_M17::txState(rtxStatus_t *const status)
         encoder.encodeLsf(lsf, m17Frame);
 
         txAudioPath = audioPath_request(SOURCE_MIC, SINK_MCU, PRIO_TX);
-        codec_startEncode(SOURCE_MIC);
+        codec_startEncode(txCodec, SOURCE_MIC);
         radio_enableTx();
 
         modulator.invertPhase(invertTxPhase);
@@ -246,8 +300,8 @@ void OpMode_M17::txState(rtxStatus_t *const status)
     bool      lastFrame = false;
 
     // Wait until there are 16 bytes of compressed speech, then send them
-    codec_popFrame(dataFrame.data(),     true);
-    codec_popFrame(dataFrame.data() + 8, true);
+    codec_popFrame(txCodec, dataFrame.data(),     true);
+    codec_popFrame(txCodec, dataFrame.data() + 8, true);
 
     if(platform_getPttStatus() == false)
     {
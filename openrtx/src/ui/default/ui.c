@@ -74,6 +74,7 @@
 #include <interfaces/gps.h>
 #endif
 #include <interfaces/delays.h>
+#include <profiling.h>
 #include <string.h>
 #include <battery.h>
 #include <input.h>
@@ -94,6 +95,7 @@ extern void _ui_drawMEMBottom();
 extern void _ui_drawMainVFO(ui_state_t* ui_state);
 extern void _ui_drawMainVFOInput(ui_state_t* ui_state);
 extern void _ui_drawMainMEM(ui_state_t* ui_state);
+extern bool _ui_drawMainStatus();
 /* UI menu functions, their implementation is in "ui_menu.c" */
 extern void _ui_drawMenuTop(ui_state_t* ui_state);
 extern void _ui_drawMenuBank(ui_state_t* ui_state);
@@ -248,7 +250,12 @@ const uint8_t settings_gps_num = sizeof(settings_gps_items)/sizeof(settings_gps_
 const uint8_t settings_m17_num = sizeof(settings_m17_items)/sizeof(settings_m17_items[0]);
 const uint8_t settings_voice_num = sizeof(settings_voice_items)/sizeof(settings_voice_items[0]);
 const uint8_t backup_restore_num = sizeof(backup_restore_items)/sizeof(backup_restore_items[0]);
+#ifdef ENABLE_PROFILING
+// Execution time probes are listed after the fixed info entries
+const uint8_t info_num = sizeof(info_items)/sizeof(info_items[0]) + PROF_NUM_PROBES;
+#else
 const uint8_t info_num = sizeof(info_items)/sizeof(info_items[0]);
+#endif
 const uint8_t author_num = sizeof(authors)/sizeof(authors[0]);
 
 const color_t color_black = {0, 0, 0, 255};
@@ -262,6 +269,7 @@ static ui_state_t ui_state;
 static bool macro_menu = false;
 static bool layout_ready = false;
 static bool redraw_needed = true;
+static bool status_update = false;
 
 static bool standby = false;
 static long long last_event_tick = 0;
@@ -1222,10 +1230,21 @@ void ui_updateFSM(bool *sync_rtx)
     event_t event   = evQueue[evQueue_rdPos];
     evQueue_rdPos   = newTail;
 
-    // There is some event to process, we need an UI redraw.
+    // There is some event to process, we need an UI redraw. On the main
+    // screens, status updates only need to refresh the status widgets.
     // UI redraw request is cancelled if we're in standby mode.
-    redraw_needed = true;
-    if(standby) redraw_needed = false;
+    bool mainScreen = (state.ui_screen == MAIN_VFO) ||
+                      (state.ui_screen == MAIN_MEM);
+    if((event.type == EVENT_STATUS) && mainScreen && (macro_menu == false))
+        status_update = true;
+    else
+        redraw_needed = true;
+
+    if(standby)
+    {
+        redraw_needed = false;
+        status_update = false;
+    }
 
     // Check if battery has enough charge to operate.
     // Check is skipped if there is an ongoing transmission, since the voltage
@@ -1235,6 +1254,7 @@ void ui_updateFSM(bool *sync_rtx)
     if ((!state.emergency) && (!txOngoing) && (state.charge <= 0))
     {
         state.ui_screen = LOW_BAT;
+        redraw_needed   = true;
         if(event.type == EVENT_KBD && event.payload)
         {
             state.ui_screen = MAIN_VFO;
@@ -2137,6 +2157,20 @@ void ui_updateFSM(bool *sync_rtx)
 
 bool ui_updateGUI()
 {
+    // Redraw only the status widgets of the main screens, unless something
+    // else changed
+    if((redraw_needed == false) && status_update)
+    {
+        status_update = false;
+
+        bool mainScreen = (last_state.ui_screen == MAIN_VFO) ||
+                          (last_state.ui_screen == MAIN_MEM);
+        if(mainScreen && _ui_drawMainStatus())
+            return true;
+
+        redraw_needed = true;
+    }
+
     if(redraw_needed == false)
         return false;
 
@@ -2251,6 +2285,7 @@ bool ui_updateGUI()
     }
 
     redraw_needed = false;
+    status_update = false;
     return true;
 }
 
@@ -26,6 +26,21 @@
 #include <string.h>
 #include <ui/ui_strings.h>
 
+/*
+ * Radio status shown by the main screen widgets when they were last drawn,
+ * used to redraw only the widgets whose status changed.
+ */
+static struct
+{
+    datetime_t time;
+    uint16_t   v_bat;
+    uint8_t    charge;
+    float      rssi;
+    uint8_t    micLevel;
+    uint32_t   frequency;
+}
+drawn;
+
 void _ui_drawMainBackground()
 {
     // Print top bar line of hline_h pixel height
@@ -36,6 +51,10 @@ void _ui_drawMainBackground()
 
 void _ui_drawMainTop()
 {
+    drawn.time   = last_state.time;
+    drawn.v_bat  = last_state.v_bat;
+    drawn.charge = last_state.charge;
+
 #ifdef RTC_PRESENT
     // Print clock on top bar
     datetime_t local_time = utcToLocalTime(last_state.time,
@@ -144,6 +163,7 @@ void _ui_drawFrequency()
 {
   unsigned long frequency = platform_getPttStatus() ?
        frequency = last_state.channel.tx_frequency : last_state.channel.rx_frequency;
+    drawn.frequency = frequency;
 
     // Print big numbers frequency
     gfx_print(layout.line3_pos, layout.line3_font, TEXT_ALIGN_CENTER,
@@ -217,6 +237,8 @@ void _ui_drawMainBottom()
     point_t meter_pos = { layout.horizontal_pad,
                           SCREEN_HEIGHT - meter_height - layout.bottom_pad};
     uint8_t mic_level = platform_getMicLevel();
+    drawn.rssi     = rssi;
+    drawn.micLevel = mic_level;
     switch(last_state.channel.mode)
     {
         case OPMODE_FM:
@@ -270,3 +292,45 @@ void _ui_drawMainMEM(ui_state_t* ui_state)
     _ui_drawFrequency();
     _ui_drawMainBottom();
 }
+
+bool _ui_drawMainStatus()
+{
+    bool timeChanged = (last_state.time.hour   != drawn.time.hour)   ||
+                       (last_state.time.minute != drawn.time.minute) ||
+                       (last_state.time.second != drawn.time.second);
+
+    bool topChanged  = (last_state.v_bat  != drawn.v_bat)  ||
+                       (last_state.charge != drawn.charge);
+
+    #ifdef RTC_PRESENT
+    topChanged |= timeChanged;
+    #else
+    (void) timeChanged;
+    #endif
+
+    bool bottomChanged = (last_state.rssi != drawn.rssi);
+    if(last_state.channel.mode != OPMODE_FM)
+        bottomChanged |= (platform_getMicLevel() != drawn.micLevel);
+
+    // Frequency changes when transmission starts or stops
+    uint32_t frequency = platform_getPttStatus() ?
+                         last_state.channel.tx_frequency :
+                         last_state.channel.rx_frequency;
+    if(frequency != drawn.frequency)
+        return false;
+
+    if(topChanged)
+    {
+        gfx_clearRows(0, layout.top_h);
+        _ui_drawMainTop();
+    }
+
+    if(bottomChanged)
+    {
+        gfx_clearRows(SCREEN_HEIGHT - layout.bottom_h - layout.bottom_pad,
+                      SCREEN_HEIGHT);
+        _ui_drawMainBottom();
+    }
+
+    return true;
+}
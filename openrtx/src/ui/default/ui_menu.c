@@ -28,6 +28,7 @@
 #include <interfaces/platform.h>
 #include <interfaces/delays.h>
 #include <memory_profiling.h>
+#include <profiling.h>
 #include <ui/ui_strings.h>
 #include <core/voicePromptUtils.h>
 
@@ -403,6 +404,16 @@ int _ui_getBackupRestoreEntryName(char *buf, uint8_t max_len, uint8_t index)
 int _ui_getInfoEntryName(char *buf, uint8_t max_len, uint8_t index)
 {
     if(index >= info_num) return -1;
+
+    #ifdef ENABLE_PROFILING
+    uint8_t probe = info_num - PROF_NUM_PROBES;
+    if(index >= probe)
+    {
+        snprintf(buf, max_len, "%s", prof_getName(index - probe));
+        return 0;
+    }
+    #endif
+
     snprintf(buf, max_len, "%s", info_items[index]);
     return 0;
 }
@@ -411,6 +422,20 @@ int _ui_getInfoValueName(char *buf, uint8_t max_len, uint8_t index)
 {
     const hwInfo_t* hwinfo = platform_getHwInfo();
     if(index >= info_num) return -1;
+
+    #ifdef ENABLE_PROFILING
+    // Average and maximum execution time of the probes
+    uint8_t probe = info_num - PROF_NUM_PROBES;
+    if(index >= probe)
+    {
+        profStats_t stats;
+        prof_getStats(index - probe, &stats);
+        snprintf(buf, max_len, "%u/%uus", (unsigned int) stats.avg,
+                                          (unsigned int) stats.max);
+        return 0;
+    }
+    #endif
+
     switch(index)
     {
         case 0: // Git Version
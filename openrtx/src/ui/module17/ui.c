@@ -30,6 +30,7 @@
 #include <interfaces/gps.h>
 #endif
 #include <interfaces/delays.h>
+#include <profiling.h>
 #include <string.h>
 #include <battery.h>
 #include <input.h>
@@ -179,7 +180,12 @@ const uint8_t settings_gps_num = sizeof(settings_gps_items)/sizeof(settings_gps_
 #endif
 const uint8_t m17_num = sizeof(m17_items)/sizeof(m17_items[0]);
 const uint8_t module17_num = sizeof(module17_items)/sizeof(module17_items[0]);
+#ifdef ENABLE_PROFILING
+// Execution time probes are listed after the fixed info entries
+const uint8_t info_num = sizeof(info_items)/sizeof(info_items[0]) + PROF_NUM_PROBES;
+#else
 const uint8_t info_num = sizeof(info_items)/sizeof(info_items[0]);
+#endif
 const uint8_t author_num = sizeof(authors)/sizeof(authors[0]);
 
 const color_t color_black = {0, 0, 0, 255};
@@ -20,7 +20,6 @@
 
 #include <interfaces/gps.h>
 #include <interfaces/delays.h>
-#include <sys/time.h>
 #include <hwconfig.h>
 #include <string.h>
 
@@ -85,9 +84,7 @@ int gps_getNmeaSentence(char *buf, const size_t maxLength)
     i %= NMEA_SAMPLES;
 
     // Save the current timestamp for sentence ready emulation
-    struct timeval te;
-    gettimeofday(&te, NULL);
-    startTime = te.tv_sec*1000LL + te.tv_usec/1000;
+    startTime = getTick();
 
     return 0;
 }
@@ -95,11 +92,7 @@ int gps_getNmeaSentence(char *buf, const size_t maxLength)
 bool gps_nmeaSentenceReady()
 {
     // Return new sentence ready only after 1s from start
-    struct timeval te;
-    gettimeofday(&te, NULL);
-    long long currTime = te.tv_sec*1000LL + te.tv_usec/1000;
-
-    if((currTime -  startTime) > 1000) return true;
+    if((getTick() - startTime) > 1000) return true;
 
     return false;
 }
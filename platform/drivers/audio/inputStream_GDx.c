@@ -49,6 +49,33 @@ dataBlock_t inputStream_getData(streamId id)
     return block;
 }
 
+streamId inputStream_startWithHistory(const enum AudioSource source,
+                                      const enum AudioPriority prio,
+                                      stream_sample_t * const buf,
+                                      const size_t bufLength,
+                                      const size_t history,
+                                      const uint32_t sampleRate)
+{
+    (void) source;
+    (void) prio;
+    (void) buf;
+    (void) bufLength;
+    (void) history;
+    (void) sampleRate;
+
+    return -1;
+}
+
+dataBlock_t inputStream_acquire(streamId id)
+{
+    return inputStream_getData(id);
+}
+
+void inputStream_release(streamId id)
+{
+    (void) id;
+}
+
 void inputStream_stop(streamId id)
 {
     (void) id;
@@ -24,6 +24,7 @@
 #include <interfaces/gpio.h>
 #include <hwconfig.h>
 #include <stdbool.h>
+#include <string.h>
 #include <miosix.h>
 #include <timers.h>
 
@@ -36,6 +37,8 @@ static stream_sample_t *bufAddr  = 0;           // Start address of data buffer,
 static stream_sample_t *bufCurr  = 0;           // Buffer address to be returned to application.
 static size_t           bufLen   = 0;           // Buffer length.
 static uint8_t          bufMode  = BUF_LINEAR;  // Buffer management mode.
+static size_t           histLen  = 0;           // Length of the history region in front of the buffer.
+static stream_sample_t *bufHeld  = 0;           // Block acquired by the application.
 
 void __attribute__((used)) DmaHandlerImpl()
 {
@@ -110,6 +113,8 @@ streamId inputStream_start(const enum AudioSource source,
     bufMode = mode;
     bufAddr = buf;
     bufLen  = bufLength;
+    histLen = 0;
+    bufHeld = 0;
 
     RCC->APB2ENR |= RCC_APB2ENR_ADC2EN;    // Enable ADC
     RCC->APB1ENR |= RCC_APB1ENR_TIM2EN;    // Enable conv. timebase timer
@@ -268,6 +273,50 @@ dataBlock_t inputStream_getData(streamId id)
     return block;
 }
 
+streamId inputStream_startWithHistory(const enum AudioSource source,
+                                      const enum AudioPriority prio,
+                                      stream_sample_t * const buf,
+                                      const size_t bufLength,
+                                      const size_t history,
+                                      const uint32_t sampleRate)
+{
+    if((3 * history) > bufLength) return -1;
+
+    // The DMA writes only after the history region
+    streamId id = inputStream_start(source, prio, buf + history,
+                                    bufLength - history, BUF_CIRC_DOUBLE,
+                                    sampleRate);
+    if(id < 0) return id;
+
+    memset(buf, 0x00, history * sizeof(stream_sample_t));
+    histLen = history;
+
+    return id;
+}
+
+dataBlock_t inputStream_acquire(streamId id)
+{
+    dataBlock_t block = inputStream_getData(id);
+    bufHeld = block.data;
+
+    return block;
+}
+
+void inputStream_release(streamId id)
+{
+    if((id < 0) || (bufHeld == 0)) return;
+
+    // The first half is contiguous to the history of the second one, the
+    // tail of the second half has to be moved in front of the first one.
+    if((bufHeld != bufAddr) && (histLen > 0))
+    {
+        memcpy(bufAddr - histLen, bufAddr + bufLen - histLen,
+               histLen * sizeof(stream_sample_t));
+    }
+
+    bufHeld = 0;
+}
+
 void inputStream_stop(streamId id)
 {
     if(id < 0) return;
@@ -17,20 +17,54 @@
 
 #include <hwconfig.h>
 #include <interfaces/audio_stream.h>
+#include <baseband_linux.h>
+#include <virtual_clock.h>
+#include <pulse/simple.h>
+#include <pulse/error.h>
 #include <stddef.h>
 
 #include <atomic>
-#include <cassert>
 #include <chrono>
+#include <condition_variable>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <functional>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <thread>
 
+/*
+ * Input streams read their samples from a "<SOURCE>.raw" file in the working
+ * directory, delivered at the pace of the stream sample rate. The behaviour
+ * can be changed with the following environment variables:
+ *
+ * - OPENRTX_INPUT=pulse: capture the samples from the default PulseAudio
+ *   recording device instead of reading them from file.
+ * - OPENRTX_INPUT_FAST=1: deliver the file samples as fast as they are
+ *   consumed, without waiting for the sampling time. No sample is lost, the
+ *   producer waits for the consumer instead, allowing to run the whole RX
+ *   chain faster than real time.
+ *
+ * The RTX source reads from the baseband bus instead, when the bus has been
+ * configured as described in baseband_linux.h.
+ *
+ * When the emulator runs in virtual time the samples are read from file and
+ * delivered at the pace of the virtual clock, by the thread requesting them.
+ */
+
 streamId gNextAvailableStreamId = 0;
 
+static bool envEnabled(const char* name, const char* value)
+{
+    const char* env = getenv(name);
+    if (env == nullptr) return false;
+
+    return strcmp(env, value) == 0;
+}
+
 class InputStream
 {
    public:
@@ -39,10 +73,11 @@ class InputStream
                 stream_sample_t* buf,
                 size_t bufLength,
                 enum BufMode mode,
-                uint32_t sampleRate)
+                uint32_t sampleRate,
+                size_t history)
         : m_run_thread(true), m_func_running(false)
     {
-        if (bufLength % 2)
+        if ((bufLength - history) % 2)
         {
             fprintf(stderr, "InputStream error: invalid bufLength %lu\n",
                     bufLength);
@@ -51,44 +86,51 @@ class InputStream
 
         m_db_ready[0] = m_db_ready[1] = false;
 
-        std::string sourceString;
         switch (source)
         {
             case SOURCE_MIC:
-                sourceString = "MIC";
+                m_name = "MIC";
                 break;
             case SOURCE_MCU:
-                sourceString = "MCU";
+                m_name = "MCU";
                 break;
             case SOURCE_RTX:
-                sourceString = "RTX";
+                m_name = "RTX";
                 break;
             default:
                 break;
         }
 
-        m_fp = fopen((sourceString + ".raw").c_str(), "rb");
-        if (!m_fp)
-        {
-            fprintf(stderr, "InputStream error: cannot open: %s.raw\n",
-                    sourceString.c_str());
-            return;
-        }
+        m_virtual = vclock_enabled();
+        m_bus     = (source == SOURCE_RTX) && baseband_openRx();
+        m_capture = envEnabled("OPENRTX_INPUT", "pulse") && !m_virtual && !m_bus;
+        m_fast    = envEnabled("OPENRTX_INPUT_FAST", "1") && !m_virtual && !m_bus;
 
-        fseek(m_fp, 0, SEEK_END);
-        m_size = ftell(m_fp);
-        fseek(m_fp, 0, SEEK_SET);
-        if (m_size % 2 || m_size == 0)
+        if ((m_capture == false) && (m_bus == false))
         {
-            fprintf(stderr, "InputStream error: invalid file: %s.raw\n",
-                    sourceString.c_str());
-            return;
+            m_fp = fopen((m_name + ".raw").c_str(), "rb");
+            if (!m_fp)
+            {
+                fprintf(stderr, "InputStream error: cannot open: %s.raw\n",
+                        m_name.c_str());
+                return;
+            }
+
+            fseek(m_fp, 0, SEEK_END);
+            m_size = ftell(m_fp);
+            fseek(m_fp, 0, SEEK_SET);
+            if (m_size % 2 || m_size == 0)
+            {
+                fprintf(stderr, "InputStream error: invalid file: %s.raw\n",
+                        m_name.c_str());
+                return;
+            }
         }
 
         m_valid = true;
 
         changeId();
-        setStreamData(priority, buf, bufLength, mode, sampleRate);
+        setStreamData(priority, buf, bufLength, mode, sampleRate, history);
     }
 
     bool isValid() const
@@ -101,6 +143,7 @@ class InputStream
         stopThread();
 
         if (m_fp) fclose(m_fp);
+        if (m_pa) pa_simple_free(m_pa);
     }
 
     dataBlock_t getDataBlock()
@@ -111,36 +154,83 @@ class InputStream
         {
             case BufMode::BUF_LINEAR:
             {
-                // With this mode, just sleep for the right amount of time
-                // and return the buffer content
-                if (!fillBuffer(m_buf, m_bufLength)) return {NULL, 0};
+                // With this mode, just wait for the acquisition of a whole
+                // buffer and return its content
+                auto deadline = std::chrono::steady_clock::now();
+                if (!fillBuffer(m_buf, m_bufLength, deadline))
+                    return {NULL, 0};
 
                 return {m_buf, m_bufLength};
             }
             case BufMode::BUF_CIRC_DOUBLE:
             {
-                // If this mode is selected, wait for the readiness of the
-                // current slice and return it
+                // The slice returned by the previous call is owned by the
+                // consumer until now
+                releaseBlock();
+                return acquireBlock();
+            }
+            default:
+                return {NULL, 0};
+        }
+    }
 
-                int id = m_db_curread;
+    // Wait for the readiness of the current slice of the double buffer and
+    // hand it to the consumer, until released.
+    dataBlock_t acquireBlock()
+    {
+        if (!m_valid || (m_mode != BufMode::BUF_CIRC_DOUBLE) || m_db_held)
+            return {NULL, 0};
 
-                // Wait for `m_buf` to be ready
-                while (!m_db_ready[id] && m_run_thread)
-                {
-                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
-                }
-                if (!m_run_thread) return {NULL, 0};
+        int id      = m_db_curread;
+        size_t half = m_bufLength / 2;
+        auto* pos   = m_buf + id * half;
 
-                // Return the buffer contents
-                auto* pos      = m_buf + id * (m_bufLength / 2);
-                m_db_ready[id] = 0;
+        // In virtual time the slice is acquired when requested, at the time
+        // the DMA would have completed it.
+        if (m_virtual)
+        {
+            auto deadline = std::chrono::steady_clock::now();
+            if (!fillBuffer(pos, half, deadline)) return {NULL, 0};
+        }
+        else
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [&] { return m_db_ready[id] || !m_run_thread; });
+            if (!m_run_thread) return {NULL, 0};
 
-                // Update the read buffer
-                m_db_curread = (id + 1) % 2;
-                return {pos, m_bufLength / 2};
-            }
-            default:
-                return {NULL, 0};
+            // In fast mode the producer waits for the slice to be released
+            if (m_fast == false) m_db_ready[id] = false;
+        }
+
+        m_db_held    = true;
+        m_db_curread = (id + 1) % 2;
+        return {pos, half};
+    }
+
+    // Give the slice back to the stream. The tail of the second slice becomes
+    // the history of the first one, the first slice is already contiguous to
+    // the second one.
+    void releaseBlock()
+    {
+        if (!m_db_held) return;
+
+        m_db_held = false;
+        int id    = (m_db_curread + 1) % 2;
+
+        if ((id == 1) && (m_history > 0))
+        {
+            memcpy(m_buf - m_history, m_buf + m_bufLength - m_history,
+                   m_history * sizeof(stream_sample_t));
+        }
+
+        // In fast mode the tail of the first slice, being the history of the
+        // second one, is kept until the second slice is released too.
+        if (m_fast && ((m_history == 0) || (id == 1)))
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_db_ready[id] = false;
+            if (m_history > 0) m_db_ready[0] = false;
+            m_cv.notify_all();
         }
     }
 
@@ -164,118 +254,226 @@ class InputStream
                        stream_sample_t* buf,
                        size_t bufLength,
                        BufMode mode,
-                       uint32_t sampleRate)
+                       uint32_t sampleRate,
+                       size_t history)
     {
         if (!m_valid) return;
 
         stopThread();
         m_run_thread = true;  // set it as runnable again
 
-        // HERE stop thread
-        m_prio       = priority;
-        m_buf        = buf;
-        m_bufLength  = bufLength;
-        m_mode       = mode;
-        m_sampleRate = sampleRate;
+        m_prio        = priority;
+        m_buf         = buf + history;
+        m_bufLength   = bufLength - history;
+        m_history     = history;
+        m_mode        = mode;
+        m_db_curread  = 0;
+        m_db_held     = false;
+        m_db_ready[0] = m_db_ready[1] = false;
+        m_vdeadline   = vclock_now();
 
-        switch (m_mode)
+        if (history > 0)
+            memset(buf, 0x00, history * sizeof(stream_sample_t));
+
+        // Receiver restarted, drop the baseband sent while it was off
+        if (m_bus) baseband_openRx();
+
+        if (m_capture && ((m_pa == nullptr) || (m_sampleRate != sampleRate)))
         {
-            case BufMode::BUF_LINEAR:
-                // TODO: stop a running thread
-                break;
-            case BufMode::BUF_CIRC_DOUBLE:
-                m_thread =
-                    std::thread(std::bind(&InputStream::threadFunc, this));
-                // TODO: start thread
-                break;
+            if (!openCapture(sampleRate))
+            {
+                m_valid = false;
+                return;
+            }
         }
+
+        m_sampleRate = sampleRate;
+
+        if ((m_mode == BufMode::BUF_CIRC_DOUBLE) && (m_virtual == false))
+            m_thread = std::thread(std::bind(&InputStream::threadFunc, this));
     }
 
    private:
     bool m_valid    = false;
+    bool m_capture  = false;  // Samples come from PulseAudio
+    bool m_fast     = false;  // File samples delivered without pacing
+    bool m_virtual  = false;  // Samples paced by the virtual clock
+    bool m_bus      = false;  // Samples come from the baseband bus
     FILE* m_fp      = nullptr;
+    pa_simple* m_pa = nullptr;
     uint64_t m_size = 0;
+    std::string m_name;
 
     streamId m_id;
     AudioPriority m_prio;
     BufMode m_mode;
     uint32_t m_sampleRate = 0;
 
-    stream_sample_t* m_buf = nullptr;
-    size_t m_bufLength     = 0;
+    stream_sample_t* m_buf = nullptr;  // Start of the first slice
+    size_t m_bufLength     = 0;        // Length, history excluded
+    size_t m_history       = 0;        // History in front of the buffer
 
-    size_t m_db_curwrite = 0;
+    uint64_t m_vdeadline = 0;  // Virtual time of the last acquisition end
     size_t m_db_curread  = 0;
-    std::atomic<bool> m_db_ready[2];
+    bool m_db_ready[2];  // Protected by m_mutex
+    bool m_db_held = false;  // A slice has been returned to the consumer
     std::atomic<bool> m_run_thread;
     std::atomic<bool> m_func_running;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
     std::thread m_thread;
 
+    bool openCapture(uint32_t sampleRate)
+    {
+        if (m_pa) pa_simple_free(m_pa);
+
+        pa_sample_spec spec;
+        spec.format   = PA_SAMPLE_S16LE;
+        spec.channels = 1;
+        spec.rate     = sampleRate;
+
+        // Deliver the samples in fragments of half a buffer
+        pa_buffer_attr attr;
+        attr.maxlength = (uint32_t)-1;
+        attr.tlength   = (uint32_t)-1;
+        attr.prebuf    = (uint32_t)-1;
+        attr.minreq    = (uint32_t)-1;
+        attr.fragsize  = (m_bufLength / 2) * sizeof(stream_sample_t);
+
+        int error = 0;
+        m_pa = pa_simple_new(NULL, "OpenRTX", PA_STREAM_RECORD, NULL,
+                             (m_name + " in").c_str(), &spec, NULL, &attr,
+                             &error);
+        if (m_pa == nullptr)
+        {
+            fprintf(stderr, "InputStream error: pa_simple_new() failed: %s\n",
+                    pa_strerror(error));
+            return false;
+        }
+
+        return true;
+    }
+
     // Emulate an ADC that reads to the circular buffer
     void threadFunc()
     {
-        m_db_ready[0] = m_db_ready[1] = false;
+        auto deadline = std::chrono::steady_clock::now();
+        size_t half   = m_bufLength / 2;
+        size_t id     = 0;
+
         while (m_run_thread)
         {
-            m_db_ready[0] = false;
-            m_db_curwrite = 0;
-            fillBuffer(m_buf, m_bufLength / 2);
-            m_db_ready[0] = true;
-            if (!m_run_thread) break;
-
-            m_db_curwrite = 1;
-            m_db_ready[1] = false;
-            fillBuffer(m_buf + m_bufLength / 2, m_bufLength / 2);
-            m_db_ready[1] = true;
+            std::unique_lock<std::mutex> lock(m_mutex);
+
+            // In fast mode wait for the consumer to release the slice,
+            // otherwise overwrite it as the DMA would do.
+            if (m_fast)
+                m_cv.wait(lock, [&] { return !m_db_ready[id] || !m_run_thread; });
+
+            m_db_ready[id] = false;
+            lock.unlock();
+
+            if (!fillBuffer(m_buf + id * half, half, deadline))
+            {
+                // Stopped or capture error: wake up a consumer waiting for
+                // data, which then gets an empty block.
+                lock.lock();
+                m_run_thread = false;
+                lock.unlock();
+                m_cv.notify_all();
+                break;
+            }
+
+            lock.lock();
+            m_db_ready[id] = true;
+            lock.unlock();
+            m_cv.notify_all();
+
+            id = (id + 1) % 2;
         }
     }
 
+    // Wait until the given time point or until the stream is stopped.
+    // Returns false if the stream has been stopped.
+    bool waitUntil(std::chrono::steady_clock::time_point deadline)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        return !m_cv.wait_until(lock, deadline, [&] { return !m_run_thread; });
+    }
+
     // This is a blocking function that emulates an ADC writing to the
     // specified memory region. It takes the same time that an ADC would take
-    // to sample the same quantity of data.
-    bool fillBuffer(stream_sample_t* dest, size_t sz)
+    // to sample the same quantity of data, counted from the given deadline
+    // which is then moved forward. Captured data and files read in fast mode
+    // are returned as soon as they are available.
+    bool fillBuffer(stream_sample_t* dest, size_t sz,
+                    std::chrono::steady_clock::time_point& deadline)
     {
-        size_t i = 0;
         if (!m_run_thread) return false;
 
-        assert(m_func_running == false);
         m_func_running = true;
 
         auto reset_func_running = [&]()
         {
-            assert(m_func_running == true);
-            m_func_running = false;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_func_running = false;
+            }
+
+            m_cv.notify_all();
         };
 
-        using std::chrono::microseconds;
+        if (m_capture)
+        {
+            int error = 0;
+            if (pa_simple_read(m_pa, dest, sz * sizeof(stream_sample_t),
+                               &error) < 0)
+            {
+                fprintf(stderr, "InputStream error: pa_simple_read() failed: %s\n",
+                        pa_strerror(error));
+                reset_func_running();
+                return false;
+            }
+
+            reset_func_running();
+            return m_run_thread;
+        }
+
+        if (m_virtual && (m_sampleRate > 0))
+        {
+            uint64_t now = vclock_now();
+            if (m_vdeadline < now) m_vdeadline = now;
 
-        if (m_sampleRate > 0)
+            m_vdeadline += sz * 1000000ull / m_sampleRate;
+            vclock_sleepUntil(m_vdeadline);
+        }
+        else if ((m_fast == false) && (m_sampleRate > 0))
         {
-            // Do a piecewise-sleep so that it's easily interruptible
-            uint64_t microsec = sz * 1000000 / m_sampleRate;
-            while (microsec > 10000)
+            using std::chrono::nanoseconds;
+
+            // When late, restart the timing from now instead of delivering
+            // the missed blocks in a burst, overwriting unread data.
+            auto now = std::chrono::steady_clock::now();
+            if (deadline < now) deadline = now;
+
+            deadline += nanoseconds(sz * 1000000000ull / m_sampleRate);
+            if (!waitUntil(deadline))
             {
-                if (!m_run_thread)
-                {
-                    // Early exit if the class is being deallocated
-                    reset_func_running();
-                    return false;
-                }
-
-                std::this_thread::sleep_for(microseconds(10000));
-                microsec -= 10000;
+                // Early exit if the class is being deallocated
+                reset_func_running();
+                return false;
             }
-            std::this_thread::sleep_for(microseconds(microsec));
         }
 
-        if (!m_run_thread)
+        if (m_bus)
         {
-            // Early exit if the class is being deallocated
+            baseband_read(dest, sz, m_sampleRate);
             reset_func_running();
-            return false;
+            return true;
         }
 
         // Fill the buffer
+        size_t i = 0;
         while (i < sz)
         {
             auto n = fread(dest + i, 2, sz - i, m_fp);
@@ -283,17 +481,18 @@ class InputStream
             i += n;
         }
 
-        assert(i == sz);
         reset_func_running();
         return true;
     }
 
     void stopThread()
     {
-        m_run_thread = false;
-
-        while (m_func_running)
-            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_run_thread = false;
+            m_cv.notify_all();
+            m_cv.wait(lock, [&] { return !m_func_running; });
+        }
 
         if (m_thread.joinable()) m_thread.join();
     }
@@ -301,12 +500,13 @@ class InputStream
 
 std::map<AudioSource, std::unique_ptr<InputStream>> gOpenStreams;
 
-streamId inputStream_start(const enum AudioSource source,
-                           const enum AudioPriority priority,
-                           stream_sample_t* const buf,
-                           const size_t bufLength,
-                           const enum BufMode mode,
-                           const uint32_t sampleRate)
+static streamId startStream(const enum AudioSource source,
+                            const enum AudioPriority priority,
+                            stream_sample_t* const buf,
+                            const size_t bufLength,
+                            const enum BufMode mode,
+                            const uint32_t sampleRate,
+                            const size_t history)
 {
     auto it = gOpenStreams.find(source);
     if (it != gOpenStreams.end())
@@ -315,13 +515,15 @@ streamId inputStream_start(const enum AudioSource source,
         if (inputStream->priority() >= priority) return -1;
 
         inputStream->changeId();
-        inputStream->setStreamData(priority, buf, bufLength, mode, sampleRate);
+        inputStream->setStreamData(priority, buf, bufLength, mode, sampleRate,
+                                   history);
 
         return inputStream->id();
     }
 
     auto stream = std::make_unique<InputStream>(source, priority, buf,
-                                                bufLength, mode, sampleRate);
+                                                bufLength, mode, sampleRate,
+                                                history);
 
     if (!stream->isValid()) return -1;
 
@@ -333,21 +535,59 @@ streamId inputStream_start(const enum AudioSource source,
     return id;
 }
 
-dataBlock_t inputStream_getData(streamId id)
+static InputStream* findStream(const streamId id)
 {
-    InputStream* stream = nullptr;
     for (auto& i : gOpenStreams)
-        if (i.second->id() == id)
-        {
-            stream = i.second.get();
-            break;
-        }
+        if (i.second->id() == id) return i.second.get();
+
+    return nullptr;
+}
+
+streamId inputStream_start(const enum AudioSource source,
+                           const enum AudioPriority priority,
+                           stream_sample_t* const buf,
+                           const size_t bufLength,
+                           const enum BufMode mode,
+                           const uint32_t sampleRate)
+{
+    return startStream(source, priority, buf, bufLength, mode, sampleRate, 0);
+}
 
+dataBlock_t inputStream_getData(streamId id)
+{
+    InputStream* stream = findStream(id);
     if (stream == nullptr) return dataBlock_t{NULL, 0};
 
     return stream->getDataBlock();
 }
 
+streamId inputStream_startWithHistory(const enum AudioSource source,
+                                      const enum AudioPriority priority,
+                                      stream_sample_t* const buf,
+                                      const size_t bufLength,
+                                      const size_t history,
+                                      const uint32_t sampleRate)
+{
+    if ((3 * history) > bufLength) return -1;
+
+    return startStream(source, priority, buf, bufLength, BUF_CIRC_DOUBLE,
+                       sampleRate, history);
+}
+
+dataBlock_t inputStream_acquire(streamId id)
+{
+    InputStream* stream = findStream(id);
+    if (stream == nullptr) return dataBlock_t{NULL, 0};
+
+    return stream->acquireBlock();
+}
+
+void inputStream_release(streamId id)
+{
+    InputStream* stream = findStream(id);
+    if (stream != nullptr) stream->releaseBlock();
+}
+
 void inputStream_stop(streamId id)
 {
     AudioSource src;
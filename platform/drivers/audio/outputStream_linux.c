@@ -19,6 +19,8 @@
  ***************************************************************************/
 
 #include <interfaces/audio_stream.h>
+#include <baseband_linux.h>
+#include <virtual_clock.h>
 #include <pulse/pulseaudio.h>
 #include <pulse/simple.h>
 #include <pulse/error.h>
@@ -27,6 +29,7 @@
 #include <unistd.h>
 #include <string.h>
 #include <stdio.h>
+#include <time.h>
 
 // Expand opaque pa_simple struct
 struct pa_simple
@@ -49,9 +52,113 @@ static stream_sample_t   *playBuf    = NULL;        // Buffer being reproduced
 static stream_sample_t   *idleBuf    = NULL;        // Idle buffer available to be filled
 static pa_simple         *paInstance = NULL;        // Pulseaudio instance
 static size_t             remaining  = 0;
+static uint32_t           rate       = 0;           // Sample rate
+static uint64_t           vDeadline  = 0;           // End of playback, virtual time
 static pthread_cond_t     barrier;
 static pthread_mutex_t    mutex;
 
+/*
+ * Output stream towards the baseband bus, running independently from the
+ * one towards the speaker.
+ */
+#define RTX_STREAM_ID 1
+
+static struct
+{
+    stream_sample_t *buf;           // Stream buffer
+    size_t           len;           // Stream buffer length
+    enum BufMode     mode;          // Buffer operation mode
+    uint32_t         rate;          // Sample rate
+    size_t           playIdx;       // Index of the half being transmitted
+    uint64_t         deadline;      // End of transmission of current data, us
+    bool             running;
+}
+rtxStream;
+
+static uint64_t timeUs()
+{
+    if(vclock_enabled())
+        return vclock_now();
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec * 1000000ULL) + (ts.tv_nsec / 1000);
+}
+
+static void sleepUntilUs(const uint64_t time)
+{
+    if(vclock_enabled())
+    {
+        vclock_sleepUntil(time);
+        return;
+    }
+
+    struct timespec ts;
+    ts.tv_sec  = time / 1000000ULL;
+    ts.tv_nsec = (time % 1000000ULL) * 1000;
+    while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) != 0) ;
+}
+
+/**
+ * \internal
+ * Send a block of samples to the baseband bus, moving forward the time at
+ * which their transmission ends.
+ */
+static void rtx_send(const stream_sample_t *samples, const size_t length)
+{
+    // When late, restart the timing from now
+    uint64_t now = timeUs();
+    if(rtxStream.deadline < now)
+        rtxStream.deadline = now;
+
+    rtxStream.deadline += (length * 1000000ULL) / rtxStream.rate;
+    baseband_write(samples, length);
+}
+
+static streamId rtx_start(stream_sample_t* const buffer, const size_t length,
+                          const enum BufMode mode, const uint32_t sampleRate)
+{
+    if((rtxStream.running) || (sampleRate != BASEBAND_SAMPLE_RATE))
+        return -1;
+
+    rtxStream.buf     = buffer;
+    rtxStream.len     = length;
+    rtxStream.mode    = mode;
+    rtxStream.rate    = sampleRate;
+    rtxStream.playIdx = 0;
+    rtxStream.running = true;
+
+    baseband_openTx();
+    if(mode == BUF_LINEAR)
+        rtx_send(buffer, length);
+    else
+        rtx_send(buffer, length/2);
+
+    return RTX_STREAM_ID;
+}
+
+static bool rtx_sync()
+{
+    // Wait for the end of the data being transmitted
+    sleepUntilUs(rtxStream.deadline);
+
+    if((rtxStream.running == false) || (rtxStream.mode == BUF_LINEAR))
+        return true;
+
+    // Transmit the half filled in the meantime
+    size_t half = rtxStream.len/2;
+    rtxStream.playIdx ^= 1;
+    rtx_send(rtxStream.buf + (rtxStream.playIdx * half), half);
+
+    return true;
+}
+
+static void rtx_stop()
+{
+    rtxStream.running = false;
+    baseband_flush();
+}
+
 static void buf_circ_write_cb(pa_stream* s, size_t length, void* userdata)
 {
     (void) userdata;
@@ -103,6 +210,9 @@ streamId outputStream_start(const enum AudioSink destination,
                             const uint32_t sampleRate)
 {
 
+    if(destination == SINK_RTX)
+        return rtx_start(buffer, length, mode, sampleRate);
+
     if(destination != SINK_SPK)
         return -1;
 
@@ -123,6 +233,18 @@ streamId outputStream_start(const enum AudioSink destination,
     idleBuf   = buffer + (length/2);
     bufLen    = length;
     remaining = length/2;
+    rate      = sampleRate;
+
+    // In virtual time there is no real playback: the stream only keeps the
+    // timing of the buffers.
+    if(vclock_enabled())
+    {
+        vDeadline = vclock_now();
+        if(mode == BUF_LINEAR)
+            vDeadline += (length * 1000000ULL) / sampleRate;
+
+        return 0;
+    }
 
     int  paError = 0;
     bool success = true;
@@ -208,12 +330,21 @@ streamId outputStream_start(const enum AudioSink destination,
 
 stream_sample_t *outputStream_getIdleBuffer(const streamId id)
 {
-    (void) id;
-
     stream_sample_t *ptr = NULL;
 
+    if(id == RTX_STREAM_ID)
+    {
+        if(rtxStream.mode == BUF_CIRC_DOUBLE)
+            ptr = rtxStream.buf + ((rtxStream.playIdx ^ 1) * (rtxStream.len/2));
+
+        return ptr;
+    }
+
     if(bufMode == BUF_CIRC_DOUBLE)
     {
+        if(vclock_enabled())
+            return idleBuf;
+
         pthread_mutex_lock(&mutex);
         ptr = idleBuf;
         pthread_mutex_unlock(&mutex);
@@ -224,9 +355,30 @@ stream_sample_t *outputStream_getIdleBuffer(const streamId id)
 
 bool outputStream_sync(const streamId id, const bool bufChanged)
 {
-    (void) id;
     (void) bufChanged;
 
+    if(id == RTX_STREAM_ID)
+        return rtx_sync();
+
+    if(vclock_enabled())
+    {
+        if(bufMode == BUF_CIRC_DOUBLE)
+        {
+            vDeadline += ((bufLen/2) * 1000000ULL) / rate;
+            vclock_sleepUntil(vDeadline);
+
+            stream_sample_t *tmp = playBuf;
+            playBuf = idleBuf;
+            idleBuf = tmp;
+        }
+        else
+        {
+            vclock_sleepUntil(vDeadline);
+        }
+
+        return true;
+    }
+
     if(bufMode == BUF_CIRC_DOUBLE)
     {
         pthread_mutex_lock(&mutex);
@@ -243,10 +395,14 @@ bool outputStream_sync(const streamId id, const bool bufChanged)
 
 void outputStream_stop(const streamId id)
 {
-    (void) id;
+    if(id == RTX_STREAM_ID)
+    {
+        rtx_stop();
+        return;
+    }
 
     int error = 0;
-    if (pa_simple_flush(paInstance, &error) < 0)
+    if ((paInstance != NULL) && pa_simple_flush(paInstance, &error) < 0)
     {
         fprintf(stderr, __FILE__": pa_simple_drain() failed: %s\n",
                 pa_strerror(error));
@@ -258,7 +414,11 @@ void outputStream_stop(const streamId id)
 
 void outputStream_terminate(const streamId id)
 {
-    (void) id;
+    if(id == RTX_STREAM_ID)
+    {
+        rtx_stop();
+        return;
+    }
 
     running  = false;
     priority = PRIO_BEEP;
@@ -0,0 +1,320 @@
+/***************************************************************************
+ *   Copyright (C) 2023 by Federico Amedeo Izzo IU2NUO,                    *
+ *                         Niccolò Izzo IU2KIN                             *
+ *                         Frederik Saraci IU2NRO                          *
+ *                         Silvano Seva IU2KWO                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+#include <baseband_linux.h>
+#include <ringbuf.hpp>
+#include <fir.hpp>
+#include <sys/stat.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <limits.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
+
+/*
+ * Half-band low pass filter for the decimation from 48kHz to 24kHz, 23 taps
+ * Hamming windowed sinc with cutoff at 12kHz.
+ */
+static constexpr std::array< float, 23 > halfBandTaps =
+{
+    -0.00232010f, 0.00000000f,  0.00542406f, 0.00000000f, -0.01590096f,
+     0.00000000f, 0.03863029f,  0.00000000f, -0.08945522f, 0.00000000f,
+     0.31306928f, 0.50110528f,  0.31306928f, 0.00000000f, -0.08945522f,
+     0.00000000f, 0.03863029f,  0.00000000f, -0.01590096f, 0.00000000f,
+     0.00542406f, 0.00000000f, -0.00232010f
+};
+
+static constexpr auto halfBandQ15 = toQ15(halfBandTaps);
+
+/*
+ * Samples exchanged in a single write to a named pipe, small enough for the
+ * write to be atomic. Since all the writes and reads have an even size, no
+ * sample is ever split in two.
+ */
+static constexpr size_t PIPE_CHUNK = PIPE_BUF / sizeof(stream_sample_t);
+
+static pthread_once_t initOnce = PTHREAD_ONCE_INIT;
+static bool           loopback = false;            // In-process loopback
+static const char    *outPath  = "/tmp/m17_output.raw";
+static const char    *inPath   = NULL;
+static FILE          *outFile  = NULL;             // Output, regular file
+static int            outPipe  = -1;               // Output, named pipe
+static int            inFd     = -1;               // Input, file or pipe
+
+/*
+ * Loopback buffer, large enough to hold a whole transmission while the
+ * receiver is turned off. Samples are counted on both sides, so that the
+ * receiver can skip those sent before the start of the last transmission.
+ */
+static SpscRingBuffer< stream_sample_t, 1048576 > loopBuf;  // 21.8s at 48kHz
+static std::atomic< size_t > loopWritten(0);              // Producer side
+static std::atomic< size_t > loopTxStart(0);              // Producer side
+static size_t                loopRead = 0;                // Consumer side
+static FirQ15< halfBandQ15.size() >             decimator(halfBandQ15);
+
+
+static void init()
+{
+    const char *env = getenv("OPENRTX_BASEBAND");
+    if((env != NULL) && (strcmp(env, "loop") == 0))
+        loopback = true;
+
+    env = getenv("OPENRTX_BASEBAND_OUT");
+    if(env != NULL)
+        outPath = env;
+
+    inPath = getenv("OPENRTX_BASEBAND_IN");
+}
+
+/**
+ * \internal
+ * Create a named pipe, if the given path does not exist.
+ *
+ * @return true if the path corresponds to a named pipe.
+ */
+static bool makeFifo(const char *path)
+{
+    struct stat st;
+    if(stat(path, &st) == 0)
+        return S_ISFIFO(st.st_mode);
+
+    if(mkfifo(path, 0644) < 0)
+    {
+        fprintf(stderr, "Baseband error: cannot create %s: %s\n", path,
+                strerror(errno));
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * \internal
+ * Open the output, if not already open. A named pipe can be opened only once
+ * its reader is present, thus the opening is retried at every write.
+ */
+static bool openOutput()
+{
+    if((outFile != NULL) || (outPipe >= 0))
+        return true;
+
+    // Default output file, appended for compatibility with existing tools
+    if(getenv("OPENRTX_BASEBAND_OUT") == NULL)
+    {
+        outFile = fopen(outPath, "ab");
+        return outFile != NULL;
+    }
+
+    if(makeFifo(outPath) == false)
+    {
+        outFile = fopen(outPath, "wb");
+        return outFile != NULL;
+    }
+
+    outPipe = open(outPath, O_WRONLY | O_NONBLOCK);
+    if(outPipe < 0)
+        return false;
+
+    // A reader leaving the pipe has to be detected as a write error
+    signal(SIGPIPE, SIG_IGN);
+    return true;
+}
+
+static void writePipe(const stream_sample_t *samples, size_t length)
+{
+    while(length > 0)
+    {
+        size_t  chunk = (length > PIPE_CHUNK) ? PIPE_CHUNK : length;
+        ssize_t ret   = write(outPipe, samples, chunk * sizeof(stream_sample_t));
+
+        if(ret < 0)
+        {
+            // Reader gone: reopen at next write. Pipe full: drop samples.
+            if(errno == EPIPE)
+            {
+                close(outPipe);
+                outPipe = -1;
+            }
+
+            return;
+        }
+
+        samples += chunk;
+        length  -= chunk;
+    }
+}
+
+/**
+ * \internal
+ * Get samples at the bus sample rate, from the loopback buffer or from the
+ * input file.
+ */
+static size_t readBus(stream_sample_t *samples, const size_t length)
+{
+    if(loopback)
+    {
+        size_t num = loopBuf.pop(samples, length);
+        loopRead  += num;
+        return num;
+    }
+
+    ssize_t ret = read(inFd, samples, length * sizeof(stream_sample_t));
+    if(ret <= 0)
+        return 0;
+
+    return ret / sizeof(stream_sample_t);
+}
+
+
+bool baseband_openRx()
+{
+    pthread_once(&initOnce, init);
+
+    decimator.reset();
+
+    if(loopback)
+    {
+        // Drop what is left of the previous transmissions
+        size_t start = loopTxStart.load(std::memory_order_acquire);
+        while(loopRead < start)
+        {
+            stream_sample_t tmp[256];
+            size_t num = start - loopRead;
+            if(num > 256) num = 256;
+
+            num       = loopBuf.pop(tmp, num);
+            loopRead += num;
+            if(num == 0)
+                break;
+        }
+
+        return true;
+    }
+
+    if(inPath == NULL)
+        return false;
+
+    if(inFd < 0)
+    {
+        makeFifo(inPath);
+
+        inFd = open(inPath, O_RDONLY | O_NONBLOCK);
+        if(inFd < 0)
+        {
+            fprintf(stderr, "Baseband error: cannot open %s: %s\n", inPath,
+                    strerror(errno));
+            return false;
+        }
+    }
+
+    // Discard what has been sent before the receiver was turned on
+    struct stat st;
+    if((fstat(inFd, &st) == 0) && S_ISFIFO(st.st_mode))
+    {
+        stream_sample_t tmp[256];
+        while(read(inFd, tmp, sizeof(tmp)) > 0) ;
+    }
+
+    return true;
+}
+
+size_t baseband_read(stream_sample_t *samples, const size_t length,
+                     const uint32_t sampleRate)
+{
+    size_t received = 0;
+
+    if(sampleRate == BASEBAND_SAMPLE_RATE)
+    {
+        received = readBus(samples, length);
+    }
+    else if(sampleRate == (BASEBAND_SAMPLE_RATE / 2))
+    {
+        // Decimate by two, the missing input samples are replaced by zeroes
+        // before filtering.
+        stream_sample_t tmp[256];
+        size_t pos = 0;
+
+        while(pos < length)
+        {
+            size_t num = length - pos;
+            if(num > 128) num = 128;
+
+            size_t got = readBus(tmp, 2 * num);
+            if(got < (2 * num))
+                memset(&tmp[got], 0x00, ((2 * num) - got) * sizeof(stream_sample_t));
+
+            for(size_t i = 0; i < num; i++)
+            {
+                decimator(tmp[2 * i]);
+                samples[pos + i] = decimator(tmp[(2 * i) + 1]);
+            }
+
+            received += got / 2;
+            pos      += num;
+        }
+
+        return received;
+    }
+
+    if(received < length)
+        memset(&samples[received], 0x00, (length - received) * sizeof(stream_sample_t));
+
+    return received;
+}
+
+void baseband_openTx()
+{
+    pthread_once(&initOnce, init);
+
+    if(loopback)
+        loopTxStart.store(loopWritten.load(std::memory_order_relaxed),
+                          std::memory_order_release);
+}
+
+void baseband_write(const stream_sample_t *samples, const size_t length)
+{
+    pthread_once(&initOnce, init);
+
+    if(loopback)
+    {
+        size_t num = loopBuf.push(samples, length);
+        loopWritten.fetch_add(num, std::memory_order_relaxed);
+        return;
+    }
+
+    if(openOutput() == false)
+        return;
+
+    if(outPipe >= 0)
+        writePipe(samples, length);
+    else
+        fwrite(samples, sizeof(stream_sample_t), length, outFile);
+}
+
+void baseband_flush()
+{
+    if(outFile != NULL)
+        fflush(outFile);
+}
@@ -0,0 +1,108 @@
+/***************************************************************************
+ *   Copyright (C) 2023 by Federico Amedeo Izzo IU2NUO,                    *
+ *                         Niccolò Izzo IU2KIN                             *
+ *                         Frederik Saraci IU2NRO                          *
+ *                         Silvano Seva IU2KWO                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+#ifndef BASEBAND_LINUX_H
+#define BASEBAND_LINUX_H
+
+#include <interfaces/audio_stream.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Baseband bus of the Linux emulator, connecting the transmitted baseband
+ * (output stream towards SINK_RTX) to the received one (input stream from
+ * SOURCE_RTX). The bus runs at BASEBAND_SAMPLE_RATE, receivers can read it at
+ * the same rate or at half of it. Its endpoints are selected with the
+ * following environment variables:
+ *
+ * - OPENRTX_BASEBAND=loop: the transmitted baseband is looped back to the
+ *   receiver of the same process. The last transmission is kept until the
+ *   receiver reads it, so that it can be received also when the receiver is
+ *   turned off while transmitting.
+ * - OPENRTX_BASEBAND_OUT=<path>: the transmitted baseband is written to the
+ *   given file or named pipe, which is created if not existing. Default is
+ *   appending it to /tmp/m17_output.raw.
+ * - OPENRTX_BASEBAND_IN=<path>: the received baseband is read from the given
+ *   file or named pipe, which is created if not existing. When not set, the
+ *   receiver reads the RTX.raw file.
+ *
+ * Two emulator instances can exchange baseband through a couple of named pipes,
+ * with the OUT path of one of them being the IN path of the other one.
+ * Samples are 16 bit signed integers in host byte order.
+ */
+
+/**
+ * Sample rate of the baseband bus, in Hz.
+ */
+#define BASEBAND_SAMPLE_RATE 48000
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Start receiving from the baseband bus. Samples transmitted before this call
+ * are discarded, except for the unread ones of the last transmission when in
+ * loopback mode.
+ *
+ * @return true if the receiver is connected to the bus, false if the received
+ * baseband has to be taken from elsewhere.
+ */
+bool baseband_openRx();
+
+/**
+ * Read samples from the baseband bus, without blocking. When less samples than
+ * requested are available, the remaining part of the buffer is filled with
+ * zeroes, as a receiver tuned to a free channel would do.
+ *
+ * @param samples: destination buffer.
+ * @param length: number of samples to be read.
+ * @param sampleRate: sample rate of the receiver, either BASEBAND_SAMPLE_RATE
+ * or half of it.
+ * @return number of samples effectively received from the bus.
+ */
+size_t baseband_read(stream_sample_t *samples, const size_t length,
+                     const uint32_t sampleRate);
+
+/**
+ * Mark the start of a new transmission on the baseband bus.
+ */
+void baseband_openTx();
+
+/**
+ * Write samples to the baseband bus, without blocking. Samples not fitting
+ * in the bus are dropped.
+ *
+ * @param samples: samples to be transmitted, at BASEBAND_SAMPLE_RATE.
+ * @param length: number of samples.
+ */
+void baseband_write(const stream_sample_t *samples, const size_t length);
+
+/**
+ * Flush the transmitted samples to their destination, to be called at the
+ * end of a transmission.
+ */
+void baseband_flush();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BASEBAND_LINUX_H */
@@ -510,6 +510,21 @@ void display_renderRows(uint8_t startRow, uint8_t endRow)
             }
         } while(lcdWaiting);
     }
+
+    /*
+     * Convert the pixels back to little endian: the framebuffer content is
+     * preserved across renders, since only the rows modified by the UI are
+     * sent again.
+     */
+    for(uint8_t y = startRow; y < endRow; y++)
+    {
+        for(uint8_t x = 0; x < SCREEN_WIDTH; x++)
+        {
+            size_t pos = x + y * SCREEN_WIDTH;
+            uint16_t pixel = frameBuffer[pos];
+            frameBuffer[pos] = __builtin_bswap16(pixel);
+        }
+    }
 }
 
 void display_render()
@@ -27,7 +27,7 @@
 
 #include <interfaces/display.h>
 #include <emulator/sdl_engine.h>
-#include <chan.h>
+#include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <SDL2/SDL.h>
@@ -35,48 +35,6 @@
 void *frameBuffer = NULL;    /* Pointer to framebuffer */
 bool inProgress;             /* Flag to signal when rendering is in progress */
 
-/*
- * SDL main loop syncronization
- */
-bool sdl_ready = false;      /* Flag to signal the sdl main loop is running */
-extern chan_t fb_sync;       /* Shared channel to send a frame buffer update */
-
-/**
- * @internal
- * Internal helper function which fetches pixel at position (x, y) from framebuffer
- * and returns it in SDL-compatible format, which is ARGB8888.
- */
-uint32_t fetchPixelFromFb(unsigned int x, unsigned int y)
-{
-    (void) x;
-    (void) y;
-    uint32_t pixel = 0;
-
-    #ifdef PIX_FMT_BW
-    /*
-     * Black and white 1bpp format: framebuffer is an array of uint8_t, where
-     * each cell contains the values of eight pixels, one per bit.
-     */
-    uint8_t *fb = (uint8_t *)(frameBuffer);
-    unsigned int cell = (x + y*SCREEN_WIDTH) / 8;
-    unsigned int elem = (x + y*SCREEN_WIDTH) % 8;
-    if(fb[cell] & (1 << elem)) pixel = 0xFFFFFFFF;
-    #endif
-
-    #ifdef PIX_FMT_GRAYSC
-    /*
-     * Convert from 8bpp grayscale to ARGB8888, we have to do nothing more that
-     * replicating the pixel value for the three components
-     */
-    uint8_t *fb = (uint8_t *)(frameBuffer);
-    uint8_t px = fb[x + y*SCREEN_WIDTH];
-
-    pixel = 0xFF000000 | (px << 16) | (px << 8) | px;
-    #endif
-
-    return pixel;
-}
-
 
 void display_init()
 {
@@ -116,44 +74,18 @@ void display_init()
 void display_terminate()
 {
     while (inProgress){ }         /* Wait until current render finishes */
-    chan_close(&fb_sync);
-    chan_terminate(&fb_sync);
     if(frameBuffer != NULL) free(frameBuffer);
     frameBuffer = NULL;
 }
 
 void display_renderRows(uint8_t startRow, uint8_t endRow)
 {
-    (void) startRow;
-    (void) endRow;
+    /*
+     * Rows are handed over to the SDL main loop, which converts and draws them
+     * asynchronously: rendering never stalls the caller.
+     */
     inProgress = true;
-    if(!sdl_ready)
-    {
-        sdl_ready = sdlEngine_ready();
-    }
-
-    if(sdl_ready)
-    {
-        // receive a texture pixel map
-        void *fb;
-        chan_recv(&fb_sync, &fb);
-        #ifdef PIX_FMT_RGB565
-        memcpy(fb, frameBuffer, sizeof(PIXEL_SIZE) * SCREEN_HEIGHT * SCREEN_WIDTH);
-        #else
-        uint32_t *pixels = (uint32_t *) fb;
-        for (unsigned int x = 0; x < SCREEN_WIDTH; x++)
-        {
-            for (unsigned int y = startRow; y < endRow; y++)
-            {
-                pixels[x + y * SCREEN_WIDTH] = fetchPixelFromFb(x, y);
-            }
-        }
-        #endif
-        // signal the SDL main loop to proceed with rendering
-        void *done = {0};
-        chan_send(&fb_sync, done);
-    }
-
+    sdlEngine_updateRows(frameBuffer, startRow, endRow);
     inProgress = false;
 }
 
@@ -16,22 +16,27 @@
  ***************************************************************************/
 
 #include <interfaces/delays.h>
+#include <virtual_clock.h>
 #include <sys/time.h>
 #include <unistd.h>
 #include <stdio.h>
 
 /**
- * Implementation of the delay functions for x86_64.
+ * Implementation of the delay functions for x86_64. When the emulator runs in
+ * virtual time, delays and system tick follow the virtual clock.
  */
 
 void delayUs(unsigned int useconds)
 {
-    usleep(useconds);
+    if(vclock_enabled())
+        vclock_sleepUntil(vclock_now() + useconds);
+    else
+        usleep(useconds);
 }
 
 void delayMs(unsigned int mseconds)
 {
-    usleep(mseconds*1000);
+    delayUs(mseconds*1000);
 }
 
 void sleepFor(unsigned int seconds, unsigned int mseconds)
@@ -42,6 +47,14 @@ void sleepFor(unsigned int seconds, unsigned int mseconds)
 
 void sleepUntil(long long timestamp)
 {
+    if(vclock_enabled())
+    {
+        if(timestamp > 0)
+            vclock_sleepUntil(timestamp * 1000ULL);
+
+        return;
+    }
+
     long long delta = timestamp - getTick();
     if(delta <= 0) return;
     delayMs(delta);
@@ -54,6 +67,9 @@ long long getTick()
      * having a tick rate of 1kHz.
      */
 
+    if(vclock_enabled())
+        return vclock_now() / 1000;
+
     struct timeval te;
     gettimeofday(&te, NULL);
     long long milliseconds = te.tv_sec*1000LL + te.tv_usec/1000;
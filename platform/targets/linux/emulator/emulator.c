@@ -28,8 +28,12 @@
 #include <readline/readline.h>
 #include <readline/history.h>
 
+#include <interfaces/delays.h>
+#include <profiling.h>
 #include "emulator.h"
 #include "sdl_engine.h"
+#include "virtual_clock.h"
+#include "snapshot.h"
 
 /* Custom SDL Event to request a screenshot */
 extern Uint32 SDL_Screenshot_Event;
@@ -42,9 +46,12 @@ emulator_state_t emulator_state =
     4,        // volume level
     1,        // chSelector
     false,    // PTT status
-    false     // power off
+    false,    // power off
+    false     // headless
 };
 
+static int failedChecks = 0;    // Number of failed shell checks
+
 typedef int (*_climenu_fn)(void *self, int argc, char **argv);
 
 typedef struct
@@ -118,7 +125,7 @@ static int shell_ready(void *_self, int _argc, char **_argv)
 
     while(_skq_in > _skq_out)
     {
-        usleep(10 * 1000); //sleep until keyboard is caught up
+        sleepFor(0u, 10u); //sleep until keyboard is caught up
     }
     return SH_CONTINUE;
 }
@@ -248,6 +255,32 @@ static int pressMultiKeys(void *_self, int _argc, char **_argv)
 //     return SH_CONTINUE; // continue
 // }
 
+static int saveFrame(const char *filename)
+{
+    static uint32_t frame[SCREEN_WIDTH * SCREEN_HEIGHT];
+    char name[256];
+
+    // Frames are saved as PNG, also when a BMP file name is given
+    size_t len = strlen(filename);
+    if((len > 4) && (strcasecmp(filename + len - 4, ".bmp") == 0))
+        snprintf(name, sizeof(name), "%.*s.png", (int) (len - 4), filename);
+    else
+        snprintf(name, sizeof(name), "%s", filename);
+
+    sdlEngine_getFrame(frame);
+    if(snapshot_savePNG(name, frame, SCREEN_WIDTH, SCREEN_HEIGHT) < 0)
+    {
+        printf("Cannot save %s\n", name);
+        return SH_ERR;
+    }
+
+    uint64_t hash = snapshot_hash(frame, SCREEN_WIDTH, SCREEN_HEIGHT);
+    printf("Saved frame to \"%s\", hash %016llx\n", name,
+           (unsigned long long) hash);
+
+    return SH_CONTINUE;
+}
+
 static int screenshot(void *_self, int _argc, char **_argv)
 {
     (void) _self;
@@ -258,15 +291,44 @@ static int screenshot(void *_self, int _argc, char **_argv)
         filename = _argv[0];
     }
 
+    // Without a window the frame is saved straight from memory
+    if(emulator_state.headless)
+    {
+        return saveFrame(filename);
+    }
+
     SDL_Event e;
     SDL_zero(e);
     e.type = SDL_Screenshot_Event;
-    e.user.data1 = malloc(sizeof(filename));
+    e.user.data1 = malloc(strlen(filename) + 1);
     strcpy(e.user.data1, filename);
 
     return SDL_PushEvent(&e) == 1 ? SH_CONTINUE : SH_ERR;
 }
 
+static int frameHash(void *_self, int _argc, char **_argv)
+{
+    (void) _self;
+    static uint32_t frame[SCREEN_WIDTH * SCREEN_HEIGHT];
+
+    sdlEngine_getFrame(frame);
+    uint64_t hash = snapshot_hash(frame, SCREEN_WIDTH, SCREEN_HEIGHT);
+    printf("Frame hash: %016llx\n", (unsigned long long) hash);
+
+    if(_argc && _argv[0] != NULL)
+    {
+        uint64_t expected = strtoull(_argv[0], NULL, 16);
+        if(hash != expected)
+        {
+            printf("Frame hash mismatch, expected %s\n", _argv[0]);
+            failedChecks++;
+            return SH_ERR;
+        }
+    }
+
+    return SH_CONTINUE;
+}
+
 static int setFloat(void *_self, int _argc, char **_argv)
 {
     _climenu_option *self = (_climenu_option *) _self;
@@ -305,8 +367,8 @@ static int shell_sleep(void *_self, int _argc, char **_argv)
         return SH_ERR;
     }
 
-    useconds_t sleepus = atoi(_argv[0]) * 1000;
-    usleep(sleepus);
+    // Scripted sleeps follow the virtual clock, when enabled
+    sleepFor(0u, atoi(_argv[0]));
     return SH_CONTINUE;
 }
 
@@ -336,6 +398,45 @@ static int printState( void *_self, int _argc, char **_argv)
     return SH_CONTINUE;
 }
 
+static int printProfile(void *_self, int _argc, char **_argv)
+{
+    (void) _self;
+
+    #ifndef ENABLE_PROFILING
+    (void) _argc;
+    (void) _argv;
+    printf("Profiling not enabled\n");
+    return SH_ERR;
+    #else
+    if(_argc && (_argv[0] != NULL) && (strcmp(_argv[0], "reset") == 0))
+    {
+        prof_reset();
+        return SH_CONTINUE;
+    }
+
+    printf("\nExecution times [us]\n");
+    printf("%-12s %8s %8s %8s %8s   histogram <32us ... >8ms\n",
+           "Probe", "count", "min", "avg", "max");
+
+    for(int i = 0; i < PROF_NUM_PROBES; i++)
+    {
+        profStats_t stats;
+        prof_getStats((enum ProfProbe) i, &stats);
+
+        printf("%-12s %8u %8u %8u %8u  ", prof_getName((enum ProfProbe) i),
+               stats.count, stats.min, stats.avg, stats.max);
+
+        for(int j = 0; j < PROF_HIST_BINS; j++)
+            printf(" %u", stats.hist[j]);
+
+        printf("\n");
+    }
+
+    printf("\n");
+    return SH_CONTINUE;
+    #endif
+}
+
 static int shell_nop( void *_self, int _argc, char **_argv)
 {
     (void) _self;
@@ -345,8 +446,9 @@ static int shell_nop( void *_self, int _argc, char **_argv)
     return SH_CONTINUE;
 }
 
-// Forward declaration needed to include function pointer in the table below
+// Forward declarations needed to include function pointers in the table below
 static int shell_help( void *_self, int _argc, char **_argv);
+static int shell_run( void *_self, int _argc, char **_argv);
 
 static _climenu_option _options[] =
 {
@@ -362,11 +464,18 @@ static _climenu_option _options[] =
     },
     {"keycombo", "Press a bunch of keys simultaneously", NULL, pressMultiKeys },
     {"show",     "Show current radio state (ptt, rssi, etc)", NULL, printState},
-    {"screenshot", "[screenshot.bmp] Save screenshot to first arg or screenshot.bmp if none given",
+    {"profile",  "[reset] Show the execution time of the radio tasks or clear them",
+                                NULL,   printProfile
+    },
+    {"screenshot", "[screenshot.bmp] Save screenshot to first arg or screenshot.bmp if none given, as PNG when headless",
                                 NULL,   screenshot
     },
     {"sleep",   "Wait some number of ms",           NULL,   shell_sleep },
     {"help",    "Print this help",                  NULL,   shell_help },
+    {"hash",    "[expected] Print the hash of the last rendered frame, fail if it differs from the expected one",
+                                NULL,   frameHash
+    },
+    {"run",     "Run the commands contained in a script file, one per line", NULL, shell_run },
     {"nop",     "Do nothing (useful for comments)", NULL,   shell_nop},
     {"quit",    "Quit, close the emulator",         NULL,   shell_quit },
     /*{"ready",     */
@@ -474,18 +583,65 @@ static int process_line(char *line)
     }
 }
 
+static int shell_run(void *_self, int _argc, char **_argv)
+{
+    (void) _self;
+
+    if(! _argc || _argv[0] == NULL)
+    {
+        printf("Provide the name of the script file as an argument\n");
+        return SH_ERR;
+    }
+
+    FILE *script = fopen(_argv[0], "r");
+    if(script == NULL)
+    {
+        printf("Cannot open %s\n", _argv[0]);
+        return SH_ERR;
+    }
+
+    char line[256];
+    int  ret = SH_CONTINUE;
+
+    while((ret != SH_EXIT_OK) && (emulator_state.powerOff == false) &&
+          (fgets(line, sizeof(line), script) != NULL))
+    {
+        // Skip empty lines and comments
+        striptoken(line);
+        if((line[0] == '\0') || (line[0] == '#'))
+            continue;
+
+        printf(">%s\n", line);
+        ret = process_line(line);
+
+        if(ret == SH_WHAT)
+            printf("?\n");
+        else if(ret == SH_ERR)
+            printf("Error running that command\n");
+    }
+
+    fclose(script);
+    return (ret == SH_EXIT_OK) ? SH_EXIT_OK : SH_CONTINUE;
+}
+
 void *startCLIMenu()
 {
     printf("\n\n");
     char *histfile = ".emulatorsh_history";
     shell_help(NULL, 0, NULL);
     int ret = SH_CONTINUE;
+    bool interactive = isatty(STDIN_FILENO);
     using_history();
     read_history(histfile);
 
     do
     {
+        // Let the virtual time run while waiting for the user to type the
+        // next command. Scripts piped to the shell are instead read without
+        // letting the time advance, for reproducible runs.
+        if(interactive) vclock_idle();
         char *r = readline(">");
+        vclock_busy();
 
         if(r == NULL)
         {
@@ -543,8 +699,14 @@ void *startCLIMenu()
 
 void emulator_start()
 {
+    const char *env = getenv("OPENRTX_HEADLESS");
+    emulator_state.headless = (env != NULL) && (strcmp(env, "1") == 0);
+
     sdlEngine_init();
 
+    if(vclock_enabled())
+        printf("Running in virtual time\n");
+
     pthread_t cli_thread;
     int err = pthread_create(&cli_thread, NULL, startCLIMenu, NULL);
 
@@ -570,3 +732,8 @@ keyboard_t emulator_getKeys()
         return 0; //no keys
     }
 }
+
+int emulator_failedChecks()
+{
+    return failedChecks;
+}
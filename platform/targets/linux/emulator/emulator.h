@@ -45,6 +45,15 @@ enum choices
     EXIT
 };
 
+/*
+ * Setting the environment variable OPENRTX_HEADLESS=1 runs the emulator
+ * without a display window: frames are only kept in memory and the shell
+ * commands can save them as PNG images or check their hash against golden
+ * values. Together with the virtual time (OPENRTX_VIRTUAL_TIME=1) it allows
+ * to replay UI test scripts as fast as possible, see the "run" and "hash"
+ * shell commands.
+ */
+
 typedef struct
 {
     float RSSI;
@@ -54,6 +63,7 @@ typedef struct
     float chSelector;
     bool  PTTstatus;
     bool  powerOff;
+    bool  headless;
 }
 emulator_state_t;
 
@@ -63,4 +73,12 @@ void emulator_start();
 
 keyboard_t emulator_getKeys();
 
+/**
+ * Get the number of checks failed while running the shell commands, for
+ * instance frame hashes not matching the expected value.
+ *
+ * @return number of failed checks.
+ */
+int emulator_failedChecks();
+
 #endif /* EMULATOR_H */
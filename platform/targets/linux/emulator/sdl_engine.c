@@ -16,12 +16,12 @@
  ***************************************************************************/
 
 #include <stdlib.h>
+#include <string.h>
 #include <pthread.h>
 #include <state.h>
 #include "sdl_engine.h"
 #include "emulator.h"
 
-chan_t fb_sync;                 // Shared channel to receive frame buffer updates
 Uint32 SDL_Screenshot_Event;    // Shared custom SDL event to request a screenshot
 Uint32 SDL_Backlight_Event;     // Shared custom SDL event to change backlight
 
@@ -32,6 +32,24 @@ static SDL_Texture  *displayTexture;
 static bool       ready = false;  // Signal if the main loop is ready
 static keyboard_t sdl_keys;       // Store the keyboard status
 
+/*
+ * Framebuffer handoff between the display driver and the main loop: the
+ * driver copies the updated rows in the back buffer and returns immediately,
+ * the main loop moves them to the front buffer and converts them into the
+ * display texture without holding the lock.
+ */
+#ifdef PIX_FMT_RGB565
+#define FB_SIZE (SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(uint16_t))
+#else
+#define FB_SIZE (((SCREEN_WIDTH * SCREEN_HEIGHT) + 7) / 8)
+#endif
+
+static uint8_t         backBuffer[FB_SIZE];
+static uint8_t         frontBuffer[FB_SIZE];
+static pthread_mutex_t fbMutex    = PTHREAD_MUTEX_INITIALIZER;
+static int             dirtyStart = SCREEN_HEIGHT;   // Rows to be converted,
+static int             dirtyEnd   = 0;               // end excluded
+
 
 static bool sdk_key_code_to_key(SDL_Keycode sym, keyboard_t *key)
 {
@@ -248,6 +266,110 @@ cleanup:
     return err;
 }
 
+/**
+ * \internal
+ * Compute the range of framebuffer bytes holding a range of rows.
+ */
+static inline void fbRowBytes(int startRow, int endRow, size_t *first,
+                              size_t *last)
+{
+    #ifdef PIX_FMT_RGB565
+    *first = startRow * SCREEN_WIDTH * sizeof(uint16_t);
+    *last  = endRow   * SCREEN_WIDTH * sizeof(uint16_t);
+    #else
+    *first = (startRow * SCREEN_WIDTH) / 8;
+    *last  = ((endRow * SCREEN_WIDTH) + 7) / 8;
+    #endif
+}
+
+/**
+ * \internal
+ * Convert a range of rows of the front buffer to the texture pixel format.
+ *
+ * @param pixels: pointer to the first texture row to be written.
+ * @param pitch: length of a texture row, in bytes.
+ * @param startRow: first row to be converted.
+ * @param endRow: row following the last one to be converted.
+ */
+static void convertRows(void *pixels, int pitch, int startRow, int endRow)
+{
+    uint8_t *dst = (uint8_t *) pixels;
+
+    for(int y = startRow; y < endRow; y++, dst += pitch)
+    {
+        #ifdef PIX_FMT_RGB565
+        // Same format as the texture, copy the whole row
+        memcpy(dst, frontBuffer + (y * SCREEN_WIDTH * sizeof(uint16_t)),
+               SCREEN_WIDTH * sizeof(uint16_t));
+        #else
+        /*
+         * Black and white 1bpp format: each byte holds eight pixels, one per
+         * bit starting from the LSB. Set pixels become white, the whole bytes
+         * are expanded without branches.
+         */
+        uint32_t *px  = (uint32_t *) dst;
+        size_t    bit = y * SCREEN_WIDTH;
+        size_t    end = bit + SCREEN_WIDTH;
+
+        for(; ((bit % 8) != 0) && (bit < end); bit++)
+            *px++ = 0u - ((frontBuffer[bit / 8] >> (bit % 8)) & 0x01);
+
+        for(; (bit + 8) <= end; bit += 8, px += 8)
+        {
+            uint8_t cell = frontBuffer[bit / 8];
+            for(uint8_t i = 0; i < 8; i++)
+                px[i] = 0u - ((cell >> i) & 0x01);
+        }
+
+        for(; bit < end; bit++)
+            *px++ = 0u - ((frontBuffer[bit / 8] >> (bit % 8)) & 0x01);
+        #endif
+    }
+}
+
+/**
+ * \internal
+ * Take the rows updated since the last call from the back buffer and draw
+ * them on the screen.
+ */
+static void update_display()
+{
+    pthread_mutex_lock(&fbMutex);
+
+    int startRow = dirtyStart;
+    int endRow   = dirtyEnd;
+    if(startRow < endRow)
+    {
+        size_t first, last;
+        fbRowBytes(startRow, endRow, &first, &last);
+        memcpy(frontBuffer + first, backBuffer + first, last - first);
+
+        dirtyStart = SCREEN_HEIGHT;
+        dirtyEnd   = 0;
+    }
+
+    pthread_mutex_unlock(&fbMutex);
+
+    if(startRow >= endRow)
+        return;
+
+    SDL_Rect rows = {0, startRow, SCREEN_WIDTH, endRow - startRow};
+    void    *pixels;
+    int      pitch = 0;
+
+    if (SDL_LockTexture(displayTexture, &rows, &pixels, &pitch) < 0)
+    {
+        SDL_Log("SDL_lock failed: %s", SDL_GetError());
+        return;
+    }
+
+    convertRows(pixels, pitch, startRow, endRow);
+
+    SDL_UnlockTexture(displayTexture);
+    SDL_RenderCopy(renderer, displayTexture, NULL, NULL);
+    SDL_RenderPresent(renderer);
+}
+
 static bool set_brightness(uint8_t brightness)
 {
     /*
@@ -274,7 +396,12 @@ static bool set_brightness(uint8_t brightness)
 
 void sdlEngine_init()
 {
-    if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_EVENTS) < 0)
+    // In headless mode only the event queue is used, no window is created
+    Uint32 flags = SDL_INIT_EVENTS;
+    if (!emulator_state.headless)
+        flags |= SDL_INIT_VIDEO;
+
+    if (SDL_Init(flags) < 0)
     {
         printf("SDL video init error!!\n");
         exit(1);
@@ -284,7 +411,11 @@ void sdlEngine_init()
     SDL_Screenshot_Event = SDL_RegisterEvents(2);
     SDL_Backlight_Event = SDL_Screenshot_Event+1;
 
-    chan_init(&fb_sync);
+    if (emulator_state.headless)
+    {
+        printf("Running headless, no display window\n");
+        return;
+    }
 
     window = SDL_CreateWindow("OpenRTX",
                               SDL_WINDOWPOS_UNDEFINED,
@@ -349,37 +480,32 @@ void sdlEngine_run()
             }
             else if (ev.type == SDL_Backlight_Event)
             {
-                set_brightness(*((uint8_t*)ev.user.data1));
+                if (!emulator_state.headless)
+                    set_brightness(*((uint8_t*)ev.user.data1));
                 free(ev.user.data1);
             }
         }
 
-        // we update the window only if there is a something ready to render
-        if (chan_can_send(&fb_sync))
+        // Frames are only kept in memory when running headless
+        if (emulator_state.headless)
         {
-            PIXEL_SIZE *pixels;
-            int pitch = 0;
-
-            if (SDL_LockTexture(displayTexture, NULL,
-                                (void **) &pixels, &pitch) < 0)
-            {
-                SDL_Log("SDL_lock failed: %s", SDL_GetError());
-            }
-
-            chan_send(&fb_sync, pixels);
-            chan_recv(&fb_sync, NULL);
-
-            SDL_UnlockTexture(displayTexture);
-            SDL_RenderCopy(renderer, displayTexture, NULL, NULL);
-            SDL_RenderPresent(renderer);
+            SDL_Delay(5);
+            continue;
         }
+
+        // we update the window only if there is a something ready to render
+        update_display();
     }
 
     printf("Terminating SDL display emulator, goodbye!\n");
 
-    SDL_DestroyTexture(displayTexture);
-    SDL_DestroyRenderer(renderer);
-    SDL_DestroyWindow(window);
+    if (!emulator_state.headless)
+    {
+        SDL_DestroyTexture(displayTexture);
+        SDL_DestroyRenderer(renderer);
+        SDL_DestroyWindow(window);
+    }
+
     SDL_Quit();
 }
 
@@ -392,6 +518,53 @@ bool sdlEngine_ready()
     return ready;
 }
 
+void sdlEngine_updateRows(const void *fb, uint8_t startRow, uint8_t endRow)
+{
+    if(endRow > SCREEN_HEIGHT) endRow = SCREEN_HEIGHT;
+    if(startRow >= endRow) return;
+
+    size_t first, last;
+    fbRowBytes(startRow, endRow, &first, &last);
+
+    pthread_mutex_lock(&fbMutex);
+
+    memcpy(backBuffer + first, ((const uint8_t *) fb) + first, last - first);
+    if(startRow < dirtyStart) dirtyStart = startRow;
+    if(endRow   > dirtyEnd)   dirtyEnd   = endRow;
+
+    pthread_mutex_unlock(&fbMutex);
+}
+
+void sdlEngine_getFrame(uint32_t *pixels)
+{
+    static uint8_t frame[FB_SIZE];
+
+    pthread_mutex_lock(&fbMutex);
+    memcpy(frame, backBuffer, FB_SIZE);
+    pthread_mutex_unlock(&fbMutex);
+
+    for(size_t i = 0; i < (SCREEN_WIDTH * SCREEN_HEIGHT); i++)
+    {
+        #ifdef PIX_FMT_RGB565
+        uint16_t px;
+        memcpy(&px, &frame[i * sizeof(uint16_t)], sizeof(px));
+
+        // Expand to eight bits per channel, replicating the upper bits
+        uint32_t r = (px >> 11) & 0x1F;
+        uint32_t g = (px >> 5)  & 0x3F;
+        uint32_t b =  px        & 0x1F;
+        r = (r << 3) | (r >> 2);
+        g = (g << 2) | (g >> 4);
+        b = (b << 3) | (b >> 2);
+
+        pixels[i] = 0xFF000000 | (r << 16) | (g << 8) | b;
+        #else
+        // Same colours used for the display texture
+        pixels[i] = 0u - ((frame[i / 8] >> (i % 8)) & 0x01);
+        #endif
+    }
+}
+
 keyboard_t sdlEngine_getKeys()
 {
     /*
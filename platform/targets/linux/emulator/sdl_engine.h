@@ -20,7 +20,7 @@
 #include <interfaces/keyboard.h>
 #include <SDL2/SDL.h>
 #include <stdbool.h>
-#include <chan.h>
+#include <stdint.h>
 
 /*
  * Screen dimensions, adjust basing on the size of the screen you need to
@@ -43,7 +43,8 @@
 #endif
 
 /**
- * Initialize the SDL engine. Must be called in the Main Thread.
+ * Initialize the SDL engine. Must be called in the Main Thread. No window is
+ * created when the emulator runs headless.
  */
 void sdlEngine_init();
 
@@ -59,6 +60,26 @@ void sdlEngine_run();
  */
 bool sdlEngine_ready();
 
+/**
+ * Thread-safe function sending a range of framebuffer rows to the SDL main
+ * loop. Rows are copied and then converted and drawn asynchronously, the
+ * function never waits for the screen to be updated.
+ *
+ * @param fb: pointer to the framebuffer.
+ * @param startRow: first row to be updated.
+ * @param endRow: row following the last one to be updated.
+ */
+void sdlEngine_updateRows(const void *fb, uint8_t startRow, uint8_t endRow);
+
+/**
+ * Thread-safe function getting the last frame sent to the SDL main loop. The
+ * frame is always available, also when running headless.
+ *
+ * @param pixels: destination buffer of SCREEN_WIDTH * SCREEN_HEIGHT pixels,
+ * in ARGB8888 format.
+ */
+void sdlEngine_getFrame(uint32_t *pixels);
+
 /**
  * Thread-safe function returning the keys currently being pressed.
  *
@@ -0,0 +1,195 @@
+/***************************************************************************
+ *   Copyright (C) 2023 by Federico Amedeo Izzo IU2NUO,                    *
+ *                         Niccolò Izzo IU2KIN                             *
+ *                         Frederik Saraci IU2NRO                          *
+ *                         Silvano Seva IU2KWO                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "snapshot.h"
+
+/*
+ * Maximum payload of a stored deflate block.
+ */
+#define DEFLATE_BLOCK 65535
+
+typedef struct
+{
+    FILE     *file;
+    uint32_t  crc;      // CRC of the current PNG chunk
+    uint32_t  adlerA;   // Adler-32 of the zlib stream
+    uint32_t  adlerB;
+    size_t    left;     // Bytes left in the current deflate block
+    size_t    total;    // Bytes left in the whole zlib stream
+}
+pngWriter_t;
+
+static uint32_t crcTable[256];
+
+static void crcInit()
+{
+    if(crcTable[1] != 0)
+        return;
+
+    for(uint32_t n = 0; n < 256; n++)
+    {
+        uint32_t c = n;
+        for(int k = 0; k < 8; k++)
+            c = (c & 1) ? (0xEDB88320 ^ (c >> 1)) : (c >> 1);
+
+        crcTable[n] = c;
+    }
+}
+
+/**
+ * \internal
+ * Write some bytes to the PNG file, updating the CRC of the current chunk.
+ */
+static void pngWrite(pngWriter_t *png, const uint8_t *data, size_t len)
+{
+    for(size_t i = 0; i < len; i++)
+        png->crc = crcTable[(png->crc ^ data[i]) & 0xFF] ^ (png->crc >> 8);
+
+    fwrite(data, 1, len, png->file);
+}
+
+static void pngWrite32(pngWriter_t *png, uint32_t value)
+{
+    uint8_t data[4] = { value >> 24, value >> 16, value >> 8, value };
+    pngWrite(png, data, sizeof(data));
+}
+
+static void pngChunkStart(pngWriter_t *png, const char *type, uint32_t len)
+{
+    pngWrite32(png, len);
+    png->crc = 0xFFFFFFFF;
+    pngWrite(png, (const uint8_t *) type, 4);
+}
+
+static void pngChunkEnd(pngWriter_t *png)
+{
+    uint32_t crc = png->crc ^ 0xFFFFFFFF;
+    pngWrite32(png, crc);
+}
+
+/**
+ * \internal
+ * Append data to the zlib stream, opening a new stored deflate block every
+ * DEFLATE_BLOCK bytes.
+ */
+static void zlibWrite(pngWriter_t *png, const uint8_t *data, size_t len)
+{
+    for(size_t i = 0; i < len; i++)
+    {
+        if(png->left == 0)
+        {
+            size_t  size   = (png->total > DEFLATE_BLOCK) ? DEFLATE_BLOCK
+                                                          : png->total;
+            uint8_t last   = (size == png->total) ? 1 : 0;
+            uint8_t hdr[5] = { last, size & 0xFF, size >> 8,
+                               ~size & 0xFF, (~size >> 8) & 0xFF };
+
+            pngWrite(png, hdr, sizeof(hdr));
+            png->left = size;
+        }
+
+        pngWrite(png, &data[i], 1);
+        png->adlerA = (png->adlerA + data[i]) % 65521;
+        png->adlerB = (png->adlerB + png->adlerA) % 65521;
+        png->left--;
+        png->total--;
+    }
+}
+
+uint64_t snapshot_hash(const uint32_t *pixels, size_t width, size_t height)
+{
+    uint64_t hash = 0xCBF29CE484222325ull;
+
+    for(size_t i = 0; i < (width * height); i++)
+    {
+        uint8_t rgb[3] = { pixels[i] >> 16, pixels[i] >> 8, pixels[i] };
+
+        for(int j = 0; j < 3; j++)
+        {
+            hash ^= rgb[j];
+            hash *= 0x100000001B3ull;
+        }
+    }
+
+    return hash;
+}
+
+int snapshot_savePNG(const char *filename, const uint32_t *pixels,
+                     size_t width, size_t height)
+{
+    static const uint8_t signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n',
+                                         0x1A, '\n' };
+
+    pngWriter_t png;
+    png.file = fopen(filename, "wb");
+    if(png.file == NULL)
+        return -1;
+
+    crcInit();
+    fwrite(signature, 1, sizeof(signature), png.file);
+
+    // Header: 8 bit depth, RGB color, no interlace
+    static const uint8_t ihdr[] = { 8, 2, 0, 0, 0 };
+    pngChunkStart(&png, "IHDR", 13);
+    pngWrite32(&png, width);
+    pngWrite32(&png, height);
+    pngWrite(&png, ihdr, sizeof(ihdr));
+    pngChunkEnd(&png);
+
+    // Image data: each row is preceded by the filter type, zero for none
+    size_t rawSize   = height * (1 + (width * 3));
+    size_t numBlocks = (rawSize + DEFLATE_BLOCK - 1) / DEFLATE_BLOCK;
+    size_t idatSize  = 2 + (numBlocks * 5) + rawSize + 4;
+
+    static const uint8_t zlibHdr[] = { 0x78, 0x01 };
+    pngChunkStart(&png, "IDAT", idatSize);
+    pngWrite(&png, zlibHdr, sizeof(zlibHdr));
+
+    png.adlerA = 1;
+    png.adlerB = 0;
+    png.left   = 0;
+    png.total  = rawSize;
+
+    for(size_t y = 0; y < height; y++)
+    {
+        uint8_t filter = 0;
+        zlibWrite(&png, &filter, 1);
+
+        for(size_t x = 0; x < width; x++)
+        {
+            uint32_t px     = pixels[(y * width) + x];
+            uint8_t  rgb[3] = { px >> 16, px >> 8, px };
+            zlibWrite(&png, rgb, sizeof(rgb));
+        }
+    }
+
+    pngWrite32(&png, (png.adlerB << 16) | png.adlerA);
+    pngChunkEnd(&png);
+
+    pngChunkStart(&png, "IEND", 0);
+    pngChunkEnd(&png);
+
+    int ret = ferror(png.file) ? -1 : 0;
+    fclose(png.file);
+
+    return ret;
+}
@@ -0,0 +1,65 @@
+/***************************************************************************
+ *   Copyright (C) 2023 by Federico Amedeo Izzo IU2NUO,                    *
+ *                         Niccolò Izzo IU2KIN                             *
+ *                         Frederik Saraci IU2NRO                          *
+ *                         Silvano Seva IU2KWO                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Framebuffer snapshots for the headless emulator. Frames are handled in
+ * ARGB8888 format and compared through a hash of their RGB content, so that
+ * golden images can be checked either by hash or by looking at the PNG dumps.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Compute the hash of a frame, using the 64 bit FNV-1a function over the red,
+ * green and blue components of each pixel, in this order. The alpha channel
+ * is ignored.
+ *
+ * @param pixels: frame pixels, in ARGB8888 format.
+ * @param width: frame width.
+ * @param height: frame height.
+ * @return frame hash.
+ */
+uint64_t snapshot_hash(const uint32_t *pixels, size_t width, size_t height);
+
+/**
+ * Save a frame as an uncompressed 8 bit RGB PNG image.
+ *
+ * @param filename: destination file.
+ * @param pixels: frame pixels, in ARGB8888 format.
+ * @param width: frame width.
+ * @param height: frame height.
+ * @return zero on success, a negative value on failure.
+ */
+int snapshot_savePNG(const char *filename, const uint32_t *pixels,
+                     size_t width, size_t height);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SNAPSHOT_H */
@@ -0,0 +1,393 @@
+/***************************************************************************
+ *   Copyright (C) 2023 by Federico Amedeo Izzo IU2NUO,                    *
+ *                         Niccolò Izzo IU2KIN                             *
+ *                         Frederik Saraci IU2NRO                          *
+ *                         Silvano Seva IU2KWO                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+#include <virtual_clock.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+/*
+ * Maximum number of condition variables having threads waiting on them at the
+ * same time.
+ */
+#define VCLOCK_MAX_CONDS 64
+
+/*
+ * Functions provided by the linker when wrapping the pthread ones with the
+ * --wrap option.
+ */
+int __real_pthread_create(pthread_t *thread, const pthread_attr_t *attr,
+                          void *(*func)(void *), void *arg);
+int __real_pthread_join(pthread_t thread, void **retval);
+int __real_pthread_cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex);
+int __real_pthread_cond_signal(pthread_cond_t *cond);
+int __real_pthread_cond_broadcast(pthread_cond_t *cond);
+
+typedef struct sleeper
+{
+    uint64_t        deadline;   // Wakeup time
+    pthread_cond_t  cond;       // Condition for the thread wakeup
+    bool            awake;      // Thread has been woken up
+    struct sleeper *next;
+}
+sleeper_t;
+
+typedef struct
+{
+    pthread_cond_t *cond;       // Condition variable
+    uint32_t        waiters;    // Threads waiting on the condition
+    uint32_t        credits;    // Waiters already counted as running
+}
+condInfo_t;
+
+typedef struct
+{
+    void *(*func)(void *);
+    void *arg;
+}
+threadArgs_t;
+
+static pthread_once_t       initOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t        threadKey;
+static pthread_mutex_t      mutex    = PTHREAD_MUTEX_INITIALIZER;
+static bool                 enabled  = false;
+static atomic_uint_fast64_t vNow;              // Current virtual time, in us
+static uint32_t             epoch    = 0;      // Dispatch counter
+static uint32_t             running  = 0;      // Tracked threads running
+static sleeper_t           *sleepers = NULL;   // Sleepers, by wakeup time
+static condInfo_t           conds[VCLOCK_MAX_CONDS];
+
+/*
+ * State of the calling thread: tracked threads are the ones created by
+ * OpenRTX, counted ones are tracked threads currently running.
+ */
+static _Thread_local bool tracked = false;
+static _Thread_local bool counted = false;
+
+
+/**
+ * \internal
+ * Wake up the sleeper with the earliest deadline, moving the clock forward
+ * to its wakeup time. Called with the mutex locked, when no tracked thread
+ * is running or when the watchdog expires.
+ */
+static void wakeNext()
+{
+    sleeper_t *next = sleepers;
+    if(next == NULL)
+        return;
+
+    sleepers = next->next;
+    if(next->deadline > atomic_load(&vNow))
+        atomic_store(&vNow, next->deadline);
+
+    // Count the thread as running before it actually resumes, to not let
+    // the time advance in the meantime.
+    next->awake = true;
+    running    += 1;
+    epoch      += 1;
+    __real_pthread_cond_signal(&next->cond);
+}
+
+static inline void dispatch()
+{
+    if(running == 0)
+        wakeNext();
+}
+
+/**
+ * \internal
+ * Set the calling thread as not running. Called with the mutex locked.
+ */
+static void setWaiting()
+{
+    if(counted == false)
+        return;
+
+    counted  = false;
+    running -= 1;
+    dispatch();
+}
+
+/**
+ * \internal
+ * Find the descriptor of a condition variable, optionally allocating a new
+ * one. Called with the mutex locked.
+ */
+static condInfo_t *findCond(const pthread_cond_t *cond, const bool alloc)
+{
+    condInfo_t *slot = NULL;
+
+    for(size_t i = 0; i < VCLOCK_MAX_CONDS; i++)
+    {
+        if(conds[i].cond == cond)
+            return &conds[i];
+
+        if((slot == NULL) && (conds[i].waiters == 0) && (conds[i].credits == 0))
+            slot = &conds[i];
+    }
+
+    if((alloc == false) || (slot == NULL))
+        return NULL;
+
+    slot->cond = (pthread_cond_t *) cond;
+    return slot;
+}
+
+static void threadExit(void *arg)
+{
+    (void) arg;
+
+    pthread_mutex_lock(&mutex);
+    setWaiting();
+    pthread_mutex_unlock(&mutex);
+}
+
+static void *threadEntry(void *arg)
+{
+    threadArgs_t args = *((threadArgs_t *) arg);
+    free(arg);
+
+    // Already counted as running by the parent thread
+    tracked = true;
+    counted = true;
+    pthread_setspecific(threadKey, &counted);
+
+    return args.func(args.arg);
+}
+
+static void init()
+{
+    const char *env = getenv("OPENRTX_VIRTUAL_TIME");
+    if((env == NULL) || (strcmp(env, "1") != 0))
+        return;
+
+    pthread_key_create(&threadKey, threadExit);
+    atomic_store(&vNow, 0);
+    enabled = true;
+}
+
+
+bool vclock_enabled()
+{
+    pthread_once(&initOnce, init);
+    return enabled;
+}
+
+uint64_t vclock_now()
+{
+    return atomic_load(&vNow);
+}
+
+void vclock_sleepUntil(const uint64_t time)
+{
+    if(vclock_enabled() == false)
+        return;
+
+    pthread_mutex_lock(&mutex);
+
+    // Threads not created by OpenRTX are tracked from their first sleep
+    if(tracked == false)
+    {
+        tracked  = true;
+        counted  = true;
+        running += 1;
+        pthread_setspecific(threadKey, &counted);
+    }
+
+    if(time <= atomic_load(&vNow))
+    {
+        pthread_mutex_unlock(&mutex);
+        return;
+    }
+
+    sleeper_t self;
+    self.deadline = time;
+    self.awake    = false;
+    pthread_cond_init(&self.cond, NULL);
+
+    // Insert in the sleeper list, ordered by deadline and, for the same
+    // deadline, by arrival
+    sleeper_t **pos = &sleepers;
+    while((*pos != NULL) && ((*pos)->deadline <= time))
+        pos = &(*pos)->next;
+
+    self.next = *pos;
+    *pos      = &self;
+
+    setWaiting();
+
+    uint32_t lastEpoch = epoch;
+    while(self.awake == false)
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_nsec += VCLOCK_WATCHDOG_MS * 1000000L;
+        ts.tv_sec  += ts.tv_nsec / 1000000000L;
+        ts.tv_nsec %= 1000000000L;
+
+        int ret = pthread_cond_timedwait(&self.cond, &mutex, &ts);
+
+        // Some thread is blocked in a way not tracked by the virtual clock:
+        // let the time advance anyway.
+        if((ret == ETIMEDOUT) && (self.awake == false) && (epoch == lastEpoch))
+            wakeNext();
+
+        lastEpoch = epoch;
+    }
+
+    counted = true;
+    pthread_cond_destroy(&self.cond);
+    pthread_mutex_unlock(&mutex);
+}
+
+void vclock_idle()
+{
+    if(tracked == false)
+        return;
+
+    pthread_mutex_lock(&mutex);
+    setWaiting();
+    pthread_mutex_unlock(&mutex);
+}
+
+void vclock_busy()
+{
+    if((tracked == false) || counted)
+        return;
+
+    pthread_mutex_lock(&mutex);
+    counted  = true;
+    running += 1;
+    pthread_mutex_unlock(&mutex);
+}
+
+
+int __wrap_pthread_create(pthread_t *thread, const pthread_attr_t *attr,
+                          void *(*func)(void *), void *arg)
+{
+    if(vclock_enabled() == false)
+        return __real_pthread_create(thread, attr, func, arg);
+
+    threadArgs_t *args = malloc(sizeof(threadArgs_t));
+    if(args == NULL)
+        return EAGAIN;
+
+    args->func = func;
+    args->arg  = arg;
+
+    pthread_mutex_lock(&mutex);
+    running += 1;
+    pthread_mutex_unlock(&mutex);
+
+    int ret = __real_pthread_create(thread, attr, threadEntry, args);
+    if(ret != 0)
+    {
+        free(args);
+
+        pthread_mutex_lock(&mutex);
+        running -= 1;
+        dispatch();
+        pthread_mutex_unlock(&mutex);
+    }
+
+    return ret;
+}
+
+int __wrap_pthread_join(pthread_t thread, void **retval)
+{
+    vclock_idle();
+    int ret = __real_pthread_join(thread, retval);
+    vclock_busy();
+
+    return ret;
+}
+
+int __wrap_pthread_cond_wait(pthread_cond_t *cond, pthread_mutex_t *mtx)
+{
+    if(tracked == false)
+        return __real_pthread_cond_wait(cond, mtx);
+
+    pthread_mutex_lock(&mutex);
+    condInfo_t *info = findCond(cond, true);
+    if(info != NULL)
+    {
+        info->waiters += 1;
+        setWaiting();
+    }
+    pthread_mutex_unlock(&mutex);
+
+    int ret = __real_pthread_cond_wait(cond, mtx);
+
+    if(info != NULL)
+    {
+        pthread_mutex_lock(&mutex);
+        info->waiters -= 1;
+
+        // The thread may have already been counted as running by the one
+        // which signalled the condition.
+        if(info->credits > 0)
+            info->credits -= 1;
+        else
+            running += 1;
+
+        counted = true;
+        pthread_mutex_unlock(&mutex);
+    }
+
+    return ret;
+}
+
+int __wrap_pthread_cond_signal(pthread_cond_t *cond)
+{
+    if(vclock_enabled())
+    {
+        pthread_mutex_lock(&mutex);
+        condInfo_t *info = findCond(cond, false);
+        if((info != NULL) && (info->waiters > info->credits))
+        {
+            info->credits += 1;
+            running       += 1;
+        }
+        pthread_mutex_unlock(&mutex);
+    }
+
+    return __real_pthread_cond_signal(cond);
+}
+
+int __wrap_pthread_cond_broadcast(pthread_cond_t *cond)
+{
+    if(vclock_enabled())
+    {
+        pthread_mutex_lock(&mutex);
+        condInfo_t *info = findCond(cond, false);
+        if((info != NULL) && (info->waiters > info->credits))
+        {
+            running      += info->waiters - info->credits;
+            info->credits = info->waiters;
+        }
+        pthread_mutex_unlock(&mutex);
+    }
+
+    return __real_pthread_cond_broadcast(cond);
+}
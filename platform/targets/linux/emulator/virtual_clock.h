@@ -0,0 +1,92 @@
+/***************************************************************************
+ *   Copyright (C) 2023 by Federico Amedeo Izzo IU2NUO,                    *
+ *                         Niccolò Izzo IU2KIN                             *
+ *                         Frederik Saraci IU2NRO                          *
+ *                         Silvano Seva IU2KWO                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+#ifndef VIRTUAL_CLOCK_H
+#define VIRTUAL_CLOCK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Virtual time for the Linux emulator, enabled by setting the environment
+ * variable OPENRTX_VIRTUAL_TIME=1.
+ *
+ * When enabled, the delay functions, the system tick and the emulated audio
+ * streams use a simulated clock instead of the wall clock. The clock starts
+ * from zero and advances only when all the threads created by OpenRTX are
+ * waiting: either sleeping on the virtual clock or blocked on a condition
+ * variable. It then jumps to the earliest pending wakeup time and resumes
+ * exactly one sleeping thread, the one with the earliest deadline and, for
+ * equal deadlines, the one which went to sleep first. Timed events are thus
+ * processed in a deterministic order and as fast as the CPU allows.
+ *
+ * Threads are tracked through the pthread_create, pthread_join and
+ * pthread_cond_* functions, which are wrapped at link time. Threads blocking
+ * in other ways (spinning on a flag, reading from the terminal, ...) have to
+ * mark themselves as idle, otherwise virtual time stops until a watchdog
+ * expires after VCLOCK_WATCHDOG_MS of real time.
+ */
+
+#ifndef VCLOCK_WATCHDOG_MS
+#define VCLOCK_WATCHDOG_MS 100
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Check if virtual time is enabled.
+ *
+ * @return true if the emulator is running in virtual time.
+ */
+bool vclock_enabled();
+
+/**
+ * Get the current virtual time.
+ *
+ * @return virtual time elapsed since the start of the emulator, in microseconds.
+ */
+uint64_t vclock_now();
+
+/**
+ * Suspend the calling thread until the virtual clock reaches the given time.
+ * The function returns immediately if the time is not in the future.
+ *
+ * @param time: wakeup time, in microseconds.
+ */
+void vclock_sleepUntil(const uint64_t time);
+
+/**
+ * Mark the calling thread as waiting for an event not tracked by the virtual
+ * clock, allowing the time to advance in the meantime.
+ */
+void vclock_idle();
+
+/**
+ * Mark the calling thread as running again after a call to vclock_idle().
+ */
+void vclock_busy();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VIRTUAL_CLOCK_H */
@@ -49,7 +49,9 @@ void platform_init()
 void platform_terminate()
 {
     printf("Platform terminate\n");
-    exit(0);
+
+    // Failed shell checks are reported through the exit status
+    exit((emulator_failedChecks() > 0) ? 1 : 0);
 }
 
 void platform_setBacklightLevel(uint8_t level)
@@ -65,21 +65,10 @@ void set_blocking (int fd, int should_block)
                 printf ("error %d setting term attributes", errno);
 }
 
-typedef struct
-{
-    int16_t sample;
-    int32_t conv;
-    float   conv_th;
-    int32_t sample_index;
-    float   qnt_pos_avg;
-    float   qnt_neg_avg;
-    int32_t symbol;
-    int32_t frame_index;
-    uint8_t flags;
-    uint8_t _empty;
-}
-__attribute__((packed)) log_entry_t;
-
+/*
+ * Save the binary trace of the M17 demodulator sent by the radio to
+ * demod_trace.bin, decode it with plot_m17_demod_trace.py.
+ */
 int main() {
     //char *portname = "/dev/ttyACM0";
     char *portname = "/dev/serial/by-id/usb-STMicroelectronics_STM32_Virtual_ComPort_in_FS_Mode_00000000050C-if00";
@@ -92,23 +81,16 @@ int main() {
     }
     set_interface_attribs (fd, B115200, 0);  // set speed to 115,200 bps, 8n1 (no parity)
     set_blocking (fd, 0);                // set no blocking
-    log_entry_t log = { 0 };
-    FILE *csv_log = fopen("serial_demod_log.csv", "w");
-    fprintf(csv_log, "Sample,Convolution,Threshold,Index,Max,Min,Symbol,I,Flags\n");
+    uint8_t buf[4096];
+    FILE *trace = fopen("demod_trace.bin", "wb");
     while(true)
     {
-        read(fd, &log, sizeof(log));
-        fprintf(csv_log, "%" PRId16 ",%d,%f,%d,%f,%f,%d,%d,%d\n",
-                log.sample,
-                log.conv,
-                log.conv_th,
-                log.sample_index,
-                log.qnt_pos_avg,
-                log.qnt_neg_avg,
-                log.symbol,
-                log.frame_index,
-                log.flags);
-        fflush(csv_log);
+        ssize_t len = read(fd, buf, sizeof(buf));
+        if(len > 0)
+        {
+            fwrite(buf, 1, len, trace);
+            fflush(trace);
+        }
     }
-    fclose(csv_log);
+    fclose(trace);
 }
@@ -0,0 +1,94 @@
+#! /usr/bin/env python3
+
+# Decoder for the binary trace of the M17 demodulator, produced when the
+# firmware is built with ENABLE_DEMOD_LOG. On linux the trace is written to
+# demod_trace.bin, on the radios it is sent to the USB serial port and can be
+# saved with get_demod_log.
+#
+# Usage: plot_m17_demod_trace.py <trace file> [--csv <output file>]
+
+import numpy as np
+from matplotlib import pyplot as plt
+from sys import argv, exit
+
+TRACE_CORR   = 0x01
+TRACE_QNT    = 0x02
+TRACE_SYMBOL = 0x04
+
+REC_BLOCK  = 0
+REC_CORR   = 1
+REC_QNT    = 2
+REC_SYMBOL = 3
+
+header_t = np.dtype([("magic",      "S4"),
+                     ("version",    "u1"),
+                     ("channels",   "u1"),
+                     ("recordSize", "u1"),
+                     ("empty",      "u1"),
+                     ("sampleRate", "<u4"),
+                     ("recordRate", "<u4")])
+
+record_t = np.dtype([("type",   "u1"),
+                     ("flags",  "u1"),
+                     ("sample", "<i2"),
+                     ("index",  "<i4"),
+                     ("a",      "<i4"),
+                     ("b",      "<i4")])
+
+data = np.fromfile(argv[1], dtype=np.uint8)
+
+# Skip anything before the header, a serial port may have been opened after
+# the trace start.
+start = data.tobytes().find(b"M17T")
+if start < 0:
+    exit("No trace header found")
+
+hdr = np.frombuffer(data, dtype=header_t, count=1, offset=start)[0]
+if (hdr["version"] != 1) or (hdr["recordSize"] != record_t.itemsize):
+    exit("Unsupported trace format")
+
+start  += header_t.itemsize
+count   = (len(data) - start) // record_t.itemsize
+records = np.frombuffer(data, dtype=record_t, count=count, offset=start)
+
+blocks  = records[records["type"] == REC_BLOCK]
+corr    = records[records["type"] == REC_CORR]
+qnt     = records[records["type"] == REC_QNT]
+symbols = records[records["type"] == REC_SYMBOL]
+
+print("Sample rate: %d Hz" % hdr["sampleRate"])
+print("Channels:   %s%s%s" % ("corr " if hdr["channels"] & TRACE_CORR   else "",
+                              "qnt "  if hdr["channels"] & TRACE_QNT    else "",
+                              "sym"   if hdr["channels"] & TRACE_SYMBOL else ""))
+print("Rate limit: %s" % (("%d records/s" % hdr["recordRate"])
+                          if hdr["recordRate"] else "none"))
+print("Blocks: %d, correlation: %d, quantizer: %d, symbols: %d, dropped: %d"
+      % (len(blocks), len(corr), len(qnt), len(symbols), blocks["b"].sum()))
+
+if (len(argv) > 3) and (argv[2] == "--csv"):
+    np.savetxt(argv[3], records, delimiter=",", fmt="%d",
+               header="Type,Flags,Sample,Index,A,B", comments="")
+    exit(0)
+
+plt.rcParams["figure.autolayout"] = True
+fig, (ax1, ax2) = plt.subplots(2, 1, sharex=True)
+
+ax1.plot(corr["index"], corr["sample"],   ".", markersize=1, label="Sample")
+ax1.plot(corr["index"], corr["a"] / 10,   label="Conv")
+ax1.plot(corr["index"], corr["b"] / 10,   label="Conv. Th+")
+ax1.plot(corr["index"], -corr["b"] / 10,  label="Conv. Th-")
+ax1.grid(True)
+ax1.legend(loc="upper left")
+
+ax2.plot(symbols["index"], symbols["sample"], ".", markersize=2, label="Symbol sample")
+ax2.step(qnt["index"], qnt["a"], where="post", label="Qnt. avg. +")
+ax2.step(qnt["index"], qnt["b"], where="post", label="Qnt. avg. -")
+ax2.plot(blocks["index"], blocks["flags"].astype(int) * 1000, drawstyle="steps-post",
+         label="Locked")
+ax2.vlines(blocks["index"][blocks["b"] > 0], -20000, 20000, colors="red",
+           label="Dropped records")
+ax2.grid(True)
+ax2.legend(loc="upper left")
+
+plt.suptitle(argv[1])
+plt.show()
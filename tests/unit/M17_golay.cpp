@@ -22,9 +22,13 @@
 #include <cstdio>
 #include <cstdint>
 #include <random>
-#include "M17/M17Golay.h"
+#include <chrono>
+#include <vector>
+#include <array>
+#include <M17/M17Golay.hpp>
 
 using namespace std;
+using namespace M17;
 
 default_random_engine rng;
 
@@ -45,8 +49,102 @@ uint32_t generateErrorMask()
     return errorMask;
 }
 
+/**
+ * Check that the table-driven error detection gives the same result of the
+ * syndrome search for every possible syndrome.
+ */
+bool checkSyndromeTable()
+{
+    for(uint32_t syndrome = 0; syndrome < 4096; syndrome++)
+    {
+        if(Golay24::detectErrors(syndrome) != Golay24::searchErrors(syndrome))
+        {
+            printf("Syndrome %03x: table and search mismatch\n", syndrome);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Check decoding of a full LICH segment, with up to three bit errors in each
+ * codeword.
+ */
+bool checkLichDecode()
+{
+    uniform_int_distribution< uint16_t > rndValue(0, 4095);
+    uniform_int_distribution< uint8_t >  errPos(0, 23);
+
+    for(uint32_t i = 0; i < 1000; i++)
+    {
+        array< uint8_t, 12 >  lich;
+        array< uint16_t, 4 >  values;
+        array< uint16_t, 4 >  decoded;
+
+        for(size_t j = 0; j < 4; j++)
+        {
+            values[j]      = rndValue(rng);
+            uint32_t cword = golay24_encode(values[j]);
+
+            for(uint8_t k = 0; k < (i % 4); k++)
+                cword ^= 1 << errPos(rng);
+
+            lich[3*j]     = (cword >> 16) & 0xFF;
+            lich[3*j + 1] = (cword >> 8)  & 0xFF;
+            lich[3*j + 2] = cword & 0xFF;
+        }
+
+        if((golay24_decodeLich(lich, decoded) == false) || (decoded != values))
+        {
+            printf("LICH decode failed\n");
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Compare the decoding speed of table lookup and syndrome search.
+ */
+void benchmark()
+{
+    constexpr uint32_t N = 200000;
+
+    uniform_int_distribution< uint16_t > rndValue(0, 4095);
+    vector< uint32_t > cwords(N);
+
+    for(auto& cword : cwords)
+        cword = golay24_encode(rndValue(rng)) ^ generateErrorMask();
+
+    uint32_t dummy = 0;
+    auto start     = chrono::steady_clock::now();
+    for(auto cword : cwords)
+        dummy += Golay24::detectErrors(cword);
+
+    auto mid = chrono::steady_clock::now();
+    for(auto cword : cwords)
+        dummy += Golay24::searchErrors(cword);
+
+    auto end = chrono::steady_clock::now();
+
+    auto table  = chrono::duration_cast< chrono::nanoseconds >(mid - start);
+    auto search = chrono::duration_cast< chrono::nanoseconds >(end - mid);
+
+    printf("Error detection: %.1fns/codeword, syndrome search: %.1fns/codeword (%x)\n",
+           static_cast< float >(table.count())  / N,
+           static_cast< float >(search.count()) / N, dummy);
+}
+
 int main()
 {
+    if(checkSyndromeTable() == false)
+        return -1;
+
+    if(checkLichDecode() == false)
+        return -1;
+
     uniform_int_distribution< uint16_t > rndValue(0, 2047);
 
     for(uint32_t i = 0; i < 10000; i++)
@@ -84,5 +182,7 @@ int main()
             return -1;
     }
 
+    benchmark();
+
     return 0;
 }
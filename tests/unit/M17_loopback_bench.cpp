@@ -0,0 +1,472 @@
+/***************************************************************************
+ *   Copyright (C) 2023 by Federico Amedeo Izzo IU2NUO,                    *
+ *                         Niccolò Izzo IU2KIN                             *
+ *                         Frederik Saraci IU2NRO                          *
+ *                         Silvano Seva IU2KWO                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+// Access private methods to bypass the audio streams
+#define private public
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <M17/M17FrameEncoder.hpp>
+#include <M17/M17FrameDecoder.hpp>
+#include <M17/M17Modulator.hpp>
+#include <M17/M17Demodulator.hpp>
+#include <M17/M17Utils.hpp>
+
+using namespace M17;
+using clk = std::chrono::steady_clock;
+
+/**
+ * Loopback benchmark of the whole M17 chain: frames are encoded, modulated,
+ * passed through a channel model and then demodulated and decoded, all in
+ * memory. For each Eb/N0 point the program reports the bit error rate of the
+ * payload of the received stream frames, the rate of frames lost because of
+ * sync failures and the overall frame error rate, lost frames included, along
+ * with the time spent in each stage.
+ *
+ * Usage: m17_loopback_bench [-n frames] [-e min] [-E max] [-s step]
+ *                           [-f offset] [-c skew] [-r seed]
+ *
+ *  -n: number of stream frames per Eb/N0 point (default 200)
+ *  -e, -E, -s: Eb/N0 sweep range and step in dB (default 0 to 12, step 2)
+ *  -f: carrier frequency offset in Hz (default 0)
+ *  -c: clock skew between transmitter and receiver in ppm (default 0)
+ *  -r: seed for the pseudo-random generators (default 1)
+ */
+
+enum Stage
+{
+    ENCODE = 0,
+    MODULATE,
+    CHANNEL,
+    DEMODULATE,
+    DECODE,
+    NUM_STAGES
+};
+
+static const char *stageNames[NUM_STAGES] =
+{
+    "encode", "modulate", "channel", "demodulate", "decode"
+};
+
+static constexpr size_t TX_FRAME_SAMPLES = M17Modulator::M17_FRAME_SAMPLES;
+static constexpr size_t RX_BLOCK_SIZE    = M17Demodulator::M17_SAMPLE_BUF_SIZE;
+static constexpr float  RX_LEVEL         = 5000.0f;    // RMS level at demodulator input
+static constexpr float  SYMBOL_DEV       = 800.0f;     // Deviation of a +1 symbol, in Hz
+static constexpr size_t FN_MASK          = 0x07FF;     // Stream frame number range
+
+/**
+ * Channel model: clock skew, frequency offset and additive white gaussian
+ * noise. Baseband is resampled from the 48kHz of the modulator to the 24kHz
+ * of the demodulator using linear interpolation, the resampling ratio accounts
+ * for the clock skew. Being the signal the output of an FM discriminator, a
+ * carrier frequency offset is modelled as a DC offset.
+ */
+struct Channel
+{
+    float                 gain;        ///< Gain bringing the signal to RX_LEVEL.
+    float                 dcOffset;    ///< DC offset equivalent to the frequency offset.
+    float                 noiseStd;    ///< Standard deviation of the noise samples.
+    double                step;        ///< Resampling step, in input samples.
+    double                pos;         ///< Resampling position in input buffer.
+    std::vector< float >  input;       ///< Pending input samples.
+    std::vector< int16_t> output;      ///< Output samples, not yet consumed.
+    std::mt19937          rng;
+    std::normal_distribution< float > noise;
+
+    void process(const int16_t *samples, const size_t len)
+    {
+        for(size_t i = 0; i < len; i++)
+            input.push_back(static_cast< float >(samples[i]) * gain);
+
+        while(pos + 1.0 < static_cast< double >(input.size()))
+        {
+            size_t idx  = static_cast< size_t >(pos);
+            float  frac = static_cast< float >(pos - idx);
+            float  val  = input[idx] + frac * (input[idx + 1] - input[idx]);
+
+            val += dcOffset;
+            if(noiseStd > 0.0f) val += noise(rng) * noiseStd;
+            val  = fminf(fmaxf(val, -32768.0f), 32767.0f);
+
+            output.push_back(static_cast< int16_t >(lrintf(val)));
+            pos += step;
+        }
+
+        // Drop the input samples already consumed
+        size_t used = std::min(static_cast< size_t >(pos), input.size());
+        input.erase(input.begin(), input.begin() + used);
+        pos -= used;
+    }
+};
+
+struct Result
+{
+    uint32_t sentFrames;
+    uint32_t rxFrames;
+    uint32_t badFrames;
+    uint64_t bitErrors;
+    uint64_t bits;
+    double   stageTime[NUM_STAGES];
+};
+
+static inline double elapsed(const clk::time_point& start)
+{
+    return std::chrono::duration< double >(clk::now() - start).count();
+}
+
+/**
+ * Modulate a frame into the idle buffer of the modulator. Same as
+ * M17Modulator::send(), without sending the baseband to the audio output.
+ */
+static void modulate(M17Modulator& modulator, const frame_t& frame)
+{
+    auto it = modulator.symbols.begin();
+    for(size_t i = 0; i < frame.size(); i++)
+    {
+        auto sym = byteToSymbols(frame[i]);
+        it       = std::copy(sym.begin(), sym.end(), it);
+    }
+
+    modulator.symbolsToBaseband();
+}
+
+/**
+ * Modulate a preamble made of alternated +3 and -3 symbols, as done by
+ * M17Modulator::start().
+ */
+static void modulatePreamble(M17Modulator& modulator)
+{
+    for(size_t i = 0; i < modulator.symbols.size(); i += 2)
+    {
+        modulator.symbols[i]     = +3;
+        modulator.symbols[i + 1] = -3;
+    }
+
+    modulator.symbolsToBaseband();
+}
+
+/**
+ * Measure the mean power of the modulated signal over a set of frames of
+ * random data.
+ */
+static float measurePower(std::mt19937& rng)
+{
+    M17Modulator modulator;
+    modulator.init();
+    modulator.invPhase = false;
+
+    double acc = 0.0;
+    for(size_t n = 0; n < 20; n++)
+    {
+        frame_t frame;
+        for(auto& b : frame) b = static_cast< uint8_t >(rng());
+
+        modulate(modulator, frame);
+        for(size_t i = 0; i < TX_FRAME_SAMPLES; i++)
+        {
+            double s = modulator.idleBuffer[i];
+            acc += s * s;
+        }
+    }
+
+    modulator.terminate();
+    return static_cast< float >(acc / (20.0 * TX_FRAME_SAMPLES));
+}
+
+static Result runPoint(const float ebn0, const float freqOffset,
+                       const float skewPpm, const size_t numFrames,
+                       const float power, const uint32_t seed)
+{
+    Result res;
+    memset(&res, 0x00, sizeof(res));
+
+    M17FrameEncoder encoder;
+    M17FrameDecoder decoder;
+    M17Modulator    modulator;
+    M17Demodulator  demodulator;
+
+    modulator.init();
+    modulator.invPhase = false;
+
+    // Same as M17Demodulator::startBasebandSampling(), without audio streams
+    demodulator.init();
+    demodulator.basebandId   = -1;
+    demodulator.basebandPath = -1;
+    demodulator.invPhase     = false;
+    demodulator.resetCorrelationStats();
+    demodulator.resetQuantizationStats();
+    dsp_resetFilterState(&demodulator.dsp_state);
+
+    // Input stream buffer, with the history region in front of the block
+    int16_t *history = demodulator.baseband_buffer.get();
+    int16_t *block   = history + M17Demodulator::M17_BRIDGE_SIZE;
+    memset(history, 0x00, M17Demodulator::M17_BRIDGE_SIZE * sizeof(int16_t));
+
+    // Energy per symbol at the demodulator input, 24kHz sampling rate, and
+    // the corresponding noise level: Eb = Es / 2, sigma^2 = N0 / 2.
+    float gain = RX_LEVEL / sqrtf(power);
+    float es   = RX_LEVEL * RX_LEVEL * M17Demodulator::M17_SAMPLES_PER_SYMBOL;
+    float n0   = es / (2.0f * powf(10.0f, ebn0 / 10.0f));
+
+    Channel channel;
+    channel.gain     = gain;
+    channel.dcOffset = (freqOffset / SYMBOL_DEV) * (RX_LEVEL / sqrtf(5.0f));
+    channel.noiseStd = std::isinf(ebn0) ? 0.0f : sqrtf(n0 / 2.0f);
+    channel.step     = 2.0 * (1.0 + skewPpm * 1e-6);
+    channel.pos      = 0.0;
+    channel.rng.seed(seed);
+
+    std::mt19937 dataRng(seed + 1);
+    std::vector< payload_t > payloads(numFrames);
+    std::vector< bool >      received(numFrames, false);
+
+    // Transmission sequence: two frames of preamble, LSF, stream frames, EOT
+    // marker and some trailing frames of silence to flush the demodulator.
+    size_t totFrames = 2 + 1 + numFrames + 1 + 2;
+    bool   locked    = false;
+    size_t lastFn    = 0;
+    for(size_t n = 0; n < totFrames; n++)
+    {
+        frame_t frame;
+        auto    start = clk::now();
+
+        if(n < 2)
+        {
+            modulatePreamble(modulator);
+            res.stageTime[MODULATE] += elapsed(start);
+        }
+        else if(n == 2)
+        {
+            M17LinkSetupFrame lsf;
+            streamType_t      type;
+            type.value           = 0;
+            type.fields.stream   = 1;
+            type.fields.dataType = 2;
+
+            lsf.clear();
+            lsf.setSource("N0CALL");
+            lsf.setType(type);
+            lsf.updateCrc();
+
+            encoder.reset();
+            encoder.encodeLsf(lsf, frame);
+            res.stageTime[ENCODE] += elapsed(start);
+
+            start = clk::now();
+            modulate(modulator, frame);
+            res.stageTime[MODULATE] += elapsed(start);
+        }
+        else if(n < (3 + numFrames))
+        {
+            payload_t& payload = payloads[n - 3];
+            for(auto& b : payload) b = static_cast< uint8_t >(dataRng());
+
+            start = clk::now();
+            encoder.encodeStreamFrame(payload, frame);
+            res.stageTime[ENCODE] += elapsed(start);
+
+            start = clk::now();
+            modulate(modulator, frame);
+            res.stageTime[MODULATE] += elapsed(start);
+            res.sentFrames++;
+        }
+        else if(n == (3 + numFrames))
+        {
+            encoder.encodeEotFrame(frame);
+            res.stageTime[ENCODE] += elapsed(start);
+
+            start = clk::now();
+            modulate(modulator, frame);
+            res.stageTime[MODULATE] += elapsed(start);
+        }
+        else
+        {
+            memset(modulator.idleBuffer, 0x00,
+                   TX_FRAME_SAMPLES * sizeof(stream_sample_t));
+        }
+
+        start = clk::now();
+        channel.process(modulator.idleBuffer, TX_FRAME_SAMPLES);
+        res.stageTime[CHANNEL] += elapsed(start);
+
+        // Feed the demodulator with blocks of the same size of the ones
+        // coming from the ADC, managing the history as the input stream does.
+        size_t offset = 0;
+        while((channel.output.size() - offset) >= RX_BLOCK_SIZE)
+        {
+            memcpy(block, channel.output.data() + offset,
+                   RX_BLOCK_SIZE * sizeof(int16_t));
+
+            start = clk::now();
+            demodulator.processBlock(block, RX_BLOCK_SIZE);
+            bool newFrame = demodulator.newFrame;
+            bool lock     = demodulator.isLocked();
+            res.stageTime[DEMODULATE] += elapsed(start);
+            offset += RX_BLOCK_SIZE;
+
+            memcpy(history, block + RX_BLOCK_SIZE - M17Demodulator::M17_BRIDGE_SIZE,
+                   M17Demodulator::M17_BRIDGE_SIZE * sizeof(int16_t));
+
+            // Reset the decoder when transitioning from unlocked to locked
+            // state, as done by the M17 operating mode. Frames are decoded
+            // even if the lock has been lost right after their end, as it
+            // happens for the last frame before the EOT marker.
+            if((lock == true) && (locked == false))
+                decoder.reset();
+
+            locked = lock;
+            if(newFrame == false)
+                continue;
+
+            start = clk::now();
+            auto type = decoder.decodeFrame(demodulator.getSoftFrame());
+            res.stageTime[DECODE] += elapsed(start);
+
+            if(type != M17FrameType::STREAM)
+                continue;
+
+            M17StreamFrame sf = decoder.getStreamFrame();
+            // Frame numbers wrap around, pick the transmitted frame closest
+            // to the last one received.
+            size_t fn = (lastFn & ~FN_MASK) | (sf.getFrameNumber() & FN_MASK);
+            if(fn + (FN_MASK / 2) < lastFn) fn += FN_MASK + 1;
+            else if((fn > lastFn + (FN_MASK / 2)) && (fn > FN_MASK)) fn -= FN_MASK + 1;
+
+            if((fn >= numFrames) || received[fn])
+                continue;
+
+            lastFn = fn;
+
+            received[fn] = true;
+            res.rxFrames++;
+
+            uint32_t errors = 0;
+            for(size_t i = 0; i < payloads[fn].size(); i++)
+                errors += __builtin_popcount(payloads[fn][i] ^ sf.payload()[i]);
+
+            res.bitErrors += errors;
+            res.bits      += payloads[fn].size() * 8;
+            if(errors > 0) res.badFrames++;
+        }
+
+        channel.output.erase(channel.output.begin(),
+                             channel.output.begin() + offset);
+    }
+
+    modulator.terminate();
+    demodulator.terminate();
+
+    return res;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t   numFrames  = 200;
+    float    ebn0Min    = 0.0f;
+    float    ebn0Max    = 12.0f;
+    float    ebn0Step   = 2.0f;
+    float    freqOffset = 0.0f;
+    float    skewPpm    = 0.0f;
+    uint32_t seed       = 1;
+
+    int opt;
+    while((opt = getopt(argc, argv, "n:e:E:s:f:c:r:")) != -1)
+    {
+        switch(opt)
+        {
+            case 'n': numFrames  = strtoul(optarg, NULL, 10); break;
+            case 'e': ebn0Min    = strtof(optarg, NULL);      break;
+            case 'E': ebn0Max    = strtof(optarg, NULL);      break;
+            case 's': ebn0Step   = strtof(optarg, NULL);      break;
+            case 'f': freqOffset = strtof(optarg, NULL);      break;
+            case 'c': skewPpm    = strtof(optarg, NULL);      break;
+            case 'r': seed       = strtoul(optarg, NULL, 10); break;
+            default:
+                fprintf(stderr, "Usage: %s [-n frames] [-e min] [-E max] "
+                                "[-s step] [-f offset] [-c skew] [-r seed]\n",
+                                argv[0]);
+                return -1;
+        }
+    }
+
+    if((numFrames == 0) || (ebn0Step <= 0.0f))
+    {
+        fprintf(stderr, "Invalid parameters\n");
+        return -1;
+    }
+
+    std::mt19937 rng(seed);
+    float power = measurePower(rng);
+
+    printf("M17 loopback: %zu frames per point, frequency offset %.1fHz, "
+           "clock skew %.1fppm\n\n", numFrames, freqOffset, skewPpm);
+
+    // Noiseless run, the whole chain must be error free
+    Result clean = runPoint(INFINITY, freqOffset, skewPpm, numFrames, power,
+                            seed);
+
+    double chain = 0.0;
+    for(size_t i = 0; i < NUM_STAGES; i++)
+    {
+        if(i != CHANNEL) chain += clean.stageTime[i];
+    }
+
+    printf("Noiseless: %u/%u frames, %u with errors, %.0f frames/s\n",
+           clean.rxFrames, clean.sentFrames, clean.badFrames,
+           clean.sentFrames / chain);
+
+    for(size_t i = 0; i < NUM_STAGES; i++)
+    {
+        printf("  %-12s %10.0f ns/frame\n", stageNames[i],
+               clean.stageTime[i] * 1e9 / clean.sentFrames);
+    }
+
+    printf("\n Eb/N0 [dB]        BER       Lost        FER\n");
+    for(float ebn0 = ebn0Min; ebn0 <= ebn0Max + 1e-3f; ebn0 += ebn0Step)
+    {
+        Result res = runPoint(ebn0, freqOffset, skewPpm, numFrames, power,
+                              seed);
+
+        uint32_t lost = res.sentFrames - res.rxFrames;
+        double   ber  = (res.bits > 0) ? static_cast< double >(res.bitErrors) / res.bits
+                                       : 1.0;
+        double   loss = static_cast< double >(lost) / res.sentFrames;
+        double   fer  = static_cast< double >(lost + res.badFrames) / res.sentFrames;
+
+        printf("%11.1f %10.2e %10.2e %10.2e\n", ebn0, ber, loss, fer);
+    }
+
+    // Without noise and impairments the whole chain must be error free
+    bool ideal = (freqOffset == 0.0f) && (skewPpm == 0.0f);
+    if(ideal && ((clean.rxFrames != clean.sentFrames) || (clean.badFrames != 0)))
+    {
+        printf("Error: frames lost or corrupted on an ideal channel\n");
+        return -1;
+    }
+
+    return 0;
+}
@@ -19,41 +19,75 @@
  *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
  ***************************************************************************/
 
-#include <limits.h>
-#include <inttypes.h>
+#include <stdlib.h>
 #include <stdio.h>
-#include <M17/M17DSP.h>
+#include <math.h>
+#include <M17/M17DSP.hpp>
 
-#define IMPULSE_SIZE 4096
+#define TEST_SIZE 4096
 
 using namespace std;
 
 /**
- * Test the different demodulation steps
+ * Compare the fixed point RRC filters against the floating point reference
+ * implementation, on a pseudo-random sequence of M17 symbols.
  */
 
 int main()
 {
-    // Open file
-    FILE *baseband_out = fopen("M17_rrc_impulse_response.raw", "wb");
-    if (!baseband_out)
+    Fir< 81 > ref48k(M17::rrc_taps_48k);
+    Fir< 41 > ref24k(M17::rrc_taps_24k);
+    srand(0x4d31);
+
+    // TX interpolator: feed symbols, compare against the zero-stuffed float FIR
+    float maxErr = 0.0f;
+    for(size_t i = 0; i < TEST_SIZE; i++)
     {
-        perror("Error in opening output file");
+        static const int16_t levels[] = {-3, -1, 1, 3};
+        int16_t symbol = levels[rand() % 4];
+        int32_t out[10];
+
+        M17::rrc_48k(symbol, out);
+
+        for(size_t j = 0; j < 10; j++)
+        {
+            float expected = ref48k((j == 0) ? static_cast< float >(symbol) : 0.0f);
+            float value    = static_cast< float >(out[j]) / 32768.0f;
+            maxErr = fmaxf(maxErr, fabsf(value - expected));
+        }
+    }
+
+    printf("48kHz interpolator max error: %f\n", maxErr);
+    if(maxErr > 0.001f)
+    {
+        printf("Error: interpolator output differs from reference\n");
         return -1;
     }
 
-    // Allocate impulse signal
-    int16_t impulse[IMPULSE_SIZE] = { 0 };
-    impulse[0] = SHRT_MAX;
+    // RX filter: feed full scale noise, compare against the float FIR
+    maxErr = 0.0f;
+    int16_t block[TEST_SIZE];
+    float   expected[TEST_SIZE];
+    for(size_t i = 0; i < TEST_SIZE; i++)
+    {
+        block[i]    = static_cast< int16_t >((rand() % 65536) - 32768);
+        expected[i] = ref24k(static_cast< float >(block[i]));
+    }
+
+    M17::rrc_24k.process(block, block, TEST_SIZE);
 
-    // Apply RRC on impulse signal
-    int16_t filtered_impulse[IMPULSE_SIZE] = { 0 };
-    for(size_t i = 0; i < IMPULSE_SIZE; i++)
+    for(size_t i = 0; i < TEST_SIZE; i++)
     {
-        float elem = static_cast< float >(impulse[i]);
-        filtered_impulse[i] = static_cast< int16_t >(M17::rrc(0.10 * elem));
+        float clamped = fminf(fmaxf(expected[i], -32768.0f), 32767.0f);
+        maxErr = fmaxf(maxErr, fabsf(static_cast< float >(block[i]) - clamped));
     }
-    fwrite(filtered_impulse, IMPULSE_SIZE, 1, baseband_out);
-    fclose(baseband_out);
+
+    printf("24kHz filter max error: %f\n", maxErr);
+    if(maxErr > 8.0f)
+    {
+        printf("Error: filter output differs from reference\n");
+        return -1;
+    }
+
     return 0;
 }
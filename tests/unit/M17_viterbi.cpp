@@ -29,6 +29,7 @@
 #include "M17/M17Utils.hpp"
 
 using namespace std;
+using namespace M17;
 
 default_random_engine rng;
 
@@ -49,6 +50,30 @@ void generateErrors(array< uint8_t, N >& data)
     }
 }
 
+/**
+ * Convert a byte array to soft bits, inserting random low-confidence bit flips.
+ */
+template < size_t N >
+array< uint16_t, N*8 > toSoftBits(const array< uint8_t, N >& data)
+{
+    uniform_int_distribution< uint8_t >  numErrs(0, 8);
+    uniform_int_distribution< uint16_t > errPos(0, N*8 - 1);
+    array< uint16_t, N*8 > soft;
+
+    for(size_t i = 0; i < soft.size(); i++)
+    {
+        soft[i] = getBit(data, i) ? 0xFFFF : 0x0000;
+    }
+
+    for(uint8_t i = 0; i < numErrs(rng); i++)
+    {
+        uint16_t pos = errPos(rng);
+        soft[pos] = (soft[pos] == 0xFFFF) ? 0x6000 : 0x9FFF;
+    }
+
+    return soft;
+}
+
 int main()
 {
     uniform_int_distribution< uint8_t > rndValue(0, 255);
@@ -85,5 +110,19 @@ int main()
         }
     }
 
+    auto softBits = toSoftBits(punctured);
+    M17SoftViterbi softDecoder;
+    softDecoder.decodePunctured(softBits, result, DATA_PUNCTURE);
+
+    for(size_t i = 0; i < result.size(); i++)
+    {
+        if(source[i] != result[i])
+        {
+            printf("Soft decoding error at pos %ld: got %02x, expected %02x\n",
+                   i, result[i], source[i]);
+            return -1;
+        }
+    }
+
     return 0;
 }
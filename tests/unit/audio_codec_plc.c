@@ -0,0 +1,158 @@
+/***************************************************************************
+ *   Copyright (C) 2023 by Federico Amedeo Izzo IU2NUO,                    *
+ *                         Niccolò Izzo IU2KIN                             *
+ *                         Frederik Saraci IU2NRO                          *
+ *                         Silvano Seva IU2KWO                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+#include <interfaces/audio_stream.h>
+#include <interfaces/delays.h>
+#include <audio_codec.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+/*
+ * Voice stream received as by the M17 operating mode: two codec2 frames every
+ * 40ms, decoded with a jitter buffer of four frames. A gap of three stream
+ * frames in the middle of the transmission is signalled, when the stream
+ * resumes, by a placeholder for each lost codec2 frame. Each lost frame is
+ * concealed exactly once, whether its slot comes after the placeholder or the
+ * queue already ran dry: no frame is rejected and, once the stream resumes, the
+ * frames do not wait in the queue longer than before the gap. Once the decoder
+ * is stopped the speaker is immediately available to other streams.
+ */
+
+#define JITTER_FRAMES 4
+#define NUM_FRAMES    40
+#define GAP_START     20
+#define GAP_LENGTH    3
+
+int main()
+{
+    setenv("OPENRTX_VIRTUAL_TIME", "1", 1);
+
+    // Track the main thread in virtual time
+    sleepFor(0u, 1u);
+
+    codec_t *codec = codec_open();
+    if(codec == NULL)
+    {
+        printf("Error: codec allocation\n");
+        return -1;
+    }
+
+    if(codec_startDecodeBuffered(codec, SINK_SPK, PRIO_RX, JITTER_FRAMES) == false)
+    {
+        printf("Error: decoder start\n");
+        return -1;
+    }
+
+    uint8_t      frame[8] = {0};
+    codecStats_t stats;
+    uint32_t     maxBefore = 0;
+    uint32_t     maxAfter  = 0;
+
+    for(uint8_t i = 0; i < NUM_FRAMES; i++)
+    {
+        sleepFor(0u, 40u);
+
+        if((i >= GAP_START) && (i < (GAP_START + GAP_LENGTH)))
+            continue;
+
+        if(i == (GAP_START + GAP_LENGTH))
+        {
+            for(uint8_t j = 0; j < (2 * GAP_LENGTH); j++)
+                codec_pushLostFrame(codec, false);
+        }
+
+        frame[0] = i;
+        codec_pushFrame(codec, frame, false);
+        codec_pushFrame(codec, frame, false);
+
+        codec_getStats(codec, &stats);
+        if(i < GAP_START)
+        {
+            if(stats.queued > maxBefore) maxBefore = stats.queued;
+        }
+        else if(i > (GAP_START + GAP_LENGTH))
+        {
+            if(stats.queued > maxAfter) maxAfter = stats.queued;
+        }
+    }
+
+    codec_endStream(codec);
+    codec_getStats(codec, &stats);
+
+    if(stats.overruns != 0)
+    {
+        printf("Error: %u frames rejected\n", stats.overruns);
+        return -1;
+    }
+
+    // Three stream frames carry six codec2 frames, more than the jitter
+    // buffer covers: the queue runs dry once.
+    if((stats.underruns != 1) || (stats.concealed != (2 * GAP_LENGTH)))
+    {
+        printf("Error: %u underruns, %u frames concealed\n", stats.underruns,
+               stats.concealed);
+        return -1;
+    }
+
+    if(maxAfter > maxBefore)
+    {
+        printf("Error: queue depth %u after the gap, %u before\n", maxAfter,
+               maxBefore);
+        return -1;
+    }
+
+    // At the end of the stream the queue is played out and no frame is
+    // concealed.
+    uint32_t concealed = stats.concealed;
+    sleepFor(0u, 500u);
+    codec_getStats(codec, &stats);
+
+    if((stats.queued != 0) || (stats.concealed != concealed))
+    {
+        printf("Error: stream end, %u frames queued, %u concealed\n",
+               stats.queued, stats.concealed - concealed);
+        return -1;
+    }
+
+    // Closing the last mixer source stops its output stream synchronously,
+    // within one mixer cycle: then even a lower priority stream can start.
+    long long stopStart = getTick();
+    codec_stop(codec);
+    codec_close(codec);
+
+    if((getTick() - stopStart) > 40)
+    {
+        printf("Error: decoder stopped in %lld ms\n", getTick() - stopStart);
+        return -1;
+    }
+
+    static stream_sample_t beep[320];
+    streamId id = outputStream_start(SINK_SPK, PRIO_BEEP, beep, 320,
+                                     BUF_CIRC_DOUBLE, 8000);
+    if(id < 0)
+    {
+        printf("Error: output stream still busy\n");
+        return -1;
+    }
+
+    outputStream_stop(id);
+
+    return 0;
+}
@@ -0,0 +1,247 @@
+/***************************************************************************
+ *   Copyright (C) 2023 by Federico Amedeo Izzo IU2NUO,                    *
+ *                         Niccolò Izzo IU2KIN                             *
+ *                         Frederik Saraci IU2NRO                          *
+ *                         Silvano Seva IU2KWO                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+#include <cstdio>
+#include <cstdint>
+#include <audio_path.h>
+
+/*
+ * Mock of the low-level audio driver: connections are counted per path and
+ * two paths are compatible when they have neither the source nor the sink in
+ * common.
+ */
+static int connections[3][3];
+static int connectCalls;
+
+void audio_connect(const enum AudioSource source, const enum AudioSink sink)
+{
+    connections[source][sink] += 1;
+    connectCalls += 1;
+}
+
+void audio_disconnect(const enum AudioSource source, const enum AudioSink sink)
+{
+    connections[source][sink] -= 1;
+}
+
+bool audio_checkPathCompatibility(const enum AudioSource p1Source,
+                                  const enum AudioSink   p1Sink,
+                                  const enum AudioSource p2Source,
+                                  const enum AudioSink   p2Sink)
+{
+    return (p1Source != p2Source) && (p1Sink != p2Sink);
+}
+
+static bool connected(const enum AudioSource source, const enum AudioSink sink)
+{
+    return connections[source][sink] > 0;
+}
+
+static bool noConnections()
+{
+    for(size_t i = 0; i < 3; i++)
+    {
+        for(size_t j = 0; j < 3; j++)
+        {
+            if(connections[i][j] != 0)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * A higher priority path suspends an incompatible one, which is resumed once
+ * the former is released. Lower priority requests are rejected.
+ */
+static bool testSuspendResume()
+{
+    pathId rx = audioPath_request(SOURCE_RTX, SINK_SPK, PRIO_RX);
+    if((rx < 0) || (connected(SOURCE_RTX, SINK_SPK) == false))
+        return false;
+
+    pathId beep = audioPath_request(SOURCE_MCU, SINK_SPK, PRIO_BEEP);
+    if(beep != -1)
+        return false;
+
+    pathId vp = audioPath_request(SOURCE_MCU, SINK_SPK, PRIO_PROMPT);
+    if((vp < 0) || (audioPath_getStatus(rx) != PATH_SUSPENDED) ||
+       (audioPath_getStatus(vp) != PATH_OPEN))
+        return false;
+
+    if(connected(SOURCE_RTX, SINK_SPK) || (connected(SOURCE_MCU, SINK_SPK) == false))
+        return false;
+
+    // Compatible path, does not interfere with the other ones
+    pathId tx = audioPath_request(SOURCE_MIC, SINK_MCU, PRIO_TX);
+    if((tx < 0) || (audioPath_getStatus(vp) != PATH_OPEN))
+        return false;
+
+    audioPath_release(vp);
+    if((audioPath_getStatus(vp) != PATH_CLOSED) ||
+       (audioPath_getStatus(rx) != PATH_OPEN)   ||
+       (connected(SOURCE_RTX, SINK_SPK) == false))
+        return false;
+
+    audioPath_release(rx);
+    audioPath_release(tx);
+
+    return noConnections();
+}
+
+/**
+ * Nested suspension: releasing an intermediate path hands its suspended paths
+ * over to the one which suspended it.
+ */
+static bool testNested()
+{
+    pathId low  = audioPath_request(SOURCE_RTX, SINK_SPK, PRIO_BEEP);
+    pathId mid  = audioPath_request(SOURCE_RTX, SINK_MCU, PRIO_RX);
+    pathId high = audioPath_request(SOURCE_RTX, SINK_RTX, PRIO_TX);
+
+    if((low < 0) || (mid < 0) || (high < 0))
+        return false;
+
+    if((audioPath_getStatus(low)  != PATH_SUSPENDED) ||
+       (audioPath_getStatus(mid)  != PATH_SUSPENDED) ||
+       (audioPath_getStatus(high) != PATH_OPEN))
+        return false;
+
+    // Low priority path is still suspended by the highest priority one
+    audioPath_release(mid);
+    if((audioPath_getStatus(low) != PATH_SUSPENDED) ||
+       connected(SOURCE_RTX, SINK_SPK))
+        return false;
+
+    audioPath_release(high);
+    if((audioPath_getStatus(low) != PATH_OPEN) ||
+       (connected(SOURCE_RTX, SINK_SPK) == false))
+        return false;
+
+    // Releasing a suspended path does not touch the connections
+    pathId top = audioPath_request(SOURCE_RTX, SINK_RTX, PRIO_TX);
+    audioPath_release(low);
+    if((audioPath_getStatus(low) != PATH_CLOSED) ||
+       (connected(SOURCE_RTX, SINK_RTX) == false))
+        return false;
+
+    audioPath_release(top);
+
+    return noConnections();
+}
+
+/**
+ * Paths from MCU to speaker are mixed in software and share the same
+ * connection.
+ */
+static bool testMixed()
+{
+    int calls = connectCalls;
+
+    pathId rx = audioPath_request(SOURCE_MCU, SINK_SPK, PRIO_RX);
+    pathId vp = audioPath_request(SOURCE_MCU, SINK_SPK, PRIO_PROMPT);
+
+    if((rx < 0) || (vp < 0) || (audioPath_getStatus(rx) != PATH_OPEN))
+        return false;
+
+    if((connectCalls != (calls + 1)) || (connections[SOURCE_MCU][SINK_SPK] != 1))
+        return false;
+
+    audioPath_release(rx);
+    if(connected(SOURCE_MCU, SINK_SPK) == false)
+        return false;
+
+    audioPath_release(vp);
+
+    return noConnections();
+}
+
+/**
+ * IDs of released paths stay invalid even when their resources are reused,
+ * requests beyond the maximum number of paths are rejected.
+ */
+static bool testIds()
+{
+    pathId first = audioPath_request(SOURCE_MCU, SINK_SPK, PRIO_RX);
+    audioPath_release(first);
+
+    pathId second = audioPath_request(SOURCE_MCU, SINK_SPK, PRIO_RX);
+    if((second == first) || (audioPath_getStatus(first) != PATH_CLOSED))
+        return false;
+
+    audioPath_release(first);
+    if(audioPath_getStatus(second) != PATH_OPEN)
+        return false;
+
+    pathId ids[64];
+    size_t num = 0;
+
+    while(num < 64)
+    {
+        ids[num] = audioPath_request(SOURCE_MCU, SINK_SPK, PRIO_RX);
+        if(ids[num] < 0)
+            break;
+
+        num++;
+    }
+
+    if((num == 0) || (num == 64))
+        return false;
+
+    for(size_t i = 0; i < num; i++)
+        audioPath_release(ids[i]);
+
+    audioPath_release(second);
+
+    if(audioPath_request((enum AudioSource) 3, SINK_SPK, PRIO_RX) != -1)
+        return false;
+
+    return noConnections();
+}
+
+int main()
+{
+    if(testSuspendResume() == false)
+    {
+        printf("Error: path suspension\n");
+        return -1;
+    }
+
+    if(testNested() == false)
+    {
+        printf("Error: nested path suspension\n");
+        return -1;
+    }
+
+    if(testMixed() == false)
+    {
+        printf("Error: shared paths\n");
+        return -1;
+    }
+
+    if(testIds() == false)
+    {
+        printf("Error: path identifiers\n");
+        return -1;
+    }
+
+    return 0;
+}
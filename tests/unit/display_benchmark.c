@@ -0,0 +1,138 @@
+/***************************************************************************
+ *   Copyright (C) 2021 - 2023 by Federico Amedeo Izzo IU2NUO,             *
+ *                                Niccolò Izzo IU2KIN                      *
+ *                                Frederik Saraci IU2NRO                   *
+ *                                Silvano Seva IU2KWO                      *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+#include <graphics.h>
+#include <hwconfig.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+/**
+ * Host version of tests/platform/MDx_display_benchmark.c: measures the time
+ * taken by the graphics primitives to draw into the framebuffer. The display
+ * is not rendered, so that the results do not depend on the SDL window.
+ *
+ * Usage: display_benchmark [iterations]
+ */
+
+typedef void (*drawFunc_t)(uint32_t i);
+
+static const color_t color_red   = {255, 0,   0,   255};
+static const color_t color_white = {255, 255, 255, 255};
+static const color_t color_grey  = {60,  60,  60,  128};
+
+static void drawClear(uint32_t i)
+{
+    (void) i;
+    gfx_clearScreen();
+}
+
+static void drawFill(uint32_t i)
+{
+    (void) i;
+    gfx_fillScreen(color_red);
+}
+
+static void drawRectFill(uint32_t i)
+{
+    point_t origin = {0, i % SCREEN_HEIGHT};
+    gfx_drawRect(origin, SCREEN_WIDTH, 20, color_red, true);
+}
+
+static void drawRectBlend(uint32_t i)
+{
+    point_t origin = {0, i % SCREEN_HEIGHT};
+    gfx_drawRect(origin, SCREEN_WIDTH, 20, color_grey, true);
+}
+
+static void drawRectLine(uint32_t i)
+{
+    point_t origin = {i % 16, i % SCREEN_HEIGHT};
+    gfx_drawRect(origin, SCREEN_WIDTH / 2, 20, color_white, false);
+}
+
+static void drawHLine(uint32_t i)
+{
+    gfx_drawHLine(i % SCREEN_HEIGHT, 2, color_white);
+}
+
+static void drawText(uint32_t i)
+{
+    point_t origin = {0, 20 + (i % 16)};
+    gfx_print(origin, FONT_SIZE_24PT, TEXT_ALIGN_LEFT, color_white, "KEK");
+}
+
+static void drawSmallText(uint32_t i)
+{
+    point_t origin = {0, 10 + (i % 16)};
+    gfx_print(origin, FONT_SIZE_8PT, TEXT_ALIGN_CENTER, color_white,
+              "430.100.000 M17");
+}
+
+static const struct
+{
+    const char *name;
+    drawFunc_t  func;
+}
+benchmarks[] =
+{
+    {"clearScreen",      drawClear},
+    {"fillScreen",       drawFill},
+    {"drawRect (fill)",  drawRectFill},
+    {"drawRect (alpha)", drawRectBlend},
+    {"drawRect (line)",  drawRectLine},
+    {"drawHLine",        drawHLine},
+    {"print 24pt",       drawText},
+    {"print 8pt",        drawSmallText},
+};
+
+static uint64_t now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec * 1000000000ull) + ts.tv_nsec;
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t numIterations = 10000;
+    if(argc > 1)
+        numIterations = strtoul(argv[1], NULL, 10);
+
+    gfx_init();
+
+    printf("Average values over %u iterations, %ux%u display:\n",
+           numIterations, SCREEN_WIDTH, SCREEN_HEIGHT);
+
+    for(size_t b = 0; b < sizeof(benchmarks)/sizeof(benchmarks[0]); b++)
+    {
+        uint64_t start = now();
+
+        for(uint32_t i = 0; i < numIterations; i++)
+            benchmarks[b].func(i);
+
+        uint64_t total = now() - start;
+        printf("- %-18s %8.2f us\n", benchmarks[b].name,
+               ((double) total / numIterations) / 1000.0);
+    }
+
+    return 0;
+}
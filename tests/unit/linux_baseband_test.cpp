@@ -0,0 +1,248 @@
+/***************************************************************************
+ *   Copyright (C) 2023 by Federico Amedeo Izzo IU2NUO,                    *
+ *                         Niccolò Izzo IU2KIN                             *
+ *                         Frederik Saraci IU2NRO                          *
+ *                         Silvano Seva IU2KWO                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cmath>
+#include <pthread.h>
+#include <interfaces/audio_stream.h>
+#include <interfaces/delays.h>
+#include <baseband_linux.h>
+
+static constexpr size_t TX_BUF_SIZE = 1920;     // 40ms at 48kHz
+static constexpr size_t RX_BUF_SIZE = 960;      // 40ms at 24kHz
+static constexpr size_t NUM_BLOCKS  = 25;
+
+/**
+ * Samples are looped back unchanged at the bus sample rate. Samples of the
+ * last transmission are kept until received, older ones are discarded when
+ * the receiver is turned on, missing ones are zeroes.
+ */
+static bool testLoopback()
+{
+    stream_sample_t tx[1000];
+    stream_sample_t rx[1200];
+
+    for(size_t i = 0; i < 1000; i++)
+        tx[i] = i;
+
+    baseband_openTx();
+    baseband_write(tx, 500);
+
+    baseband_openTx();
+    baseband_write(tx, 600);
+    if(baseband_openRx() == false)
+        return false;
+
+    baseband_write(tx + 600, 400);
+    if(baseband_read(rx, 1200, BASEBAND_SAMPLE_RATE) != 1000)
+        return false;
+
+    for(size_t i = 0; i < 1200; i++)
+    {
+        stream_sample_t expected = (i < 1000) ? i : 0;
+        if(rx[i] != expected)
+            return false;
+    }
+
+    return true;
+}
+
+/**
+ * Decimation to half the bus sample rate preserves the in-band signals,
+ * delayed by the group delay of the filter.
+ */
+static bool testDecimation()
+{
+    static constexpr float  freq  = 1000.0f;
+    static constexpr size_t delay = 11;         // Filter delay, at 48kHz
+
+    stream_sample_t tx[4800];
+    stream_sample_t rx[2400];
+
+    baseband_openRx();
+
+    for(size_t i = 0; i < 4800; i++)
+        tx[i] = 10000.0f * std::sin(2.0f * M_PI * freq * i / 48000.0f);
+
+    baseband_write(tx, 4800);
+    if(baseband_read(rx, 2400, BASEBAND_SAMPLE_RATE / 2) != 2400)
+        return false;
+
+    for(size_t i = 20; i < 2400; i++)
+    {
+        float t        = static_cast< float >((2 * i) + 1 - delay) / 48000.0f;
+        float expected = 10000.0f * std::sin(2.0f * M_PI * freq * t);
+
+        if(std::fabs(rx[i] - expected) > 200.0f)
+            return false;
+    }
+
+    return true;
+}
+
+static void *txFunc(void *arg)
+{
+    (void) arg;
+
+    static stream_sample_t buf[2 * TX_BUF_SIZE];
+    for(size_t i = 0; i < TX_BUF_SIZE; i++)
+        buf[i] = 1000;
+
+    streamId id = outputStream_start(SINK_RTX, PRIO_TX, buf, 2 * TX_BUF_SIZE,
+                                     BUF_CIRC_DOUBLE, BASEBAND_SAMPLE_RATE);
+    if(id < 0)
+        return NULL;
+
+    for(size_t i = 1; i < NUM_BLOCKS; i++)
+    {
+        stream_sample_t *idle = outputStream_getIdleBuffer(id);
+        for(size_t j = 0; j < TX_BUF_SIZE; j++)
+            idle[j] = 1000 + i;
+
+        outputStream_sync(id, true);
+    }
+
+    outputStream_stop(id);
+    outputStream_sync(id, false);
+
+    return NULL;
+}
+
+/**
+ * \internal
+ * Receive the blocks sent by txFunc(), followed by two blocks of silence.
+ */
+static bool checkBlocks(const streamId id)
+{
+    bool ok = true;
+    for(size_t i = 0; i < NUM_BLOCKS + 2; i++)
+    {
+        dataBlock_t block = inputStream_getData(id);
+        if(block.len != RX_BUF_SIZE)
+        {
+            ok = false;
+            break;
+        }
+
+        // Skip the filter transient at the beginning of each block
+        stream_sample_t expected = (i < NUM_BLOCKS) ? (1000 + i) : 0;
+        for(size_t j = 12; j < RX_BUF_SIZE; j++)
+        {
+            if(std::abs(block.data[j] - expected) > 2)
+                ok = false;
+        }
+    }
+
+    return ok;
+}
+
+/**
+ * Baseband transmitted by an output stream is received, at its own rate, by
+ * the input stream of the same process. Run in virtual time, the receiver
+ * sees each block as soon as its transmission is completed.
+ */
+static bool testStreams()
+{
+    static stream_sample_t buf[2 * RX_BUF_SIZE];
+
+    streamId id = inputStream_start(SOURCE_RTX, PRIO_RX, buf, 2 * RX_BUF_SIZE,
+                                    BUF_CIRC_DOUBLE, BASEBAND_SAMPLE_RATE / 2);
+    if(id < 0)
+        return false;
+
+    pthread_t tx;
+    pthread_create(&tx, NULL, txFunc, NULL);
+
+    bool ok = checkBlocks(id);
+
+    pthread_join(tx, NULL);
+    inputStream_stop(id);
+
+    return ok;
+}
+
+/**
+ * Sequence used by the M17 operating mode: the receiver is turned off while
+ * transmitting and turned on again at the end of the transmission, which is
+ * then received entirely.
+ */
+static bool testRestart()
+{
+    static stream_sample_t buf[2 * RX_BUF_SIZE];
+
+    streamId id = inputStream_start(SOURCE_RTX, PRIO_RX, buf, 2 * RX_BUF_SIZE,
+                                    BUF_CIRC_DOUBLE, BASEBAND_SAMPLE_RATE / 2);
+    if(id < 0)
+        return false;
+
+    inputStream_getData(id);
+    inputStream_stop(id);
+
+    pthread_t tx;
+    pthread_create(&tx, NULL, txFunc, NULL);
+    pthread_join(tx, NULL);
+
+    id = inputStream_start(SOURCE_RTX, PRIO_RX, buf, 2 * RX_BUF_SIZE,
+                           BUF_CIRC_DOUBLE, BASEBAND_SAMPLE_RATE / 2);
+    if(id < 0)
+        return false;
+
+    bool ok = checkBlocks(id);
+    inputStream_stop(id);
+
+    return ok;
+}
+
+int main()
+{
+    setenv("OPENRTX_BASEBAND", "loop", 1);
+    setenv("OPENRTX_VIRTUAL_TIME", "1", 1);
+
+    // Track the main thread in virtual time
+    sleepFor(0u, 1u);
+
+    if(testLoopback() == false)
+    {
+        printf("Error: baseband loopback\n");
+        return -1;
+    }
+
+    if(testDecimation() == false)
+    {
+        printf("Error: baseband decimation\n");
+        return -1;
+    }
+
+    if(testStreams() == false)
+    {
+        printf("Error: baseband streams\n");
+        return -1;
+    }
+
+    if(testRestart() == false)
+    {
+        printf("Error: baseband receiver restart\n");
+        return -1;
+    }
+
+    return 0;
+}
@@ -20,6 +20,7 @@
 #include <chrono>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <thread>
 #include <vector>
 
@@ -183,6 +184,117 @@ void test_ring_buffer(uint64_t n_bytes,
     }
 }
 
+void test_fast(uint64_t n_bytes, uint64_t n_iter, const uint64_t buf_size)
+{
+    // Deliver the samples without pacing, none of them must be lost
+    setenv("OPENRTX_INPUT_FAST", "1", 1);
+
+    FILE* fp = fopen(files[SOURCE_RTX], "wb");
+    CHECK(fp);
+
+    for (uint64_t i = 0; i < n_bytes; i++)
+    {
+        uint16_t j = i;
+        CHECK(fwrite(&j, sizeof(j), 1, fp) == 1);
+    }
+    fclose(fp);
+
+    std::vector<stream_sample_t> tmp(buf_size);
+    auto id = inputStream_start(SOURCE_RTX, AudioPriority::PRIO_RX, tmp.data(),
+                                tmp.size(), BufMode::BUF_CIRC_DOUBLE, 8000);
+    CHECK(id != -1);
+
+    using namespace std::chrono;
+    time_point<steady_clock> t0 = steady_clock::now();
+
+    uint64_t ctr = 0;
+    for (uint64_t i = 0; i < n_iter; i++)
+    {
+        auto db = inputStream_getData(id);
+
+        CHECK(db.len == buf_size / 2);
+        for (uint64_t k = 0; k < db.len; k++)
+        {
+            CHECK(uint16_t(db.data[k]) == uint16_t(ctr % n_bytes));
+            ctr++;
+        }
+    }
+
+    // Must run well faster than real time
+    auto t2                 = steady_clock::now();
+    const uint64_t delta    = duration_cast<microseconds>(t2 - t0).count();
+    const uint64_t expected = (buf_size / 2 * n_iter * 1000000lu / 8000);
+    CHECK(delta < expected / 10);
+
+    inputStream_stop(id);
+    CHECK(remove(files[SOURCE_RTX]) == 0);
+
+    unsetenv("OPENRTX_INPUT_FAST");
+}
+
+void test_history(uint64_t n_bytes, uint64_t n_iter, const uint64_t buf_size,
+                  const uint64_t history)
+{
+    // Blocks are modified in place by the consumer, the history seen by the
+    // next block must hold the modified samples.
+    setenv("OPENRTX_INPUT_FAST", "1", 1);
+
+    FILE* fp = fopen(files[SOURCE_RTX], "wb");
+    CHECK(fp);
+
+    for (uint64_t i = 0; i < n_bytes; i++)
+    {
+        uint16_t j = i;
+        CHECK(fwrite(&j, sizeof(j), 1, fp) == 1);
+    }
+    fclose(fp);
+
+    std::vector<stream_sample_t> tmp(history + buf_size, 0x5555);
+    auto id = inputStream_startWithHistory(SOURCE_RTX, AudioPriority::PRIO_RX,
+                                           tmp.data(), tmp.size(), history,
+                                           8000);
+    CHECK(id != -1);
+
+    // History larger than a block is not allowed
+    CHECK(inputStream_startWithHistory(SOURCE_RTX, AudioPriority::PRIO_TX,
+                                       tmp.data(), tmp.size(), buf_size,
+                                       8000) == -1);
+
+    uint64_t ctr = 0;
+    for (uint64_t i = 0; i < n_iter; i++)
+    {
+        auto db = inputStream_acquire(id);
+
+        CHECK(db.len == buf_size / 2);
+        CHECK(db.data == &tmp[history + (i % 2) * (buf_size / 2)]);
+
+        // Only one block at a time can be owned
+        CHECK(inputStream_acquire(id).data == NULL);
+
+        for (uint64_t k = 1; k <= history; k++)
+        {
+            stream_sample_t expected = 0;
+            if (ctr >= k) expected = ~uint16_t((ctr - k) % n_bytes);
+
+            CHECK(db.data[-(int64_t)k] == expected);
+        }
+
+        for (uint64_t k = 0; k < db.len; k++)
+        {
+            CHECK(uint16_t(db.data[k]) == uint16_t(ctr % n_bytes));
+            db.data[k] = ~db.data[k];
+            ctr++;
+        }
+
+        inputStream_release(id);
+    }
+
+    inputStream_stop(id);
+    CHECK(remove(files[SOURCE_RTX]) == 0);
+
+    unsetenv("OPENRTX_INPUT_FAST");
+}
+
 int main()
 {
     test_linear();
@@ -190,5 +302,8 @@ int main()
     test_ring_buffer(128, 10, 256);
     test_ring_buffer(256, 10, 128);
     test_ring_buffer(1234, 10, 768);
+    test_fast(1000, 2000, 320);
+    test_history(1000, 200, 320, 55);
+    test_history(1000, 200, 320, 160);
     return 0;
 }
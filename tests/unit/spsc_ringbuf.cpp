@@ -0,0 +1,170 @@
+/***************************************************************************
+ *   Copyright (C) 2023 by Federico Amedeo Izzo IU2NUO,                    *
+ *                         Niccolò Izzo IU2KIN                             *
+ *                         Frederik Saraci IU2NRO                          *
+ *                         Silvano Seva IU2KWO                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+#include <cstdio>
+#include <cstdint>
+#include <thread>
+#include <ringbuf.hpp>
+
+static constexpr uint32_t NUM_ELEMENTS = 100000;
+
+/**
+ * Single element and block push/pop on the lock-free queue, from two threads.
+ */
+static bool testLockFree()
+{
+    static SpscRingBuffer< uint32_t, 256 > buf;
+    bool ok = true;
+
+    std::thread producer([]
+    {
+        uint32_t next = 0;
+        uint32_t block[37];
+
+        while(next < NUM_ELEMENTS)
+        {
+            size_t pushed = 0;
+
+            if((next % 3) == 0)
+            {
+                pushed = buf.push(next) ? 1 : 0;
+            }
+            else
+            {
+                size_t num = (next % 37) + 1;
+                if(num > (NUM_ELEMENTS - next)) num = NUM_ELEMENTS - next;
+                for(size_t i = 0; i < num; i++) block[i] = next + i;
+
+                pushed = buf.push(block, num);
+            }
+
+            next += pushed;
+            if(pushed == 0) std::this_thread::yield();
+        }
+    });
+
+    uint32_t expected = 0;
+    uint32_t block[53];
+
+    while(expected < NUM_ELEMENTS)
+    {
+        size_t num = 0;
+
+        if((expected % 2) == 0)
+            num = buf.pop(block[0]) ? 1 : 0;
+        else
+            num = buf.pop(block, (expected % 53) + 1);
+
+        for(size_t i = 0; i < num; i++)
+        {
+            if(block[i] != expected) ok = false;
+            expected++;
+        }
+
+        if(num == 0) std::this_thread::yield();
+    }
+
+    producer.join();
+
+    if(buf.empty() == false) ok = false;
+
+    return ok;
+}
+
+/**
+ * Blocking push and pop, with a queue small enough to make both sides wait.
+ */
+static bool testBlocking()
+{
+    static BlockingSpscRingBuffer< uint32_t, 4 > buf;
+    bool ok = true;
+
+    std::thread producer([]
+    {
+        for(uint32_t i = 0; i < NUM_ELEMENTS; i++)
+            buf.push(i, true);
+    });
+
+    for(uint32_t i = 0; i < NUM_ELEMENTS; i++)
+    {
+        uint32_t elem;
+        if((buf.pop(elem, true) == false) || (elem != i))
+            ok = false;
+    }
+
+    producer.join();
+
+    return ok;
+}
+
+/**
+ * Full and empty queue behaviour, with wrap around of the block operations.
+ */
+static bool testLimits()
+{
+    SpscRingBuffer< uint8_t, 8 > buf;
+    uint8_t data[10] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+    uint8_t out[10];
+
+    if((buf.empty() == false) || (buf.pop(out[0]) == true))
+        return false;
+
+    if((buf.push(data, 5) != 5) || (buf.pop(out, 3) != 3))
+        return false;
+
+    // Three free slots at the end of the buffer, three at the beginning
+    if((buf.push(data, 10) != 6) || (buf.full() == false) || buf.push(data[0]))
+        return false;
+
+    if((buf.pop(out, 10) != 8) || (buf.empty() == false))
+        return false;
+
+    const uint8_t expected[8] = {3, 4, 0, 1, 2, 3, 4, 5};
+    for(size_t i = 0; i < 8; i++)
+    {
+        if(out[i] != expected[i])
+            return false;
+    }
+
+    return true;
+}
+
+int main()
+{
+    if(testLimits() == false)
+    {
+        printf("Error: queue limits\n");
+        return -1;
+    }
+
+    if(testLockFree() == false)
+    {
+        printf("Error: lock-free push/pop\n");
+        return -1;
+    }
+
+    if(testBlocking() == false)
+    {
+        printf("Error: blocking push/pop\n");
+        return -1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,176 @@
+/***************************************************************************
+ *   Copyright (C) 2023 by Federico Amedeo Izzo IU2NUO,                    *
+ *                         Niccolò Izzo IU2KIN                             *
+ *                         Frederik Saraci IU2NRO                          *
+ *                         Silvano Seva IU2KWO                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <chrono>
+#include <vector>
+#include <pthread.h>
+#include <interfaces/delays.h>
+#include <virtual_clock.h>
+#include <ringbuf.hpp>
+
+static pthread_mutex_t logMutex = PTHREAD_MUTEX_INITIALIZER;
+static std::vector< long long > wakeLog;
+
+/**
+ * Periodic thread, logging its identifier and the wakeup time.
+ */
+static void *periodicFunc(void *arg)
+{
+    long long period = reinterpret_cast< intptr_t >(arg);
+    long long time   = getTick();
+    long long end    = time + 10000;
+
+    while(time < end)
+    {
+        time += period;
+        sleepUntil(time);
+
+        pthread_mutex_lock(&logMutex);
+        wakeLog.push_back((getTick() * 100) + period);
+        pthread_mutex_unlock(&logMutex);
+    }
+
+    return NULL;
+}
+
+static std::vector< long long > runPeriodic()
+{
+    static const intptr_t periods[] = {3, 5, 7, 25};
+    pthread_t threads[4];
+
+    wakeLog.clear();
+
+    for(size_t i = 0; i < 4; i++)
+        pthread_create(&threads[i], NULL, periodicFunc,
+                       reinterpret_cast< void * >(periods[i]));
+
+    for(size_t i = 0; i < 4; i++)
+        pthread_join(threads[i], NULL);
+
+    return wakeLog;
+}
+
+/**
+ * Ten seconds of virtual time run faster than real time, with the periodic
+ * threads woken up in order of time and always with the same interleaving.
+ */
+static bool testPeriodic()
+{
+    auto start = std::chrono::steady_clock::now();
+    auto first = runPeriodic();
+    auto end   = std::chrono::steady_clock::now();
+
+    if((end - start) > std::chrono::seconds(5))
+        return false;
+
+    for(size_t i = 1; i < first.size(); i++)
+    {
+        if((first[i] / 100) < (first[i - 1] / 100))
+            return false;
+    }
+
+    size_t expected = (10000 / 3) + (10000 / 5) + (10000 / 7) + (10000 / 25);
+    if(first.size() < expected)
+        return false;
+
+    // Second run, starting from a different time
+    auto second = runPeriodic();
+    if(first.size() != second.size())
+        return false;
+
+    long long offset = (second[0] / 100) - (first[0] / 100);
+    for(size_t i = 0; i < first.size(); i++)
+    {
+        if((second[i] - first[i]) != (offset * 100))
+            return false;
+    }
+
+    return true;
+}
+
+static BlockingSpscRingBuffer< long long, 4 > queue;
+
+static void *producerFunc(void *arg)
+{
+    (void) arg;
+
+    for(long long i = 0; i < 100; i++)
+    {
+        sleepFor(0u, 20u);
+        queue.push(getTick(), true);
+    }
+
+    return NULL;
+}
+
+/**
+ * A thread blocked on a condition variable is resumed before the time
+ * advances: a consumer sees the data at the same time it was produced, even
+ * when doing some long computation on it.
+ */
+static bool testHandoff()
+{
+    pthread_t producer;
+    pthread_create(&producer, NULL, producerFunc, NULL);
+
+    bool ok = true;
+    for(size_t i = 0; i < 100; i++)
+    {
+        long long time = 0;
+        queue.pop(time, true);
+
+        volatile uint32_t work = 0;
+        for(uint32_t j = 0; j < 100000; j++)
+            work += j;
+
+        if(getTick() != time)
+            ok = false;
+    }
+
+    pthread_join(producer, NULL);
+
+    return ok;
+}
+
+int main()
+{
+    setenv("OPENRTX_VIRTUAL_TIME", "1", 1);
+
+    // Track also the main thread, to keep the time still while it creates
+    // the other ones.
+    sleepFor(0u, 1u);
+
+    if(testPeriodic() == false)
+    {
+        printf("Error: periodic threads\n");
+        return -1;
+    }
+
+    if(testHandoff() == false)
+    {
+        printf("Error: thread handoff\n");
+        return -1;
+    }
+
+    return 0;
+}